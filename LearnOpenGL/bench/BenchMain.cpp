@@ -0,0 +1,336 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+#include "Application.h"
+#include "Display.h"
+#include "GLDebug.h"
+#include "GLState.h"
+#include "DeletionQueue.h"
+#include "MockGL.h"
+#include "ShaderSource.h"
+#include "BenchScene.h"
+
+// learnopengl_bench: draws generated scenes for a fixed number of frames and
+// reports frame time percentiles, throughput and GL call counts as JSON.
+// Every axis takes a comma separated list and the full cross product is run:
+//
+//   --objects 1,100,10000,100000,1000000
+//   --mesh small,medium             (also large)
+//   --pattern uniform,meshes,programs
+//   --data static,dynamic
+//   --path auto                     (draws, instanced, lists; auto picks instanced above 16384 objects)
+//   --threads 0                     (threads recording lists, the main one included; 0 uses all)
+//   --frames 100 --warmup 10
+//   --out results.json              (stdout otherwise)
+//   --mock                          (run on MockGL and count every GL call)
+//   --verify                        (check fixed scenes' exact MockGL call counts and exit)
+//
+// Renders headless where HEADLESS_DISPLAY is compiled in, otherwise into a
+// hidden window. With --mock nothing is rendered: times are the CPU cost of
+// the code base alone and the GL call counts are exact and repeatable.
+// --verify builds on that: it runs one draws and one instanced scene on MockGL,
+// compares every entry point's calls per frame against the expected counts and
+// fails on any GL error, so a change in what the renderer submits is caught.
+
+namespace {
+
+const unsigned int AutoInstancedObjects = 16384;
+
+// Past the warmup the uniform ring's fences are in steady state, so every
+// frame makes the same calls.
+const unsigned int VerifyWarmup = 4;
+const unsigned int VerifyFrames = 8;
+
+struct ExpectedCalls
+{
+    MockCall call;
+    unsigned int perFrame;
+};
+
+struct VerifyCase
+{
+    BenchSceneDesc desc;
+    std::vector<ExpectedCalls> calls;
+};
+
+// 100 objects over 4 programs and 51 mesh runs. The frame block and the
+// ring's map, unmap and fence are the same on both paths.
+const VerifyCase verifyCases[] = {
+    { { 100, BenchMesh::Small, BenchPattern::Programs, BenchData::Static, BenchPath::Draws }, {
+        { MockCall::BindBufferRange, 101 }, { MockCall::BindVertexArray, 51 }, { MockCall::Clear, 1 },
+        { MockCall::ClientWaitSync, 1 }, { MockCall::DeleteSync, 1 }, { MockCall::DrawElementsBaseVertex, 100 },
+        { MockCall::FenceSync, 1 }, { MockCall::MapBufferRange, 1 }, { MockCall::UnmapBuffer, 1 },
+        { MockCall::UseProgram, 4 } } },
+    { { 100, BenchMesh::Small, BenchPattern::Programs, BenchData::Static, BenchPath::Instanced }, {
+        { MockCall::BindBufferRange, 1 }, { MockCall::BindVertexArray, 51 }, { MockCall::Clear, 1 },
+        { MockCall::ClientWaitSync, 1 }, { MockCall::DeleteSync, 1 }, { MockCall::DrawElementsInstancedBaseVertex, 51 },
+        { MockCall::FenceSync, 1 }, { MockCall::MapBufferRange, 1 }, { MockCall::UnmapBuffer, 1 },
+        { MockCall::UseProgram, 4 } } },
+};
+
+// Runs verifyCases on MockGL, printing every mismatch. glGetError is left
+// out of the counts: debug builds call it after every GL call.
+bool verify(const ShaderSource& vertex, const ShaderSource& fragment, WorkerPool& workers)
+{
+    bool passed = true;
+    for (const VerifyCase& test : verifyCases) {
+        const std::string name = test.desc.getName();
+        const uint64_t errors = MockGL::getErrorCount();
+        std::vector<uint64_t> counts((size_t)MockCall::Count);
+        {
+            BenchScene scene(test.desc, vertex, fragment, &workers);
+            scene.run(nullptr, VerifyWarmup, VerifyFrames);
+            for (size_t call = 0; call < counts.size(); call++)
+                counts[call] = MockGL::getCallCount((MockCall)call);
+        }
+        DeletionQueue::flush();
+
+        bool casePassed = true;
+        for (size_t call = 0; call < counts.size(); call++) {
+            if ((MockCall)call == MockCall::GetError)
+                continue;
+            unsigned int expected = 0;
+            for (const ExpectedCalls& calls : test.calls)
+                if (calls.call == (MockCall)call)
+                    expected = calls.perFrame;
+            if (counts[call] != (uint64_t)expected * VerifyFrames) {
+                std::cerr << name << ": " << MockGL::getName((MockCall)call) << " " << (double)counts[call] / VerifyFrames
+                    << " per frame, expected " << expected << std::endl;
+                casePassed = false;
+            }
+        }
+        const uint64_t raised = MockGL::getErrorCount() - errors;
+        if (raised || glGetError() != GL_NO_ERROR) {
+            std::cerr << name << ": " << raised << " GL errors" << std::endl;
+            casePassed = false;
+        }
+        std::cerr << (casePassed ? "PASS " : "FAIL ") << name << std::endl;
+        passed = passed && casePassed;
+    }
+    return passed;
+}
+
+std::vector<std::string> split(const char* list)
+{
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+// Returns false and names the bad value when one is not in names.
+template<typename T>
+bool parseNames(const char* list, const char* const* names, unsigned int count, std::vector<T>& out)
+{
+    out.clear();
+    for (const std::string& item : split(list)) {
+        unsigned int i = 0;
+        while (i < count && item != names[i])
+            i++;
+        if (i == count) {
+            std::cerr << "Unknown value " << item << std::endl;
+            return false;
+        }
+        out.push_back((T)i);
+    }
+    return !out.empty();
+}
+
+void writePercentiles(std::ostream& out, const char* name, const BenchPercentiles& value)
+{
+    out << "\"" << name << "\":{\"mean\":" << value.mean << ",\"p50\":" << value.p50 << ",\"p90\":" << value.p90
+        << ",\"p99\":" << value.p99 << ",\"max\":" << value.max << "}";
+}
+
+void writeJson(std::ostream& out, const std::vector<BenchResult>& results, const char* backend, unsigned int threads,
+    unsigned int frames, unsigned int warmup)
+{
+    // Driver strings are printable ASCII without quotes in practice.
+    out << std::fixed << std::setprecision(4);
+    out << "{\n\"renderer\":\"" << glGetString(GL_RENDERER) << "\",\n\"version\":\"" << glGetString(GL_VERSION)
+        << "\",\n\"backend\":\"" << backend << "\",\n\"threads\":" << threads << ",\n\"frames\":" << frames
+        << ",\n\"warmup\":" << warmup << ",\n\"scenes\":[";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& result = results[i];
+        const BenchSceneDesc& desc = result.desc;
+        out << (i ? "," : "") << "\n{\"name\":\"" << desc.getName() << "\",\"path\":\"" << benchPathNames[(int)desc.path]
+            << "\",\"objects\":" << desc.objects << ",\"mesh\":\"" << benchMeshNames[(int)desc.mesh]
+            << "\",\"pattern\":\"" << benchPatternNames[(int)desc.pattern] << "\",\"data\":\"" << benchDataNames[(int)desc.data]
+            << "\",\"setupMs\":" << result.setupMilliseconds << ",";
+        writePercentiles(out, "cpuMs", result.cpuMilliseconds);
+        out << ",";
+        writePercentiles(out, "frameMs", result.frameMilliseconds);
+        out << ",\"trianglesPerFrame\":" << result.trianglesPerFrame << ",\"drawCallsPerSecond\":"
+            << result.drawCallsPerSecond << ",\"trianglesPerSecond\":" << result.trianglesPerSecond
+            << ",\"glCallsPerFrame\":{\"draws\":" << result.calls.drawCalls << ",\"stateRequested\":"
+            << result.calls.stateRequested << ",\"stateForwarded\":" << result.calls.stateForwarded
+            << ",\"programBinds\":" << result.calls.programBinds << ",\"vaoBinds\":" << result.calls.vaoBinds
+            << ",\"constantBinds\":" << result.calls.constantBinds << "}";
+        if (!result.glCallsByEntryPoint.empty()) {
+            out << ",\"mockGlCallsPerFrame\":{\"total\":" << result.glCalls << ",\"perDraw\":"
+                << (result.calls.drawCalls > 0.0 ? result.glCalls / result.calls.drawCalls : 0.0);
+            for (const auto& entryPoint : result.glCallsByEntryPoint)
+                out << ",\"" << entryPoint.first << "\":" << entryPoint.second;
+            out << "}";
+        }
+        out << "}";
+    }
+    out << "\n]}\n";
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const char* const pathNames[] = { "draws", "instanced", "lists", "auto" };
+
+    std::vector<unsigned int> objectCounts = { 1, 100, 10000, 100000, 1000000 };
+    std::vector<BenchMesh> meshes = { BenchMesh::Small, BenchMesh::Medium };
+    std::vector<BenchPattern> patterns = { BenchPattern::Uniform, BenchPattern::Meshes, BenchPattern::Programs };
+    std::vector<BenchData> datas = { BenchData::Static, BenchData::Dynamic };
+    // 3 stands for auto.
+    std::vector<unsigned int> paths = { 3 };
+    unsigned int frames = 100;
+    unsigned int warmup = 10;
+    const char* outPath = nullptr;
+    unsigned int threads = 0;
+    bool mock = false;
+    bool verifyCounts = false;
+
+    for (int i = 1; i < argc; i++) {
+        bool ok = true;
+        if (std::strcmp(argv[i], "--objects") == 0 && i + 1 < argc) {
+            objectCounts.clear();
+            for (const std::string& item : split(argv[++i])) {
+                unsigned int count = (unsigned int)std::strtoul(item.c_str(), nullptr, 10);
+                if (count)
+                    objectCounts.push_back(count);
+            }
+            ok = !objectCounts.empty();
+        }
+        else if (std::strcmp(argv[i], "--mesh") == 0 && i + 1 < argc)
+            ok = parseNames(argv[++i], benchMeshNames, 3, meshes);
+        else if (std::strcmp(argv[i], "--pattern") == 0 && i + 1 < argc)
+            ok = parseNames(argv[++i], benchPatternNames, 3, patterns);
+        else if (std::strcmp(argv[i], "--data") == 0 && i + 1 < argc)
+            ok = parseNames(argv[++i], benchDataNames, 2, datas);
+        else if (std::strcmp(argv[i], "--path") == 0 && i + 1 < argc)
+            ok = parseNames(argv[++i], pathNames, 4, paths);
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            frames = (unsigned int)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+            warmup = (unsigned int)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            outPath = argv[++i];
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = (unsigned int)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--mock") == 0)
+            mock = true;
+        else if (std::strcmp(argv[i], "--verify") == 0)
+            mock = verifyCounts = true;
+        else {
+            std::cerr << "Unknown argument " << argv[i] << std::endl;
+            ok = false;
+        }
+        if (!ok)
+            return 1;
+    }
+
+    std::unique_ptr<Display> display;
+    const char* backend = "mock";
+    if (mock) {
+        if (!MockGL::install()) {
+            std::cerr << "Failed to initialize GLAD" << std::endl;
+            return 1;
+        }
+        // Counting is all the bench needs; the stream would grow every frame.
+        MockGL::setRecording(false);
+    }
+    else {
+#if HEADLESS_DISPLAY
+        HeadlessSettings headless = { 0, "" };
+        display.reset(new Display(1280, 720, "learnopengl_bench", &headless));
+        backend = "headless";
+#else
+        if (!glfwInit())
+            return 1;
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+#ifdef __APPLE__
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+        display.reset(new Display(1280, 720, "learnopengl_bench"));
+        backend = "window";
+#endif
+        display->createContext(nullptr);
+        if (!gladLoadGLLoader((GLADloadproc)display->getProcAddressLoader())) {
+            std::cerr << "Failed to initialize GLAD" << std::endl;
+            return 1;
+        }
+        display->createFramebuffer();
+        display->setSwapMode(SwapMode::Off);
+        GLDebugSink::install((GLADloadproc)display->getProcAddressLoader());
+    }
+    std::cerr << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << std::endl;
+
+    ShaderSource vertex, fragment;
+    if (!loadShaderSource("res/shaders/Shader.vs", vertex) || !loadShaderSource("res/shaders/Shader.fs", fragment))
+        return 1;
+    GLCall(glClearColor(0.71f, 0.44f, 0.76f, 1.0f));
+
+    WorkerPool workers(threads);
+    if (verifyCounts)
+        return verify(vertex, fragment, workers) ? 0 : 1;
+
+    std::vector<BenchResult> results;
+    for (unsigned int objects : objectCounts) {
+        for (unsigned int path : paths) {
+            BenchPath scenePath = path == 3 ? (objects > AutoInstancedObjects ? BenchPath::Instanced : BenchPath::Draws) : (BenchPath)path;
+            for (BenchMesh mesh : meshes) {
+                for (BenchPattern pattern : patterns) {
+                    for (BenchData data : datas) {
+                        BenchSceneDesc desc = { objects, mesh, pattern, data, scenePath };
+                        auto start = std::chrono::steady_clock::now();
+                        BenchResult result;
+                        {
+                            BenchScene scene(desc, vertex, fragment, &workers);
+                            double setup = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                            result = scene.run(display.get(), warmup, frames);
+                            result.setupMilliseconds = setup;
+                        }
+                        // Release the scene before the next one is built.
+                        DeletionQueue::flush();
+                        std::cerr << std::left << std::setw(40) << desc.getName() << std::right << std::fixed
+                            << std::setprecision(3) << " cpu p50 " << result.cpuMilliseconds.p50 << " ms, frame p50 "
+                            << result.frameMilliseconds.p50 << " ms, p99 " << result.frameMilliseconds.p99 << " ms" << std::endl;
+                        results.push_back(result);
+                    }
+                }
+            }
+        }
+    }
+
+    if (outPath) {
+        std::ofstream out(outPath);
+        if (!out) {
+            std::cerr << "Cannot write " << outPath << std::endl;
+            return 1;
+        }
+        writeJson(out, results, backend, workers.getThreadCount(), frames, warmup);
+    }
+    else
+        writeJson(std::cout, results, backend, workers.getThreadCount(), frames, warmup);
+    return 0;
+}
@@ -0,0 +1,410 @@
+#include "BenchScene.h"
+#include "Display.h"
+#include "GLState.h"
+#include "GLDebug.h"
+#include "DeletionQueue.h"
+#include "MockGL.h"
+#include "CpuProfiler.h"
+#include "VertexLayout.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+
+const char* const benchMeshNames[3] = { "small", "medium", "large" };
+const char* const benchPatternNames[3] = { "uniform", "meshes", "programs" };
+const char* const benchDataNames[2] = { "static", "dynamic" };
+const char* const benchPathNames[3] = { "draws", "instanced", "lists" };
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+unsigned int getGridCells(BenchMesh mesh)
+{
+    return mesh == BenchMesh::Small ? 1 : mesh == BenchMesh::Medium ? 8 : 32;
+}
+
+// Deterministic, so every run shuffles objects the same way.
+uint32_t nextRandom(uint32_t& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+double milliseconds(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+}
+
+std::string BenchSceneDesc::getName() const
+{
+    return std::string(benchPathNames[(int)path]) + "/" + std::to_string(objects) + "/" + benchMeshNames[(int)mesh] + "/"
+        + benchPatternNames[(int)pattern] + "/" + benchDataNames[(int)data];
+}
+
+BenchPercentiles BenchPercentiles::compute(std::vector<double> samples)
+{
+    BenchPercentiles result;
+    if (samples.empty())
+        return result;
+    std::sort(samples.begin(), samples.end());
+    // Nearest rank.
+    auto rank = [&](double percentile) {
+        size_t index = (size_t)std::ceil(percentile / 100.0 * samples.size());
+        return samples[std::min(samples.size(), std::max<size_t>(index, 1)) - 1];
+    };
+    double total = 0.0;
+    for (double sample : samples)
+        total += sample;
+    result.mean = total / samples.size();
+    result.p50 = rank(50.0);
+    result.p90 = rank(90.0);
+    result.p99 = rank(99.0);
+    result.max = samples.back();
+    return result;
+}
+
+BenchScene::BenchScene(const BenchSceneDesc& desc, const ShaderSource& vertex, const ShaderSource& fragment,
+    WorkerPool* workers)
+    : desc(desc), trianglesPerMesh(0), workers(workers), renderer(&uniforms), cellSize(0.0f), frameDraws(0)
+{
+    ASSERT(workers || desc.path != BenchPath::Lists);
+    buildMeshes();
+    buildPrograms(vertex, fragment);
+    placeObjects();
+}
+
+void BenchScene::buildMeshes()
+{
+    const unsigned int maxMeshes = MaxMeshes;
+    const unsigned int meshCount = desc.pattern == BenchPattern::Uniform ? 1 : std::min(maxMeshes, desc.objects);
+    const unsigned int cells = getGridCells(desc.mesh);
+    const VertexLayoutDesc& layout = CompactVertexLayout::describe();
+    trianglesPerMesh = cells * cells * 2;
+
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    for (unsigned int mesh = 0; mesh < meshCount; mesh++) {
+        // Each mesh gets its own colour so the programs' output can be told apart.
+        float hue = (float)mesh / meshCount;
+        float colour[4] = { 0.5f + 0.5f * std::cos(6.2832f * hue), 0.5f + 0.5f * std::cos(6.2832f * (hue + 0.33f)),
+            0.5f + 0.5f * std::cos(6.2832f * (hue + 0.67f)), 1.0f };
+        vertices.clear();
+        indices.clear();
+        for (unsigned int y = 0; y <= cells; y++) {
+            for (unsigned int x = 0; x <= cells; x++) {
+                vertices.push_back((float)x / cells - 0.5f);
+                vertices.push_back((float)y / cells - 0.5f);
+                vertices.push_back(0.0f);
+                vertices.insert(vertices.end(), colour, colour + 4);
+            }
+        }
+        for (unsigned int y = 0; y < cells; y++) {
+            for (unsigned int x = 0; x < cells; x++) {
+                unsigned int corner = y * (cells + 1) + x;
+                unsigned int quad[6] = { corner, corner + 1, corner + cells + 2, corner, corner + cells + 2, corner + cells + 1 };
+                indices.insert(indices.end(), quad, quad + 6);
+            }
+        }
+
+        unsigned int vertexCount = (cells + 1) * (cells + 1);
+        std::vector<unsigned char> packed = CompactVertexLayout::pack(vertices.data(), vertexCount);
+        vertexBuffers.emplace_back(new VertexBuffer(&arena, packed.data(), (unsigned int)packed.size(), layout.stride));
+        elementBuffers.emplace_back(new ElementBuffer(&arena, indices.data(), (int)indices.size()));
+        meshObjects.emplace_back(new DrawObject(vertexBuffers.back().get(), elementBuffers.back().get(), layout));
+    }
+}
+
+void BenchScene::buildPrograms(const ShaderSource& vertex, const ShaderSource& fragment)
+{
+    const unsigned int maxPrograms = MaxPrograms;
+    const unsigned int programCount = desc.pattern == BenchPattern::Programs ? std::min(maxPrograms, desc.objects) : 1;
+    for (unsigned int i = 0; i < programCount; i++) {
+        std::vector<std::string> defines;
+        if (desc.path == BenchPath::Instanced)
+            defines.push_back("INSTANCED");
+        defines.push_back("BENCH_PROGRAM_" + std::to_string(i));
+        programs.emplace_back(new ShaderProgram(applyDefines(vertex, defines), fragment.text));
+    }
+}
+
+void BenchScene::placeObjects()
+{
+    const unsigned int side = (unsigned int)std::ceil(std::sqrt((double)desc.objects));
+    cellSize = 2.0f / side;
+    positions.resize(desc.objects * 2);
+    objectPrograms.resize(desc.objects);
+    objectMeshes.resize(desc.objects);
+    uint32_t random = 1;
+    for (unsigned int i = 0; i < desc.objects; i++) {
+        positions[i * 2 + 0] = -1.0f + (i % side + 0.5f) * cellSize;
+        positions[i * 2 + 1] = -1.0f + (i / side + 0.5f) * cellSize;
+        objectPrograms[i] = nextRandom(random) % programs.size();
+        objectMeshes[i] = nextRandom(random) % meshObjects.size();
+    }
+
+    if (desc.path != BenchPath::Instanced) {
+        constants.resize(desc.objects);
+        for (unsigned int i = 0; i < desc.objects; i++) {
+            float x, y, scale;
+            animate(i, 0.0, &x, &y, &scale);
+            constants[i] = { { {
+                scale, 0.0f, 0.0f, 0.0f,
+                0.0f, scale, 0.0f, 0.0f,
+                0.0f, 0.0f, scale, 0.0f,
+                x, y, 0.0f, 1.0f
+            } }, { 1.0f, 1.0f, 1.0f, 1.0f } };
+        }
+        if (desc.path == BenchPath::Lists) {
+            // Assignments never change, so objects are put in state order once
+            // here instead of sorting submissions every frame.
+            order.resize(desc.objects);
+            for (unsigned int i = 0; i < desc.objects; i++)
+                order[i] = i;
+            std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+                return objectPrograms[a] != objectPrograms[b] ? objectPrograms[a] < objectPrograms[b]
+                    : objectMeshes[a] < objectMeshes[b];
+            });
+            unsigned int listCount = 1 + (desc.objects + ListObjects - 1) / ListObjects;
+            for (unsigned int i = 0; i < listCount; i++)
+                lists.emplace_back(uniforms.getAlignment());
+        }
+        return;
+    }
+
+    // One instanced draw per program and mesh pair that has objects.
+    if (desc.data == BenchData::Dynamic && GLAD_GL_VERSION_4_2)
+        instanceStream.reset(new StreamingVertexBuffer(desc.objects * sizeof(InstanceData)));
+    std::vector<int> groupOf(programs.size() * meshObjects.size(), -1);
+    for (unsigned int i = 0; i < desc.objects; i++) {
+        int& group = groupOf[objectPrograms[i] * meshObjects.size() + objectMeshes[i]];
+        if (group < 0) {
+            group = (int)groups.size();
+            groups.emplace_back();
+            Group& added = groups.back();
+            added.program = objectPrograms[i];
+            added.mesh = objectMeshes[i];
+            added.object.reset(new DrawObject(vertexBuffers[added.mesh].get(), elementBuffers[added.mesh].get(),
+                CompactVertexLayout::describe()));
+            added.instances.reset(instanceStream ? new InstanceBuffer(instanceStream.get()) : new InstanceBuffer());
+            added.object->setInstanceBuffer(added.instances.get());
+        }
+        groups[group].members.push_back(i);
+    }
+    // Drawn grouped by program, as the Renderer would order them.
+    std::sort(groups.begin(), groups.end(), [](const Group& a, const Group& b) {
+        return a.program != b.program ? a.program < b.program : a.mesh < b.mesh;
+    });
+    // Dynamic instances are refilled every frame, inside the stream's frame.
+    if (desc.data == BenchData::Static) {
+        for (Group& group : groups)
+            fillInstances(group, 0.0);
+    }
+}
+
+void BenchScene::animate(unsigned int object, double time, float* x, float* y, float* scale) const
+{
+    *x = positions[object * 2 + 0];
+    *y = positions[object * 2 + 1];
+    *scale = cellSize * 0.8f;
+    if (desc.data == BenchData::Dynamic) {
+        float phase = (float)time * 2.0f + object * 0.37f;
+        *x += 0.1f * cellSize * std::sin(phase);
+        *y += 0.1f * cellSize * std::cos(phase);
+    }
+}
+
+void BenchScene::fillInstances(Group& group, double time)
+{
+    const float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    group.instances->clear();
+    group.instances->reserve((unsigned int)group.members.size());
+    for (unsigned int object : group.members) {
+        float x, y, scale;
+        animate(object, time, &x, &y, &scale);
+        group.instances->append(InstanceBuffer::translationScale(x, y, 0.0f, scale, white));
+    }
+    group.instances->upload();
+}
+
+void BenchScene::recordObjects(CommandList& list, unsigned int first, unsigned int last, double time)
+{
+    PROFILE_ZONE("BenchScene::recordObjects");
+    for (unsigned int i = first; i < last; i++) {
+        unsigned int object = order[i];
+        ObjectConstants* block = list.allocateConstants<ObjectConstants>(ObjectBlockBinding);
+        *block = constants[object];
+        if (desc.data == BenchData::Dynamic) {
+            float x, y, scale;
+            animate(object, time, &x, &y, &scale);
+            block->model.m[0] = block->model.m[5] = block->model.m[10] = scale;
+            block->model.m[12] = x;
+            block->model.m[13] = y;
+        }
+        list.bindProgram(programs[objectPrograms[object]]->getId());
+        list.draw(meshObjects[objectMeshes[object]].get());
+    }
+}
+
+void BenchScene::drawFrame(double time)
+{
+    frameDraws = 0;
+    uniforms.beginFrame();
+    unsigned int frameOffset;
+    FrameConstants* frame = uniforms.allocate<FrameConstants>(frameOffset);
+    frame->viewProjection = { {
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f
+    } };
+    frame->cameraPosition = { 0.0f, 0.0f, 2.0f, 1.0f };
+    frame->time = (float)time;
+    GLCall(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+    if (desc.path == BenchPath::Instanced) {
+        uniforms.upload();
+        uniforms.bind<FrameConstants>(FrameBlockBinding, frameOffset);
+        if (instanceStream)
+            instanceStream->beginFrame();
+        unsigned int program = 0xFFFFFFFFu;
+        for (Group& group : groups) {
+            if (desc.data == BenchData::Dynamic)
+                fillInstances(group, time);
+            if (group.program != program) {
+                program = group.program;
+                programs[program]->bind();
+            }
+            group.object->drawInstanced(group.instances->getCount());
+            frameDraws++;
+        }
+        return;
+    }
+
+    if (desc.path == BenchPath::Lists) {
+        // The frame block already sits in the ring at frameOffset. The first
+        // list is recorded over that range, so binding it copies nothing.
+        CommandList& frameList = lists[0];
+        frameList.reset(uniforms.getStagingData(frameOffset), sizeof(FrameConstants), frameOffset);
+        frameList.allocateConstants<FrameConstants>(FrameBlockBinding);
+        unsigned int objectLists = (unsigned int)lists.size() - 1;
+        // Every object list gets its exact share of the ring up front, so the
+        // workers write their blocks in place and execute() copies nothing.
+        // Staging pointers are taken after the last reserve() may have moved it.
+        const unsigned int alignment = uniforms.getAlignment();
+        const unsigned int blockBytes = (sizeof(ObjectConstants) + alignment - 1) / alignment * alignment;
+        listOffsets.resize(objectLists);
+        for (unsigned int i = 0; i < objectLists; i++) {
+            unsigned int first = i * ListObjects;
+            listOffsets[i] = uniforms.reserve((std::min(first + ListObjects, desc.objects) - first) * blockBytes);
+        }
+        std::function<void(unsigned int)> record = [&](unsigned int i) {
+            unsigned int first = i * ListObjects;
+            unsigned int last = std::min(first + ListObjects, desc.objects);
+            lists[i + 1].reset(uniforms.getStagingData(listOffsets[i]), (last - first) * blockBytes, listOffsets[i]);
+            recordObjects(lists[i + 1], first, last, time);
+        };
+        workers->run(objectLists, record);
+        renderer.execute(lists);
+    }
+    else {
+        // Static objects only copy their constants; dynamic ones recompute them.
+        offsets.resize(desc.objects);
+        for (unsigned int i = 0; i < desc.objects; i++) {
+            if (desc.data == BenchData::Dynamic) {
+                float x, y, scale;
+                animate(i, time, &x, &y, &scale);
+                float* model = constants[i].model.m;
+                model[0] = model[5] = model[10] = scale;
+                model[12] = x;
+                model[13] = y;
+            }
+            offsets[i] = uniforms.push(constants[i]);
+        }
+        uniforms.upload();
+        uniforms.bind<FrameConstants>(FrameBlockBinding, frameOffset);
+        for (unsigned int i = 0; i < desc.objects; i++)
+            renderer.submit(meshObjects[objectMeshes[i]].get(), programs[objectPrograms[i]]->getId(), offsets[i]);
+        renderer.flush();
+    }
+    frameDraws = renderer.getStats().commands;
+}
+
+BenchResult BenchScene::run(Display* display, unsigned int warmup, unsigned int frames)
+{
+    BenchResult result;
+    result.desc = desc;
+    result.frames = frames;
+    std::vector<double> cpu, frame;
+    cpu.reserve(frames);
+    frame.reserve(frames);
+
+    for (unsigned int i = 0; i < warmup + frames; i++) {
+        // Animation advances at a fixed 60 Hz so every run draws the same frames.
+        double time = i / 60.0;
+        if (!display && i == warmup)
+            MockGL::resetCounts();
+        GLState::resetStats();
+        auto start = Clock::now();
+        drawFrame(time);
+        auto submitted = Clock::now();
+        if (display)
+            display->present();
+        // Fenced after present, as UniformRing does, so the fence does not
+        // flush the frame's rendering inside drawFrame().
+        if (instanceStream)
+            instanceStream->endFrame();
+        DeletionQueue::endFrame();
+        arena.compact(ArenaCompactBudget);
+        GLDebugSink::drain();
+        auto end = Clock::now();
+        if (i < warmup)
+            continue;
+
+        cpu.push_back(milliseconds(start, submitted));
+        frame.push_back(milliseconds(start, end));
+        const GLStateStats& state = GLState::getStats();
+        result.calls.drawCalls += frameDraws;
+        result.calls.stateRequested += state.requested;
+        result.calls.stateForwarded += state.requested - state.skipped;
+        result.calls.programBinds += state.programBinds;
+        result.calls.vaoBinds += state.vertexArrayBinds;
+        result.calls.constantBinds += state.uniformBufferRangeBinds;
+    }
+    if (display) {
+        GLCall(glFinish());
+    }
+
+    double seconds = 0.0;
+    for (double milliseconds : frame)
+        seconds += milliseconds / 1000.0;
+    result.cpuMilliseconds = BenchPercentiles::compute(cpu);
+    result.frameMilliseconds = BenchPercentiles::compute(frame);
+    result.trianglesPerFrame = (double)desc.objects * trianglesPerMesh;
+    if (frames) {
+        result.drawCallsPerSecond = seconds > 0.0 ? result.calls.drawCalls / seconds : 0.0;
+        result.trianglesPerSecond = seconds > 0.0 ? result.trianglesPerFrame * frames / seconds : 0.0;
+        result.calls.drawCalls /= frames;
+        result.calls.stateRequested /= frames;
+        result.calls.stateForwarded /= frames;
+        result.calls.programBinds /= frames;
+        result.calls.vaoBinds /= frames;
+        result.calls.constantBinds /= frames;
+    }
+    if (!display && frames) {
+        // glGetError is left out: GLCall adds it around every call in debug builds only.
+        for (unsigned int i = 0; i < (unsigned int)MockCall::Count; i++) {
+            MockCall call = (MockCall)i;
+            uint64_t count = MockGL::getCallCount(call);
+            if (!count || call == MockCall::GetError)
+                continue;
+            result.glCalls += (double)count / frames;
+            result.glCallsByEntryPoint.push_back({ MockGL::getName(call), (double)count / frames });
+        }
+    }
+    return result;
+}
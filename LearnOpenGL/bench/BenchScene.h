@@ -0,0 +1,175 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Application.h"
+#include "CommandList.h"
+#include "BufferArena.h"
+#include "VertexBuffer.h"
+#include "ElementBuffer.h"
+#include "DrawObject.h"
+#include "InstanceBuffer.h"
+#include "StreamingVertexBuffer.h"
+#include "Renderer.h"
+#include "ShaderProgram.h"
+#include "ShaderSource.h"
+#include "UniformRing.h"
+#include "UniformBlocks.h"
+#include "WorkerPool.h"
+
+// Grid meshes of 1x1, 8x8 and 32x32 quads: 2, 128 and 2048 triangles.
+enum class BenchMesh { Small, Medium, Large };
+// How much state differs between objects: Uniform draws one mesh with one
+// program, Meshes spreads objects over MaxMeshes meshes, Programs also over
+// MaxPrograms programs. Assignments are shuffled, so the Renderer's sort has
+// to group them.
+enum class BenchPattern { Uniform, Meshes, Programs };
+// Static objects never move. Dynamic ones are animated, so their constants
+// or instances are recomputed and uploaded every frame.
+enum class BenchData { Static, Dynamic };
+// Draws: one Renderer submission per object. Instanced: one draw per
+// program and mesh pair with per-instance attributes. Lists: one draw per
+// object, recorded into CommandLists by a WorkerPool and replayed in order.
+enum class BenchPath { Draws, Instanced, Lists };
+
+// Names used on the command line and in reports, indexed by the enums.
+extern const char* const benchMeshNames[3];
+extern const char* const benchPatternNames[3];
+extern const char* const benchDataNames[2];
+extern const char* const benchPathNames[3];
+
+struct BenchSceneDesc
+{
+	unsigned int objects;
+	BenchMesh mesh;
+	BenchPattern pattern;
+	BenchData data;
+	BenchPath path;
+
+	// e.g. "draws/10000/small/programs/dynamic"
+	std::string getName() const;
+};
+
+struct BenchPercentiles
+{
+	double mean = 0.0;
+	double p50 = 0.0;
+	double p90 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+
+	static BenchPercentiles compute(std::vector<double> samples);
+};
+
+// Per-frame averages over the measured frames.
+struct BenchCallCounts
+{
+	double drawCalls = 0.0;
+	// Binds requested through GLState and the ones it forwarded to GL.
+	double stateRequested = 0.0;
+	double stateForwarded = 0.0;
+	// glUseProgram, glBindVertexArray and uniform glBindBufferRange calls that
+	// GLState forwarded, counted the same way on every path.
+	double programBinds = 0.0;
+	double vaoBinds = 0.0;
+	double constantBinds = 0.0;
+};
+
+struct BenchResult
+{
+	BenchSceneDesc desc;
+	unsigned int frames = 0;
+	double setupMilliseconds = 0.0;
+	// cpu covers building and submitting the frame, frame adds the present,
+	// which waits when the GPU falls more than two frames behind.
+	BenchPercentiles cpuMilliseconds;
+	BenchPercentiles frameMilliseconds;
+	double trianglesPerFrame = 0.0;
+	double drawCallsPerSecond = 0.0;
+	double trianglesPerSecond = 0.0;
+	BenchCallCounts calls;
+	// Only measured on MockGL: every GL call per frame, in total and by entry
+	// point.
+	double glCalls = 0.0;
+	std::vector<std::pair<std::string, double>> glCallsByEntryPoint;
+};
+
+class Display;
+
+// A procedurally generated scene. Objects are laid out on a grid covering the
+// view, each one a mesh drawn with a program and its own transform and colour.
+class BenchScene
+{
+private:
+	struct Group
+	{
+		unsigned int program;
+		unsigned int mesh;
+		std::unique_ptr<DrawObject> object;
+		std::unique_ptr<InstanceBuffer> instances;
+		std::vector<unsigned int> members;
+	};
+
+	BenchSceneDesc desc;
+	BufferArena arena;
+	std::vector<std::unique_ptr<VertexBuffer>> vertexBuffers;
+	std::vector<std::unique_ptr<ElementBuffer>> elementBuffers;
+	std::vector<std::unique_ptr<DrawObject>> meshObjects;
+	std::vector<std::unique_ptr<ShaderProgram>> programs;
+	unsigned int trianglesPerMesh;
+
+	// Per object: grid cell, program and mesh.
+	std::vector<float> positions;
+	std::vector<unsigned int> objectPrograms;
+	std::vector<unsigned int> objectMeshes;
+	std::vector<ObjectConstants> constants;
+	std::vector<unsigned int> offsets;
+	// Instanced path with dynamic data: every group's instances stream through
+	// this one buffer, fenced once per frame.
+	std::unique_ptr<StreamingVertexBuffer> instanceStream;
+	std::vector<Group> groups;
+	// Lists path: objects in program and mesh order, and one list for the
+	// frame's own blocks followed by one per ListObjects objects.
+	std::vector<unsigned int> order;
+	std::vector<CommandList> lists;
+	// Where each object list's blocks are reserved in the UniformRing.
+	std::vector<unsigned int> listOffsets;
+	WorkerPool* workers;
+
+	UniformRing uniforms;
+	Renderer renderer;
+	float cellSize;
+	// Draw calls issued by the last drawFrame().
+	unsigned int frameDraws;
+
+	void buildMeshes();
+	void buildPrograms(const ShaderSource& vertex, const ShaderSource& fragment);
+	void placeObjects();
+	void animate(unsigned int object, double time, float* x, float* y, float* scale) const;
+	void fillInstances(Group& group, double time);
+	// Appends the objects' blocks and draws to a list that has been reset.
+	void recordObjects(CommandList& list, unsigned int first, unsigned int last, double time);
+	void drawFrame(double time);
+public:
+	static const unsigned int MaxMeshes = 16;
+	static const unsigned int MaxPrograms = 4;
+	static const unsigned int ListObjects = 1024;
+	// Bytes the mesh arena may move per frame.
+	static const unsigned int ArenaCompactBudget = 64 * 1024;
+
+	// Sources are Shader.vs and Shader.fs; each program compiles them with a
+	// distinct define so they link to separate program objects. The Lists
+	// path records on workers, which it requires; the others ignore them.
+	BenchScene(const BenchSceneDesc& desc, const ShaderSource& vertex, const ShaderSource& fragment,
+		WorkerPool* workers);
+	~BenchScene() = default;
+
+	BenchScene(const BenchScene&) = delete;
+	BenchScene& operator=(const BenchScene&) = delete;
+
+	// Draws warmup frames, then measures frames more. A null display means
+	// MockGL is installed: nothing is presented and GL calls are counted.
+	BenchResult run(Display* display, unsigned int warmup, unsigned int frames);
+};
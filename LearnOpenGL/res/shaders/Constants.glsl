@@ -0,0 +1,13 @@
+// Uniform blocks mirrored by the C++ structs in UniformBlocks.h; keep both in step.
+layout (std140) uniform FrameConstants
+{
+   mat4 viewProjection;
+   vec4 cameraPosition;
+   float time;
+} frame;
+
+layout (std140) uniform ObjectConstants
+{
+   mat4 model;
+   vec4 colour;
+} object;
@@ -0,0 +1,9 @@
+#version 330 core
+
+flat in vec4 vertexColour;
+out vec4 outColor;
+
+void main()
+{
+   outColor = vertexColour;
+}
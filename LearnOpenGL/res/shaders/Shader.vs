@@ -0,0 +1,31 @@
+#version 330 core
+
+// BATCHED (--batch): per-object data is fetched from a texture buffer by draw id.
+// INSTANCED (--instanced): transform and colour come from per-instance attributes.
+#pragma keywords BATCHED INSTANCED
+#include "VertexInputs.glsl"
+#include "Constants.glsl"
+#if defined(BATCHED)
+layout (location = 2) in uint drawId;
+uniform samplerBuffer objects;
+#elif defined(INSTANCED)
+layout (location = 2) in mat4 instanceTransform;
+layout (location = 6) in vec4 instanceColour;
+#endif
+flat out vec4 vertexColour;
+
+void main()
+{
+#if defined(BATCHED)
+   vec4 transform = texelFetch(objects, int(drawId) * 2);
+   vec4 tint = texelFetch(objects, int(drawId) * 2 + 1);
+   gl_Position = frame.viewProjection * vec4(position * transform.w + transform.xyz, 1.0);
+   vertexColour = colour * tint;
+#elif defined(INSTANCED)
+   gl_Position = frame.viewProjection * instanceTransform * vec4(position, 1.0);
+   vertexColour = colour * instanceColour;
+#else
+   gl_Position = frame.viewProjection * object.model * vec4(position, 1.0);
+   vertexColour = colour * object.colour;
+#endif
+}
@@ -0,0 +1,3 @@
+// Attributes every vertex layout provides, see VertexLayout.h.
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec4 colour;
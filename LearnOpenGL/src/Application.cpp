@@ -1,4 +1,8 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
 
 #include "Application.h"
 #include "Display.h"
@@ -6,51 +10,65 @@
 #include "VertexBuffer.h"
 #include "ElementBuffer.h"
 #include "DrawObject.h"
-
-const std::string vertexShaderSource =
+#include "Renderer.h"
+#include "GLState.h"
+#include "GLDebug.h"
+#include "Benchmarks.h"
+#include "DrawBatch.h"
+#include "InstanceBuffer.h"
+#include "VertexLayout.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "DeletionQueue.h"
+#include "ShaderProgram.h"
+#include "ProgramBinaryCache.h"
+#include "ShaderBuildScheduler.h"
+#include "ShaderLibrary.h"
+#include "ShaderSource.h"
+#include "UniformRing.h"
+#include "UniformBlocks.h"
+#include "FramePacer.h"
+#include "GpuProfiler.h"
+#include "ChromeTrace.h"
+#include "CpuProfiler.h"
+
+// Drawn with while the real programs are still compiling. Only reads the position,
+// so it works with every vertex path. Kept here rather than in res/shaders so
+// something still draws when those files are missing or broken.
+const std::string fallbackVertexShaderSource =
 "#version 330 core\n"
 "\n"
 "layout (location = 0) in vec3 position;\n"
-"layout (location = 1) in vec4 colour;\n"
-"flat out vec4 vertexColour;\n"
 "\n"
 "void main()\n"
 "{\n"
-"   gl_Position = vec4(position.x, position.y, position.z, 1.0);\n"
-"   vertexColour = colour;"
+"   gl_Position = vec4(position, 1.0);\n"
 "}\0";
 
-const std::string fragmentShaderSource =
+const std::string fallbackFragmentShaderSource =
 "#version 330 core\n"
 "\n"
-"flat in vec4 vertexColour;\n"
 "out vec4 outColor;\n"
 "\n"
 "void main()\n"
 "{\n"
-"   outColor = vertexColour;\n"
+"   outColor = vec4(0.5, 0.5, 0.5, 1.0);\n"
 "}\0";
 
-//
-// Error checking functions.
-//
-
-void GLClearError()
+// Orthographic camera at (cameraX, 0) looking down -z that keeps the letters'
+// proportions: y spans [-1, 1] and x is scaled by the framebuffer's aspect ratio.
+static UniformMat4 makeViewProjection(int width, int height, float cameraX)
 {
-    while (auto error = glGetError())
-        if (!error) break;
+    float aspect = width > 0 && height > 0 ? (float)width / height : 1.0f;
+    UniformMat4 matrix = { {
+        1.0f / aspect, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        -cameraX / aspect, 0.0f, 0.0f, 1.0f
+    } };
+    return matrix;
 }
 
-bool GLLogCall()
-{
-    while (GLenum error = glGetError()) {
-        std::cerr << "[OpenGL Error] " << error << std::endl;
-        return false;
-    }
-    return true;
-}
-
-
 // Returns 0 if initialization failed, otherwise returns 1.
 static int initializeGLFW()
 {
@@ -61,6 +79,10 @@ static int initializeGLFW()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+    // The KHR_debug sink is installed in every build and is the only error
+    // report when GL_ERROR_CHECK is NONE; many drivers only feed it in a
+    // debug context.
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
@@ -68,53 +90,11 @@ static int initializeGLFW()
 }
 
 
-static unsigned int compileShader(const std::string& source, unsigned int type)
-{
-    GLCall(unsigned int id = glCreateShader(type));
-    const char* src = source.c_str();
-    GLCall(glShaderSource(id, 1, &src, nullptr));
-    GLCall(glCompileShader(id));
-
-    int result;
-    GLCall(glGetShaderiv(id, GL_COMPILE_STATUS, &result));
-    if (result == GL_FALSE) {
-        int length;
-        GLCall(glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length));
-        char* message = (char*) _malloca(length * sizeof(char));
-        std::cerr << "Failed to compile " << (type == GL_VERTEX_SHADER ? "vertex" : "fragment") << " shader!" << std::endl;
-        std::cerr << message << std::endl;
-        GLCall(glDeleteShader(id));
-        return 0;
-    }
-
-    return id;
-}
-
-
-static unsigned int createShader(const std::string& vertexShader, const std::string& fragmentShader)
-{
-    GLCall(unsigned int program = glCreateProgram());
-    unsigned int vs = compileShader(vertexShader, GL_VERTEX_SHADER);
-    unsigned int fs = compileShader(fragmentShader, GL_FRAGMENT_SHADER);
-
-    GLCall(glAttachShader(program, vs));
-    GLCall(glAttachShader(program, fs));
-    GLCall(glLinkProgram(program));
-    GLCall(glValidateProgram(program));
-
-    GLCall(glDeleteShader(vs));
-    GLCall(glDeleteShader(fs));
-
-    return program;
-}
-
-
-
 // Calls glDrawElements with the provided vao and ebo bound.
 static void printObject(unsigned int vao, unsigned int ebo, unsigned int* indices, int count)
 {
-    GLCall(glBindVertexArray(vao));
-    GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo));
+    GLState::bindVertexArray(vao);
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
     GLCall(glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, nullptr));
 }
 
@@ -125,18 +105,85 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 
 void processInput(const Display &display)
 {
+    PROFILE_ZONE("processInput");
+    if (display.isHeadless())
+        return;
     if (glfwGetKey(display.getWindow(), GLFW_KEY_ESCAPE) == GLFW_PRESS)
     {
         glfwSetWindowShouldClose(display.getWindow(), true);
     }
 }
 
-int main()
+int main(int argc, char** argv)
 {
-    if (!initializeGLFW())
+    bool benchGLCall = false;
+    bool benchIndices = false;
+    bool benchShaders = false;
+    bool benchCompile = false;
+    bool benchProfiler = false;
+    bool batch = false;
+    bool instanced = false;
+    bool meshlets = false;
+    SwapMode swapMode = SwapMode::VSync;
+    double frameLimit = 0.0;
+    bool profileGpu = false;
+    const char* tracePath = nullptr;
+    bool headless = false;
+    HeadlessSettings headlessSettings = { 0, "" };
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--bench-glcall") == 0)
+            benchGLCall = true;
+        else if (std::strcmp(argv[i], "--bench-indices") == 0)
+            benchIndices = true;
+        else if (std::strcmp(argv[i], "--bench-shaders") == 0)
+            benchShaders = true;
+        else if (std::strcmp(argv[i], "--bench-compile") == 0)
+            benchCompile = true;
+        else if (std::strcmp(argv[i], "--bench-profiler") == 0)
+            benchProfiler = true;
+        else if (std::strcmp(argv[i], "--batch") == 0)
+            batch = true;
+        else if (std::strcmp(argv[i], "--instanced") == 0)
+            instanced = true;
+        else if (std::strcmp(argv[i], "--meshlets") == 0)
+            meshlets = true;
+        else if (std::strcmp(argv[i], "--swap") == 0 && i + 1 < argc) {
+            i++;
+            if (std::strcmp(argv[i], "adaptive") == 0)
+                swapMode = SwapMode::Adaptive;
+            else if (std::strcmp(argv[i], "off") == 0)
+                swapMode = SwapMode::Off;
+            else
+                swapMode = SwapMode::VSync;
+        }
+        else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+            frameLimit = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--profile-gpu") == 0)
+            profileGpu = true;
+        else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            tracePath = argv[++i];
+        else if (std::strcmp(argv[i], "--headless") == 0 && i + 1 < argc) {
+            headless = true;
+            headlessSettings.frameCount = (unsigned int)std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+            headlessSettings.dumpPrefix = argv[++i];
+    }
+
+    if (benchIndices) {
+        runIndexConversionBenchmark(1 << 22);
+        return 0;
+    }
+    if (benchProfiler) {
+        runProfilerBenchmark(1 << 20);
+        return 0;
+    }
+
+    // --headless renders offscreen for a fixed number of frames, without GLFW.
+    if (!headless && !initializeGLFW())
         return 1;
 
-    Display display(800, 600, "LearnOpenGL");
+    Display display(800, 600, "LearnOpenGL", headless ? &headlessSettings : nullptr);
     display.createContext(framebuffer_size_callback);
     //GLFWwindow* window = glfwCreateWindow(800, 600, "LearnOpenGL", NULL, NULL);
     //if (window == NULL) {
@@ -147,11 +194,36 @@ int main()
     
  
     // Load OpenGL function pointers.
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    if (!gladLoadGLLoader((GLADloadproc)display.getProcAddressLoader())) {
         std::cerr << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    display.createFramebuffer();
     std::cout << glGetString(GL_VERSION) << std::endl;
+#ifdef _DEBUG
+    GLState::setValidation(true);
+#endif
+    if (!GLDebugSink::install((GLADloadproc)display.getProcAddressLoader()) && GL_ERROR_CHECK == GL_ERROR_CHECK_NONE)
+        std::cerr << "KHR_debug unavailable, OpenGL errors will not be reported" << std::endl;
+    if (!ShaderBuildScheduler::install((GLADloadproc)display.getProcAddressLoader()))
+        std::cout << "KHR_parallel_shader_compile unavailable, shaders compile on the render thread" << std::endl;
+
+    if (benchGLCall) {
+        runGLCallBenchmark(1000000);
+        return 0;
+    }
+    if (benchShaders) {
+        ShaderSource vertex, fragment;
+        if (loadShaderSource("res/shaders/Shader.vs", vertex) && loadShaderSource("res/shaders/Shader.fs", fragment))
+            runShaderCacheBenchmark(vertex.text, fragment.text, 50);
+        return 0;
+    }
+    if (benchCompile) {
+        ShaderSource vertex, fragment;
+        if (loadShaderSource("res/shaders/Shader.vs", vertex) && loadShaderSource("res/shaders/Shader.fs", fragment))
+            runParallelCompileBenchmark(vertex.text, fragment.text, 32);
+        return 0;
+    }
 
     // Setup data
     float vertices_t[] = {
@@ -234,36 +306,275 @@ int main()
     };
     GLCall(glClearColor(0.71f, 0.44f, 0.76f, 1.0f));
 
+    // Weld, reorder for the vertex cache and overdraw, and lay vertices out in fetch order.
+    OptimizerMesh t_mesh = { std::vector<unsigned char>((unsigned char*)vertices_t, (unsigned char*)vertices_t + sizeof(vertices_t)),
+        DefaultVertexLayout::stride, std::vector<uint32_t>(model_t, model_t + 12) };
+    OptimizerMesh f_mesh = { std::vector<unsigned char>((unsigned char*)vertices_f, (unsigned char*)vertices_f + sizeof(vertices_f)),
+        DefaultVertexLayout::stride, std::vector<uint32_t>(model_f, model_f + 18) };
+    for (OptimizerMesh* mesh : { &t_mesh, &f_mesh }) {
+        MeshOptimizerReport report = MeshOptimizer::optimize(*mesh);
+        std::cout << "Mesh: " << report.verticesBefore << " -> " << report.verticesAfter << " vertices, ACMR "
+            << report.before.acmr << " -> " << report.after.acmr << ", ATVR "
+            << report.before.atvr << " -> " << report.after.atvr << std::endl;
+    }
+
+    // Pack the float data down to 12 bytes per vertex.
+    const VertexLayoutDesc& layout = CompactVertexLayout::describe();
+    const unsigned int t_vertexCount = t_mesh.getVertexCount();
+    const unsigned int f_vertexCount = f_mesh.getVertexCount();
+    const unsigned int t_indexCount = (unsigned int)t_mesh.indices.size();
+    const unsigned int f_indexCount = (unsigned int)f_mesh.indices.size();
+    std::vector<unsigned char> packed_t = CompactVertexLayout::pack((const float*)t_mesh.vertices.data(), t_vertexCount);
+    std::vector<unsigned char> packed_f = CompactVertexLayout::pack((const float*)f_mesh.vertices.data(), f_vertexCount);
+
+    // Both letters are slices of one shared buffer, defragmented a little
+    // each frame once slices have been freed.
+    BufferArena arena(64 * 1024);
+    const unsigned int arenaCompactBudget = 16 * 1024;
+
     // T Buffer Object initialization
-    VertexBuffer t_vbo(vertices_t, sizeof(vertices_t));
-    ElementBuffer t_ebo(model_t, 12);
-    DrawObject t_object(&t_vbo, &t_ebo);
+    VertexBuffer t_vbo(&arena, packed_t.data(), (unsigned int)packed_t.size(), layout.stride);
+    ElementBuffer t_ebo(&arena, t_mesh.indices.data(), t_indexCount);
+    DrawObject t_object(&t_vbo, &t_ebo, layout);
     
     // F Buffer Object intialization
-    VertexBuffer f_vbo(vertices_f, sizeof(vertices_f));
-    ElementBuffer f_ebo(model_f, 18);
-    DrawObject f_object(&f_vbo, &f_ebo);
+    VertexBuffer f_vbo(&arena, packed_f.data(), (unsigned int)packed_f.size(), layout.stride);
+    ElementBuffer f_ebo(&arena, f_mesh.indices.data(), f_indexCount);
+    DrawObject f_object(&f_vbo, &f_ebo, layout);
+
+    // Register and compile shader. Programs are read from res/shaders and rebuilt
+    // when those files change. Linked programs are cached on disk, so later runs
+    // load the binaries instead of compiling GLSL. Builds run in the background;
+    // until one has linked its draws use the fallback program.
+    ProgramBinaryCache shaderCache("shadercache");
+    ShaderBuildScheduler shaders(&shaderCache);
+    ShaderLibrary library(shaders);
+    ShaderProgram fallbackShader(fallbackVertexShaderSource, fallbackFragmentShaderSource, &shaderCache);
+
+    // Camera and per-object constants, written once per frame into a uniform ring.
+    UniformRing uniforms;
+    Renderer renderer(&uniforms);
+
+    // Batched path: both letters packed into one buffer set, one multi-draw per frame.
+    DrawBatch letters(layout);
+
+    // One source pair for every draw path; BATCHED and INSTANCED select the
+    // vertex inputs, each variant compiling the first time it is drawn with.
+    // Draw ids and instance attributes come from buffers outside the layout.
+    const uint32_t instanceLocations = ((1u << InstanceBuffer::AttributeCount) - 1) << InstanceBuffer::FirstAttribute;
+    ShaderLibrary::Handle t_shader = library.load("res/shaders/Shader.vs", "res/shaders/Shader.fs", layout,
+        (1u << letters.getDrawIdLocation()) | instanceLocations);
+    uint64_t variant = 0;
+    if (batch) {
+        letters.add(packed_t.data(), t_vertexCount, t_mesh.indices.data(), t_indexCount);
+        letters.add(packed_f.data(), f_vertexCount, f_mesh.indices.data(), f_indexCount);
+        letters.build();
+        // objects is the only sampler, so reflection gives it unit 0, where draw() binds the buffer.
+        variant = library.keyword(t_shader, "BATCHED");
+    }
+
+    // Data the instanced and meshlet paths rewrite every frame, fenced once per frame.
+    std::unique_ptr<StreamingVertexBuffer> frameStream;
+
+    // Instanced path: a grid of letter copies, rebuilt every frame, one draw per letter.
+    // Both letters stream their instances through frameStream.
+    const unsigned int gridSize = 48;
+    std::unique_ptr<InstanceBuffer> t_instances, f_instances;
+    if (instanced) {
+        if (GLAD_GL_VERSION_4_2) {
+            frameStream.reset(new StreamingVertexBuffer(2 * gridSize * gridSize * sizeof(InstanceData)));
+            t_instances.reset(new InstanceBuffer(frameStream.get(), gridSize * gridSize));
+            f_instances.reset(new InstanceBuffer(frameStream.get(), gridSize * gridSize));
+        }
+        else {
+            t_instances.reset(new InstanceBuffer(gridSize * gridSize));
+            f_instances.reset(new InstanceBuffer(gridSize * gridSize));
+        }
+        t_object.setInstanceBuffer(t_instances.get());
+        f_object.setInstanceBuffer(f_instances.get());
+        variant = library.keyword(t_shader, "INSTANCED");
+    }
 
-    // Register and compile shader.
-    unsigned int t_shader = createShader(vertexShaderSource, fragmentShaderSource);
-    GLCall(glUseProgram(t_shader));
+    // Meshlet path: letters split into clusters, culled on the CPU, survivors drawn indirectly.
+    // The frustum comes from the camera each frame; the viewer sits on the +z side that
+    // the letters' counter-clockwise front faces point at.
+    MeshletSet t_meshlets((const float*)t_mesh.vertices.data(), DefaultVertexLayout::stride, t_vertexCount,
+        t_mesh.indices.data(), t_indexCount);
+    MeshletSet f_meshlets((const float*)f_mesh.vertices.data(), DefaultVertexLayout::stride, f_vertexCount,
+        f_mesh.indices.data(), f_indexCount);
+    if (meshlets && GLAD_GL_VERSION_4_3) {
+        // Room for every meshlet of both letters surviving the cull.
+        const unsigned int meshletCount = t_meshlets.getMeshletCount() + f_meshlets.getMeshletCount();
+        frameStream.reset(new StreamingVertexBuffer(meshletCount * sizeof(DrawBatch::DrawElementsIndirectCommand)));
+    }
+    float viewer[3] = { 0.0f, 0.0f, 2.0f };
+    float frustum[6][4];
+
+    // Frame pacing. The camera sway is simulated in fixed steps, independent of
+    // the frame rate, and interpolated between the last two steps for drawing.
+    if (display.setSwapMode(swapMode) != swapMode)
+        std::cout << "Adaptive vsync unavailable, using vsync" << std::endl;
+    FramePacer pacer;
+    pacer.setFrameLimit(frameLimit);
+    double simulationTime = 0.0;
+    float cameraX = 0.0f;
+    float previousCameraX = 0.0f;
+
+    // GPU timers per pass; --trace also keeps every result for a Chrome trace,
+    // together with the CPU zones.
+    GpuProfiler::setEnabled(profileGpu || tracePath);
+    GpuProfiler::setTracing(tracePath != nullptr);
+#if CPU_PROFILER
+    PROFILE_THREAD("Main");
+    CpuProfiler::setEnabled(tracePath != nullptr);
+#endif
 
     // Run the application loop.
+    unsigned int frame = 0;
     while (!display.shouldClose()) {
-        // input
+        // frame clock and input
+        unsigned int steps = pacer.beginFrame();
+        GpuProfiler::beginFrame();
         processInput(display);
 
-        // render
+        // simulation
+        for (unsigned int step = 0; step < steps; step++) {
+            PROFILE_ZONE("Simulation step");
+            previousCameraX = cameraX;
+            simulationTime += pacer.getFixedStep();
+            cameraX = 0.1f * (float)std::sin(simulationTime * 0.5);
+        }
+        float alpha = (float)pacer.getAlpha();
+        viewer[0] = previousCameraX + (cameraX - previousCameraX) * alpha;
+
+        // pick up shader builds that finished since the last frame and edited shader files
+        bool building = shaders.getPendingCount() > 0;
+        library.update();
+        if (building && shaders.getPendingCount() == 0)
+            std::cout << "Shader programs ready after " << frame << " frames, "
+                << library.getVariantCount() << " variants live" << std::endl;
+        frame++;
+
+        // per-frame and per-object constants: one copy into the uniform ring
+        int width = 0, height = 0;
+        display.getFramebufferSize(width, height);
+        uniforms.beginFrame();
+        unsigned int frameOffset;
+        FrameConstants* frameConstants = uniforms.allocate<FrameConstants>(frameOffset);
+        frameConstants->viewProjection = makeViewProjection(width, height, viewer[0]);
+        frameConstants->cameraPosition = { viewer[0], viewer[1], viewer[2], 1.0f };
+        frameConstants->time = (float)pacer.getSeconds();
+        MeshletSet::extractFrustumPlanes(frameConstants->viewProjection.m, frustum);
+        const ObjectConstants letterConstants = { { {
+            1.0f, 0.0f, 0.0f, 0.0f,
+            0.0f, 1.0f, 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f
+        } }, { 1.0f, 1.0f, 1.0f, 1.0f } };
+        unsigned int t_constants = uniforms.push(letterConstants);
+        unsigned int f_constants = uniforms.push(letterConstants);
+        uniforms.upload();
+        uniforms.bind<FrameConstants>(FrameBlockBinding, frameOffset);
+
+        // render, timed on the GPU when profiling
+        GpuProfiler::push("Frame");
+        GpuProfiler::push("Clear");
         GLCall(glClear(GL_COLOR_BUFFER_BIT));
-        t_object.draw();
-        f_object.draw();
+        GpuProfiler::pop();
+        if (batch) {
+            PROFILE_ZONE("Batch pass");
+            GPU_SCOPE("Batch pass");
+            library.getOr(t_shader, variant, fallbackShader).bind();
+            letters.draw();
+        }
+        else if (instanced) {
+            PROFILE_ZONE("Instanced pass");
+            GPU_SCOPE("Instanced pass");
+            const float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+            const float cell = 2.0f / gridSize;
+            t_instances->clear();
+            f_instances->clear();
+            for (unsigned int y = 0; y < gridSize; y++) {
+                for (unsigned int x = 0; x < gridSize; x++) {
+                    float cx = -1.0f + (x + 0.5f) * cell;
+                    float cy = -1.0f + (y + 0.5f) * cell;
+                    t_instances->append(InstanceBuffer::translationScale(cx, cy, 0.0f, cell * 0.5f, white));
+                    f_instances->append(InstanceBuffer::translationScale(cx, cy, 0.0f, cell * 0.5f, white));
+                }
+            }
+            if (frameStream)
+                frameStream->beginFrame();
+            t_instances->upload();
+            f_instances->upload();
+
+            library.getOr(t_shader, variant, fallbackShader).bind();
+            t_object.drawInstanced(t_instances->getCount());
+            f_object.drawInstanced(f_instances->getCount());
+        }
+        else if (meshlets) {
+            PROFILE_ZONE("Meshlet pass");
+            GPU_SCOPE("Meshlet pass");
+            library.getOr(t_shader, fallbackShader).bind();
+            t_meshlets.cull(frustum, viewer);
+            f_meshlets.cull(frustum, viewer);
+            if (frameStream)
+                frameStream->beginFrame();
+            uniforms.bind<ObjectConstants>(ObjectBlockBinding, t_constants);
+            t_meshlets.draw(t_object, frameStream.get());
+            uniforms.bind<ObjectConstants>(ObjectBlockBinding, f_constants);
+            f_meshlets.draw(f_object, frameStream.get());
+        }
+        else {
+            PROFILE_ZONE("Letters pass");
+            GPU_SCOPE("Letters pass");
+            unsigned int program = library.getOr(t_shader, fallbackShader).getId();
+            renderer.submit(&t_object, program, t_constants);
+            renderer.submit(&f_object, program, f_constants);
+            renderer.flush();
+        }
+        GpuProfiler::pop();
+
+        GLDebugSink::drain();
 
         // poll events
-        glfwSwapBuffers(display.getWindow());
-        glfwPollEvents();
+        pacer.beginPresent();
+        {
+            PROFILE_ZONE("Present");
+            display.present();
+        }
+        pacer.endFrame();
+        if (frameStream)
+            frameStream->endFrame();
+        DeletionQueue::endFrame();
+        arena.compact(arenaCompactBudget);
+        {
+            PROFILE_ZONE("Poll events");
+            display.pollEvents();
+        }
+        PROFILE_FRAME();
     }
-    GLCall(glDeleteProgram(t_shader));
-    
 
+    FrameTiming average = pacer.getAverage();
+    std::cout << "Last " << pacer.getHistoryCount() << " frames, ms: cpu " << average.cpu << ", present "
+        << average.present << ", frame " << average.frame << ", jitter " << average.jitter << std::endl;
+
+    if (GpuProfiler::isEnabled()) {
+        GpuProfiler::shutdown();
+        std::cout << "GPU scopes, ms (min / avg / max):" << std::endl;
+        for (const GpuScopeStats& scope : GpuProfiler::getStats())
+            std::cout << "  " << std::string(scope.depth * 2, ' ') << scope.name << ": " << scope.min << " / "
+                << scope.getAverage() << " / " << scope.max << " over " << scope.count << std::endl;
+        if (GpuProfiler::getDroppedFrames())
+            std::cout << "  " << GpuProfiler::getDroppedFrames() << " frames dropped, results not ready in time" << std::endl;
+    }
+    if (tracePath) {
+        ChromeTrace trace;
+#if CPU_PROFILER
+        CpuProfiler::exportTrace(trace);
+#endif
+        GpuProfiler::exportTrace(trace);
+        if (trace.write(tracePath))
+            std::cout << "Wrote " << trace.getEventCount() << " trace events to " << tracePath << std::endl;
+    }
     return 0;
 }
\ No newline at end of file
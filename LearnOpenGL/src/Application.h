@@ -2,11 +2,69 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+// Error checking policy for GLCall, chosen at compile time by defining
+// GL_ERROR_CHECK to one of:
+//   GL_ERROR_CHECK_FULL     glGetError before and after every call (debug default)
+//   GL_ERROR_CHECK_SAMPLED  glGetError after one in GL_ERROR_CHECK_SAMPLE_RATE calls
+//   GL_ERROR_CHECK_NONE     no per-call checking (release default); errors are
+//                           reported asynchronously through the KHR_debug sink
+#define GL_ERROR_CHECK_NONE 0
+#define GL_ERROR_CHECK_SAMPLED 1
+#define GL_ERROR_CHECK_FULL 2
+
+#ifndef GL_ERROR_CHECK
+#ifdef _DEBUG
+#define GL_ERROR_CHECK GL_ERROR_CHECK_FULL
+#else
+#define GL_ERROR_CHECK GL_ERROR_CHECK_NONE
+#endif
+#endif
+
+#ifndef GL_ERROR_CHECK_SAMPLE_RATE
+#define GL_ERROR_CHECK_SAMPLE_RATE 64
+#endif
+
+#if defined(_MSC_VER)
+#define DEBUG_BREAK() __debugbreak()
+#else
+#include <csignal>
+#define DEBUG_BREAK() std::raise(SIGTRAP)
+#endif
+
 // Credit to youtube.com/TheChernoProject for the error checking code.
-#define ASSERT(x) if (!(x)) __debugbreak();
-#define GLCall(x) GLClearError();\
+#define ASSERT(x) if (!(x)) DEBUG_BREAK();
+
+// Each policy is also available under its own name so they can be compared
+// side by side (see Benchmarks.cpp).
+#define GLCallFull(x) GLClearError();\
 	x;\
-	ASSERT(GLLogCall())
+	ASSERT(GLLogCall(#x, __FILE__, __LINE__))
+#define GLCallSampled(x) x;\
+	ASSERT(GLSampleCall(#x, __FILE__, __LINE__))
+#define GLCallNone(x) x
+
+#if GL_ERROR_CHECK == GL_ERROR_CHECK_FULL
+#define GLCall(x) GLCallFull(x)
+#elif GL_ERROR_CHECK == GL_ERROR_CHECK_SAMPLED
+#define GLCall(x) GLCallSampled(x)
+#else
+#define GLCall(x) GLCallNone(x)
+#endif
 
 void GLClearError();
-bool GLLogCall();
\ No newline at end of file
+bool GLLogCall(const char* function, const char* file, int line);
+// True if the current context advertises the extension.
+bool hasGLExtension(const char* name);
+
+extern unsigned int glErrorSampleCounter;
+
+// Only pays for glGetError once every GL_ERROR_CHECK_SAMPLE_RATE calls. GL errors
+// are sticky, so an error raised by an unchecked call is still caught, just
+// reported against a later call site.
+inline bool GLSampleCall(const char* function, const char* file, int line)
+{
+	if (++glErrorSampleCounter < GL_ERROR_CHECK_SAMPLE_RATE)
+		return true;
+	glErrorSampleCounter = 0;
+	return GLLogCall(function, file, line);
+}
@@ -0,0 +1,247 @@
+#include "Benchmarks.h"
+#include "Application.h"
+#include "GLState.h"
+#include "IndexConversion.h"
+#include "ShaderProgram.h"
+#include "ProgramBinaryCache.h"
+#include "ShaderBuildScheduler.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double nanosecondsPerIteration(Clock::time_point start, Clock::time_point end, unsigned int iterations)
+{
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+void printResult(const char* name, double nanoseconds, double baseline)
+{
+    std::cout << "  " << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(1)
+        << std::setw(10) << nanoseconds << " ns/call" << std::setw(10) << nanoseconds - baseline << " ns overhead" << std::endl;
+}
+
+}
+
+void runGLCallBenchmark(unsigned int iterations)
+{
+    unsigned int buffers[2];
+    glGenBuffers(2, buffers);
+    glFinish();
+
+    // Alternate between two buffers so every call really changes state.
+    auto noneStart = Clock::now();
+    for (unsigned int i = 0; i < iterations; i++) {
+        GLCallNone(glBindBuffer(GL_ARRAY_BUFFER, buffers[i & 1]));
+    }
+    auto noneEnd = Clock::now();
+
+    auto sampledStart = Clock::now();
+    for (unsigned int i = 0; i < iterations; i++) {
+        GLCallSampled(glBindBuffer(GL_ARRAY_BUFFER, buffers[i & 1]));
+    }
+    auto sampledEnd = Clock::now();
+
+    auto fullStart = Clock::now();
+    for (unsigned int i = 0; i < iterations; i++) {
+        GLCallFull(glBindBuffer(GL_ARRAY_BUFFER, buffers[i & 1]));
+    }
+    auto fullEnd = Clock::now();
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDeleteBuffers(2, buffers);
+    GLState::invalidate();
+
+    double none = nanosecondsPerIteration(noneStart, noneEnd, iterations);
+    double sampled = nanosecondsPerIteration(sampledStart, sampledEnd, iterations);
+    double full = nanosecondsPerIteration(fullStart, fullEnd, iterations);
+
+    std::cout << "GLCall policy cost (" << iterations << " x glBindBuffer, sample rate "
+        << GL_ERROR_CHECK_SAMPLE_RATE << "):" << std::endl;
+    printResult("none", none, none);
+    printResult("sampled", sampled, none);
+    printResult("full", full, none);
+}
+
+namespace {
+
+// Best of several runs, in GB/s of input indices.
+template<typename Function>
+double measureThroughput(Function function, size_t bytes)
+{
+    double best = 0.0;
+    for (int run = 0; run < 10; run++) {
+        auto start = Clock::now();
+        function();
+        auto end = Clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        double throughput = bytes / seconds / 1e9;
+        if (throughput > best)
+            best = throughput;
+    }
+    return best;
+}
+
+}
+
+void runIndexConversionBenchmark(unsigned int indexCount)
+{
+    std::vector<uint32_t> indices(indexCount);
+    for (unsigned int i = 0; i < indexCount; i++)
+        indices[i] = (i * 2654435761u) & 0xFF;
+    std::vector<uint16_t> out16(indexCount);
+    std::vector<uint8_t> out8(indexCount);
+    const size_t bytes = indexCount * sizeof(uint32_t);
+    volatile uint32_t sink = 0;
+
+    double reduce = measureThroughput([&]() { sink = sink + reduceIndexBits(indices.data(), indexCount); }, bytes);
+    double scalar16 = measureThroughput([&]() { convertIndices16Scalar(indices.data(), out16.data(), indexCount); }, bytes);
+    double simd16 = measureThroughput([&]() { convertIndices16(indices.data(), out16.data(), indexCount); }, bytes);
+    double scalar8 = measureThroughput([&]() { convertIndices8Scalar(indices.data(), out8.data(), indexCount); }, bytes);
+    double simd8 = measureThroughput([&]() { convertIndices8(indices.data(), out8.data(), indexCount); }, bytes);
+
+    std::cout << "Index conversion (" << indexCount << " indices, GB/s of 32-bit input):" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  range scan       " << std::setw(8) << reduce << std::endl;
+    std::cout << "  32->16 scalar    " << std::setw(8) << scalar16 << std::endl;
+    std::cout << "  32->16 kernel    " << std::setw(8) << simd16 << std::endl;
+    std::cout << "  32->8  scalar    " << std::setw(8) << scalar8 << std::endl;
+    std::cout << "  32->8  kernel    " << std::setw(8) << simd8 << std::endl;
+}
+
+void runShaderCacheBenchmark(const std::string& vertexSource, const std::string& fragmentSource, unsigned int iterations)
+{
+    ProgramBinaryCache cache("shadercache-bench");
+    if (!cache.isSupported()) {
+        std::cout << "Program binaries are not supported by this context" << std::endl;
+        return;
+    }
+
+    double cold = 0.0;
+    double warm = 0.0;
+    unsigned int failures = 0;
+    // The run id keeps driver caches from earlier runs out of the cold numbers.
+    const std::string run = std::to_string(Clock::now().time_since_epoch().count());
+    for (unsigned int i = 0; i < iterations; i++) {
+        std::string source = vertexSource + "\n// benchmark " + run + " " + std::to_string(i) + "\n";
+        ShaderProgram compiled(source, fragmentSource, &cache);
+        ShaderProgram loaded(source, fragmentSource, &cache);
+        if (compiled.wasLoadedFromCache() || !loaded.wasLoadedFromCache())
+            failures++;
+        cold += compiled.getLoadMicroseconds();
+        warm += loaded.getLoadMicroseconds();
+    }
+
+    std::cout << "Shader program load (" << iterations << " programs, ms each):" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "  cold (compile)   " << std::setw(8) << cold / iterations / 1000.0 << std::endl;
+    std::cout << "  warm (binary)    " << std::setw(8) << warm / iterations / 1000.0 << std::endl;
+    if (failures)
+        std::cout << "  " << failures << " iterations did not hit the expected cache path" << std::endl;
+}
+
+void runParallelCompileBenchmark(const std::string& vertexSource, const std::string& fragmentSource, unsigned int count)
+{
+    // Distinct sources so neither the driver's shader cache nor the second
+    // pass can reuse work from the first.
+    const std::string run = std::to_string(Clock::now().time_since_epoch().count());
+    auto tagged = [&](const char* pass, unsigned int i) {
+        return vertexSource + "\n// " + pass + " " + run + " " + std::to_string(i) + "\n";
+    };
+
+    auto serialStart = Clock::now();
+    {
+        std::vector<std::unique_ptr<ShaderProgram>> programs;
+        for (unsigned int i = 0; i < count; i++)
+            programs.emplace_back(new ShaderProgram(tagged("serial", i), fragmentSource));
+    }
+    double serial = std::chrono::duration<double, std::milli>(Clock::now() - serialStart).count();
+
+    auto parallelStart = Clock::now();
+    double submitted = 0.0;
+    unsigned int polls = 0;
+    {
+        ShaderBuildScheduler scheduler;
+        for (unsigned int i = 0; i < count; i++)
+            scheduler.submit(tagged("parallel", i), fragmentSource);
+        submitted = std::chrono::duration<double, std::milli>(Clock::now() - parallelStart).count();
+        while (scheduler.poll() > 0)
+            polls++;
+    }
+    double parallel = std::chrono::duration<double, std::milli>(Clock::now() - parallelStart).count();
+
+    std::cout << "Program builds (" << count << " programs, "
+        << (ShaderBuildScheduler::isParallel() ? "KHR_parallel_shader_compile" : "no parallel compile") << "):" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  serial total     " << std::setw(8) << serial << " ms" << std::endl;
+    std::cout << "  scheduled total  " << std::setw(8) << parallel << " ms" << std::endl;
+    std::cout << "  submit only      " << std::setw(8) << submitted << " ms (" << polls << " polls until done)" << std::endl;
+}
+
+void runProfilerBenchmark(unsigned int iterations)
+{
+#if CPU_PROFILER
+    volatile unsigned int sink = 0;
+    auto emptyStart = Clock::now();
+    for (unsigned int i = 0; i < iterations; i++)
+        sink = sink + i;
+    double empty = nanosecondsPerIteration(emptyStart, Clock::now(), iterations);
+
+    bool wasEnabled = CpuProfiler::isEnabled();
+    CpuProfiler::setEnabled(true);
+    auto zone = [&]() {
+        for (unsigned int i = 0; i < iterations; i++) {
+            PROFILE_ZONE("benchmark");
+            sink = sink + i;
+        }
+    };
+    // No frames are marked here, so every thread reserves all of its zones
+    // before the clock starts.
+    CpuProfiler::reserve(iterations);
+    auto singleStart = Clock::now();
+    zone();
+    double single = nanosecondsPerIteration(singleStart, Clock::now(), iterations);
+
+    const unsigned int threadCount = std::max(2u, std::thread::hardware_concurrency());
+    std::vector<std::thread> threads;
+    std::atomic<unsigned int> ready{ 0 };
+    std::atomic<bool> go{ false };
+    for (unsigned int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&]() {
+            CpuProfiler::reserve(iterations);
+            ready.fetch_add(1);
+            while (!go.load())
+                std::this_thread::yield();
+            zone();
+        });
+    }
+    while (ready.load() < threadCount)
+        std::this_thread::yield();
+    auto parallelStart = Clock::now();
+    go.store(true);
+    for (std::thread& thread : threads)
+        thread.join();
+    double parallel = nanosecondsPerIteration(parallelStart, Clock::now(), iterations);
+    CpuProfiler::setEnabled(wasEnabled);
+
+    std::cout << "CPU profiler zones (" << iterations << " per thread):" << std::endl;
+    printResult("1 thread", single, empty);
+    std::cout << "  " << threadCount << " threads: " << std::fixed << std::setprecision(1) << parallel
+        << " ns per zone per thread (wall time)" << std::endl;
+    if (CpuProfiler::getDroppedZones())
+        std::cout << "  " << CpuProfiler::getDroppedZones() << " zones dropped, buffers full" << std::endl;
+#else
+    (void)iterations;
+    std::cout << "CPU profiler compiled out (CPU_PROFILER=0)" << std::endl;
+#endif
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+
+// Microbenchmarks. Results are printed to stdout.
+
+// Per-call cost of each GLCall error checking policy, measured on a cheap
+// state-changing call. Needs a current GL context.
+void runGLCallBenchmark(unsigned int iterations);
+
+// Throughput of the 32 -> 16 and 32 -> 8 bit index narrowing kernels against
+// plain loops. CPU only.
+void runIndexConversionBenchmark(unsigned int indexCount);
+
+// Program creation time with a cold binary cache (GLSL compile and link plus
+// the binary store) against a warm one (binary load only). Each iteration
+// tags the source with a comment so driver-side shader caches miss too.
+// Needs a current GL context.
+void runShaderCacheBenchmark(const std::string& vertexSource, const std::string& fragmentSource, unsigned int iterations);
+
+// Builds count distinct programs one after another with synchronous status
+// checks, then submits the same number through a ShaderBuildScheduler and
+// polls until all have linked. Reports total time and how long the submitting
+// thread was busy. Needs a current GL context; call
+// ShaderBuildScheduler::install first to use KHR_parallel_shader_compile.
+void runParallelCompileBenchmark(const std::string& vertexSource, const std::string& fragmentSource, unsigned int count);
+
+// Cost of one PROFILE_ZONE while recording, on one thread and on several at
+// once, against an empty loop. CPU only.
+void runProfilerBenchmark(unsigned int iterations);
@@ -0,0 +1,171 @@
+#include "BufferArena.h"
+#include "GLState.h"
+#include "DeletionQueue.h"
+
+BufferArena::BufferArena(unsigned int pageSize)
+    : pageSize(pageSize), liveAllocations(0), scratchBufferID(0), scratchSize(0), bytesMoved(0),
+    fragmented(false)
+{
+}
+
+BufferArena::~BufferArena()
+{
+    // Slices still waiting to be freed die with their pages.
+    DeletionQueue::forgetArena(this);
+    for (Page& page : pages)
+        DeletionQueue::deleteBuffer(page.bufferID);
+    DeletionQueue::deleteBuffer(scratchBufferID);
+}
+
+unsigned int BufferArena::addPage(unsigned int size)
+{
+    Page page;
+    GLCall(glGenBuffers(1, &page.bufferID));
+    // Uploads go through GL_COPY_WRITE_BUFFER so they never touch the element
+    // array binding of whatever VAO is bound.
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, page.bufferID);
+    GLCall(glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW));
+    page.allocator.reset(new TlsfAllocator(size, 4));
+    pages.push_back(std::move(page));
+    return (unsigned int)pages.size() - 1;
+}
+
+void BufferArena::place(unsigned int page, uint32_t block, unsigned int handle)
+{
+    Allocation& allocation = allocations[handle];
+    TlsfAllocator& allocator = *pages[page].allocator;
+    unsigned int start = allocator.getOffset(block);
+    allocation.page = page;
+    allocation.block = block;
+    allocation.offset = (start + allocation.alignment - 1) / allocation.alignment * allocation.alignment;
+    allocator.setUserData(block, handle);
+}
+
+unsigned int BufferArena::allocate(unsigned int size, unsigned int alignment, const void* data)
+{
+    if (alignment == 0)
+        alignment = 1;
+    // The allocator only aligns to 4, so over-allocate for anything else and
+    // round the offset up inside the block.
+    unsigned int reserve = size + (4 % alignment ? alignment - 1 : 0);
+
+    unsigned int page = 0;
+    uint32_t block = TlsfAllocator::InvalidBlock;
+    for (; page < pages.size(); page++) {
+        block = pages[page].allocator->allocate(reserve);
+        if (block != TlsfAllocator::InvalidBlock)
+            break;
+    }
+    if (block == TlsfAllocator::InvalidBlock) {
+        page = addPage(reserve > pageSize ? reserve : pageSize);
+        block = pages[page].allocator->allocate(reserve);
+        if (block == TlsfAllocator::InvalidBlock)
+            return InvalidHandle;
+    }
+
+    unsigned int handle;
+    if (!freeHandles.empty()) {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    }
+    else {
+        handle = (unsigned int)allocations.size();
+        allocations.emplace_back();
+    }
+    allocations[handle].size = size;
+    allocations[handle].alignment = alignment;
+    place(page, block, handle);
+    liveAllocations++;
+
+    if (data) {
+        GLState::bindBuffer(GL_COPY_WRITE_BUFFER, pages[page].bufferID);
+        GLCall(glBufferSubData(GL_COPY_WRITE_BUFFER, allocations[handle].offset, size, data));
+    }
+    return handle;
+}
+
+void BufferArena::free(unsigned int handle)
+{
+    Allocation& allocation = allocations[handle];
+    pages[allocation.page].allocator->free(allocation.block);
+    allocation.block = TlsfAllocator::InvalidBlock;
+    freeHandles.push_back(handle);
+    liveAllocations--;
+    fragmented = true;
+}
+
+// Copies within one buffer through a scratch buffer, since glCopyBufferSubData
+// does not allow overlapping source and destination ranges.
+void BufferArena::copy(unsigned int page, unsigned int from, unsigned int to, unsigned int size)
+{
+    if (size > scratchSize) {
+        if (!scratchBufferID) {
+            GLCall(glGenBuffers(1, &scratchBufferID));
+        }
+        scratchSize = size;
+        GLState::bindBuffer(GL_COPY_WRITE_BUFFER, scratchBufferID);
+        GLCall(glBufferData(GL_COPY_WRITE_BUFFER, scratchSize, nullptr, GL_STREAM_COPY));
+    }
+    GLState::bindBuffer(GL_COPY_READ_BUFFER, pages[page].bufferID);
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, scratchBufferID);
+    GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from, 0, size));
+    GLState::bindBuffer(GL_COPY_READ_BUFFER, scratchBufferID);
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, pages[page].bufferID);
+    GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, to, size));
+}
+
+unsigned int BufferArena::compact(unsigned int byteBudget)
+{
+    // Nothing has been freed since the last pass that got through every page.
+    if (!fragmented)
+        return 0;
+    unsigned int moved = 0;
+    for (unsigned int page = 0; page < pages.size() && moved < byteBudget; page++) {
+        TlsfAllocator& allocator = *pages[page].allocator;
+
+        // Walk used blocks from the top of the page down, moving each into the
+        // lowest free block below it that can hold it.
+        uint32_t block = allocator.getLastUsed();
+        while (block != TlsfAllocator::InvalidBlock && moved < byteBudget) {
+            uint32_t previous = allocator.getPreviousUsed(block);
+            unsigned int handle = allocator.getUserData(block);
+            Allocation& allocation = allocations[handle];
+            unsigned int reserve = allocator.getSize(block);
+
+            uint32_t target = allocator.findLowestFree(reserve, allocator.getOffset(block));
+            if (target != TlsfAllocator::InvalidBlock) {
+                unsigned int oldOffset = allocation.offset;
+                uint32_t newBlock = allocator.allocateFrom(target, reserve);
+                place(page, newBlock, handle);
+                copy(page, oldOffset, allocation.offset, allocation.size);
+                allocator.free(block);
+                moved += allocation.size;
+            }
+            block = previous;
+        }
+    }
+    if (moved < byteBudget)
+        fragmented = false;
+    bytesMoved += moved;
+    return moved;
+}
+
+BufferArenaStats BufferArena::getStats() const
+{
+    BufferArenaStats stats;
+    stats.pages = (unsigned int)pages.size();
+    stats.allocations = liveAllocations;
+    stats.bytesMoved = bytesMoved;
+    for (const Page& page : pages) {
+        TlsfStats pageStats = page.allocator->getStats();
+        stats.capacity += pageStats.capacity;
+        stats.used += pageStats.used;
+        stats.free += pageStats.free;
+        stats.freeBlocks += pageStats.freeBlocks;
+        if (pageStats.largestFree > stats.largestFree)
+            stats.largestFree = pageStats.largestFree;
+        if (pageStats.fragmentation > stats.fragmentation)
+            stats.fragmentation = pageStats.fragmentation;
+    }
+    return stats;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "Application.h"
+#include "TlsfAllocator.h"
+
+struct BufferArenaStats
+{
+	unsigned int pages = 0;
+	unsigned int allocations = 0;
+	unsigned int capacity = 0;
+	unsigned int used = 0;
+	unsigned int free = 0;
+	unsigned int largestFree = 0;
+	unsigned int freeBlocks = 0;
+	// Worst page: 1 - largestFree / free.
+	float fragmentation = 0.0f;
+	unsigned int bytesMoved = 0;
+};
+
+// Reserves large GL buffers ("pages") and hands out offset/size slices of them
+// through a TlsfAllocator, so many small meshes share a handful of buffer
+// objects. Slices are referred to by handle; the buffer and offset behind a
+// handle must be looked up at draw time because compact() may move it.
+class BufferArena
+{
+public:
+	static const unsigned int InvalidHandle = 0xFFFFFFFFu;
+private:
+	struct Page
+	{
+		unsigned int bufferID;
+		std::unique_ptr<TlsfAllocator> allocator;
+	};
+	struct Allocation
+	{
+		unsigned int page;
+		uint32_t block;
+		unsigned int offset;
+		unsigned int size;
+		unsigned int alignment;
+	};
+
+	std::vector<Page> pages;
+	std::vector<Allocation> allocations;
+	std::vector<unsigned int> freeHandles;
+	unsigned int pageSize;
+	unsigned int liveAllocations;
+	unsigned int scratchBufferID;
+	unsigned int scratchSize;
+	unsigned int bytesMoved;
+	// Set by free() and cleared once compact() finishes a pass within budget.
+	bool fragmented;
+
+	unsigned int addPage(unsigned int size);
+	void place(unsigned int page, uint32_t block, unsigned int handle);
+	void copy(unsigned int page, unsigned int from, unsigned int to, unsigned int size);
+public:
+	BufferArena(unsigned int pageSize = 4 * 1024 * 1024);
+	~BufferArena();
+
+	BufferArena(const BufferArena&) = delete;
+	BufferArena& operator=(const BufferArena&) = delete;
+
+	// Reserves size bytes with the offset a multiple of alignment (which does not
+	// have to be a power of two, so a vertex stride works) and uploads data if
+	// it is not null.
+	unsigned int allocate(unsigned int size, unsigned int alignment, const void* data);
+	void free(unsigned int handle);
+
+	// Moves allocations towards the start of their page, copying at most
+	// byteBudget bytes. Meant to be called once per frame with a small budget
+	// so defragmentation runs in the background of normal rendering; it
+	// returns at once while nothing has been freed. Returns the number of
+	// bytes moved.
+	unsigned int compact(unsigned int byteBudget);
+
+	inline unsigned int getBufferId(unsigned int handle) const { return pages[allocations[handle].page].bufferID; };
+	inline unsigned int getOffset(unsigned int handle) const { return allocations[handle].offset; };
+	inline unsigned int getSize(unsigned int handle) const { return allocations[handle].size; };
+	BufferArenaStats getStats() const;
+};
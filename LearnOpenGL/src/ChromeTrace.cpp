@@ -0,0 +1,68 @@
+#include "ChromeTrace.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+void writeString(std::ostream& out, const char* text)
+{
+    out << '"';
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\')
+            out << '\\' << *c;
+        else if ((unsigned char)*c < 0x20)
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)*c << std::dec << std::setfill(' ');
+        else
+            out << *c;
+    }
+    out << '"';
+}
+
+}
+
+void ChromeTrace::setThreadName(unsigned int thread, const std::string& name)
+{
+    for (auto& entry : threadNames) {
+        if (entry.first == thread) {
+            entry.second = name;
+            return;
+        }
+    }
+    threadNames.emplace_back(thread, name);
+}
+
+void ChromeTrace::append(const std::vector<TraceEvent>& more)
+{
+    events.insert(events.end(), more.begin(), more.end());
+}
+
+bool ChromeTrace::write(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cerr << "Cannot write trace " << path << std::endl;
+        return false;
+    }
+
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& entry : threadNames) {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << entry.first
+            << ",\"args\":{\"name\":";
+        writeString(out, entry.second.c_str());
+        out << "}}";
+        first = false;
+    }
+    out << std::fixed << std::setprecision(3);
+    for (const TraceEvent& event : events) {
+        out << (first ? "" : ",\n") << "{\"name\":";
+        writeString(out, event.name);
+        out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << event.start
+            << ",\"dur\":" << event.duration << "}";
+        first = false;
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return (bool)out;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// A complete ("ph":"X") event. Times are microseconds on the
+// std::chrono::steady_clock timeline, so CPU and GPU events line up.
+struct TraceEvent
+{
+	// Must outlive the trace; scope names are string literals.
+	const char* name;
+	double start;
+	double duration;
+	unsigned int thread;
+};
+
+// Collects events from the profilers and writes them in the Chrome trace
+// event format, for chrome://tracing or https://ui.perfetto.dev.
+class ChromeTrace
+{
+private:
+	std::vector<std::pair<unsigned int, std::string>> threadNames;
+	std::vector<TraceEvent> events;
+public:
+	void setThreadName(unsigned int thread, const std::string& name);
+	inline void add(const TraceEvent& event) { events.push_back(event); };
+	void append(const std::vector<TraceEvent>& more);
+
+	// Returns false and prints the reason if the file cannot be written.
+	bool write(const std::string& path) const;
+
+	inline size_t getEventCount() const { return events.size(); };
+};
@@ -0,0 +1,81 @@
+#include "CommandList.h"
+
+#include <cstring>
+#include <utility>
+
+CommandList::CommandList(unsigned int constantAlignment)
+    : commands(16 * 1024), ownCapacity(0), constants(nullptr), constantBytes(0), constantCapacity(0),
+    constantAlignment(constantAlignment > 0 ? constantAlignment : 1), ringOffset(NotInRing), commandCount(0), program(0)
+{
+}
+
+void CommandList::reset()
+{
+    reset(ownConstants.get(), ownCapacity, NotInRing);
+}
+
+void CommandList::reset(unsigned char* storage, unsigned int capacity, unsigned int ringOffset)
+{
+    commands.reset();
+    constants = storage;
+    constantCapacity = capacity;
+    constantBytes = 0;
+    this->ringOffset = ringOffset;
+    commandCount = 0;
+    program = 0;
+}
+
+unsigned int CommandList::pushConstants(const void* data, unsigned int size)
+{
+    // The list's blocks land in the UniformRing at an aligned base, so offsets
+    // aligned here stay aligned there.
+    unsigned int offset = (constantBytes + constantAlignment - 1) / constantAlignment * constantAlignment;
+    if (offset + size > constantCapacity) {
+        // Out of room, in the ring's range or our own buffer: continue in a
+        // larger own buffer.
+        unsigned int capacity = ownCapacity ? ownCapacity : 4096;
+        while (capacity < offset + size)
+            capacity *= 2;
+        if (capacity > ownCapacity) {
+            std::unique_ptr<unsigned char[]> grown(new unsigned char[capacity]);
+            if (constantBytes)
+                std::memcpy(grown.get(), constants, constantBytes);
+            ownConstants = std::move(grown);
+            ownCapacity = capacity;
+        }
+        else if (constantBytes) {
+            std::memcpy(ownConstants.get(), constants, constantBytes);
+        }
+        constants = ownConstants.get();
+        constantCapacity = ownCapacity;
+        ringOffset = NotInRing;
+    }
+    constantBytes = offset + size;
+    if (data)
+        std::memcpy(constants + offset, data, size);
+    return offset;
+}
+
+void CommandList::bindProgram(unsigned int program)
+{
+    if (commandCount && program == this->program)
+        return;
+    this->program = program;
+    append<BindProgramCommand>(CommandType::BindProgram)->program = program;
+}
+
+void CommandList::bindConstants(unsigned int binding, const void* data, unsigned int size)
+{
+    unsigned int offset = pushConstants(data, size);
+    BindConstantsCommand* command = append<BindConstantsCommand>(CommandType::BindConstants);
+    command->binding = binding;
+    command->offset = offset;
+    command->size = size;
+}
+
+void CommandList::draw(DrawObject* object, unsigned int instances)
+{
+    DrawCommand* command = append<DrawCommand>(instances ? CommandType::DrawInstanced : CommandType::Draw);
+    command->object = object;
+    command->instances = instances;
+}
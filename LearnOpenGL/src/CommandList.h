@@ -0,0 +1,157 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "LinearAllocator.h"
+
+class DrawObject;
+
+enum class CommandType : uint32_t
+{
+	BindProgram,
+	BindConstants,
+	Draw,
+	DrawInstanced
+};
+
+// Every command starts with its header; size covers the whole command.
+struct CommandHeader
+{
+	CommandType type;
+	uint32_t size;
+};
+
+struct BindProgramCommand
+{
+	CommandHeader header;
+	unsigned int program;
+};
+
+// offset is relative to the list's constant blocks until it is replayed.
+struct BindConstantsCommand
+{
+	CommandHeader header;
+	unsigned int binding;
+	unsigned int offset;
+	unsigned int size;
+};
+
+struct DrawCommand
+{
+	CommandHeader header;
+	DrawObject* object;
+	unsigned int instances;
+};
+
+// A frame's draws, binds and constant block updates, recorded without a GL
+// context so any thread can fill one. Commands go to the list's own
+// LinearAllocator; constant blocks are packed at the uniform buffer offset
+// alignment. They are written either straight into a range the GL thread
+// reserved in the UniformRing beforehand, so replay copies nothing, or into the
+// list's own buffer, which replay hands to the ring with a single push.
+// Renderer::execute() replays lists on the GL thread in the order given.
+//
+// A list is used by one thread at a time. Recording again after reset()
+// reuses the previous frame's memory.
+class CommandList
+{
+private:
+	// Every command is placed at this alignment so they can be walked in order.
+	static const size_t CommandAlignment = 8;
+
+	static const unsigned int NotInRing = 0xFFFFFFFFu;
+
+	LinearAllocator commands;
+	// Grown by hand so new blocks are not zeroed before they are written.
+	std::unique_ptr<unsigned char[]> ownConstants;
+	unsigned int ownCapacity;
+	// Where blocks go: ownConstants, or the UniformRing range given to reset().
+	unsigned char* constants;
+	unsigned int constantBytes;
+	unsigned int constantCapacity;
+	unsigned int constantAlignment;
+	// Offset of constants in the UniformRing's staging area, or NotInRing.
+	unsigned int ringOffset;
+	unsigned int commandCount;
+	unsigned int program;
+
+	template<typename T>
+	T* append(CommandType type);
+	unsigned int pushConstants(const void* data, unsigned int size);
+public:
+	// constantAlignment is the UniformRing's, GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+	CommandList(unsigned int constantAlignment = 256);
+	~CommandList() = default;
+
+	CommandList(CommandList&&) = default;
+	CommandList& operator=(CommandList&&) = default;
+
+	void reset();
+	// Like reset(), but blocks are written to storage, capacity bytes that
+	// UniformRing::reserve() returned ringOffset for. A list that outgrows
+	// them moves its blocks to its own buffer and is pushed on replay.
+	void reset(unsigned char* storage, unsigned int capacity, unsigned int ringOffset);
+
+	// Repeating the program last bound in this list records nothing.
+	void bindProgram(unsigned int program);
+	// Copies a block into the list and binds it to a uniform block binding.
+	void bindConstants(unsigned int binding, const void* data, unsigned int size);
+	template<typename T>
+	inline void bindConstants(unsigned int binding, const T& block) { bindConstants(binding, &block, sizeof(T)); };
+	// Reserves a block to fill in place and binds it. The pointer is valid
+	// until the next constant block is added.
+	template<typename T>
+	T* allocateConstants(unsigned int binding);
+	// Binds the object's vertex array, skipped on replay when it is already
+	// bound, and draws it; instances above 0 draw instanced.
+	void draw(DrawObject* object, unsigned int instances = 0);
+
+	// Calls function(const CommandHeader&) for each command in order.
+	template<typename Function>
+	void forEach(Function function) const;
+
+	inline unsigned int getCommandCount() const { return commandCount; };
+	inline const unsigned char* getConstantData() const { return constants; };
+	inline unsigned int getConstantBytes() const { return constantBytes; };
+	// True when the blocks already sit at getRingOffset() in the UniformRing.
+	inline bool hasRingConstants() const { return ringOffset != NotInRing; };
+	inline unsigned int getRingOffset() const { return ringOffset; };
+};
+
+template<typename T>
+T* CommandList::append(CommandType type)
+{
+	static_assert(alignof(T) <= CommandAlignment, "Command is overaligned");
+	T* command = static_cast<T*>(commands.allocate(sizeof(T), CommandAlignment));
+	command->header.type = type;
+	command->header.size = sizeof(T);
+	commandCount++;
+	return command;
+}
+
+template<typename T>
+T* CommandList::allocateConstants(unsigned int binding)
+{
+	unsigned int offset = pushConstants(nullptr, sizeof(T));
+	BindConstantsCommand* command = append<BindConstantsCommand>(CommandType::BindConstants);
+	command->binding = binding;
+	command->offset = offset;
+	command->size = sizeof(T);
+	return reinterpret_cast<T*>(constants + offset);
+}
+
+template<typename Function>
+void CommandList::forEach(Function function) const
+{
+	for (size_t chunk = 0; chunk < commands.getChunkCount(); chunk++) {
+		const unsigned char* data = commands.getChunkData(chunk);
+		size_t used = commands.getChunkUsed(chunk);
+		size_t offset = 0;
+		while (offset < used) {
+			const CommandHeader* header = reinterpret_cast<const CommandHeader*>(data + offset);
+			function(*header);
+			offset = (offset + header->size + CommandAlignment - 1) & ~(CommandAlignment - 1);
+		}
+	}
+}
@@ -0,0 +1,227 @@
+#include "CpuProfiler.h"
+
+#if CPU_PROFILER
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_M_X64)
+#include <intrin.h>
+#define CPU_PROFILER_RDTSC 1
+#elif defined(__x86_64__)
+#include <x86intrin.h>
+#define CPU_PROFILER_RDTSC 1
+#else
+#define CPU_PROFILER_RDTSC 0
+#endif
+
+namespace {
+
+struct Zone
+{
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+struct Chunk
+{
+    Zone zones[CpuProfiler::ChunkZones];
+};
+
+// Zones are written only by the buffer's thread. count is published with
+// release ordering after the zone, so readers that acquire it see it. Chunks
+// are allocated under threadsMutex by whichever thread prepares them, and
+// published with release ordering for the recording thread.
+struct ThreadBuffer
+{
+    std::atomic<Chunk*> chunks[CpuProfiler::MaxChunks] = {};
+    std::atomic<uint64_t> count{ 0 };
+    std::atomic<uint64_t> dropped{ 0 };
+    unsigned int id = 0;
+    std::string name;
+
+    ~ThreadBuffer()
+    {
+        for (std::atomic<Chunk*>& chunk : chunks)
+            delete chunk.load(std::memory_order_relaxed);
+    }
+};
+
+std::atomic<bool> enabled{ false };
+std::atomic<uint64_t> frameCount{ 0 };
+std::mutex threadsMutex;
+// Buffers live until exit so a trace can include threads that have ended.
+std::vector<std::unique_ptr<ThreadBuffer>> threads;
+thread_local ThreadBuffer* localBuffer = nullptr;
+thread_local uint64_t frameStart = 0;
+
+// Pairs of tick and steady_clock readings that map ticks onto microseconds.
+struct Calibration
+{
+    uint64_t ticks;
+    double microseconds;
+};
+
+double steadyMicroseconds()
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Calibration calibrate()
+{
+    return { CpuProfiler::now(), steadyMicroseconds() };
+}
+
+const Calibration origin = calibrate();
+
+// Allocates the chunks the next zones of buffer land in. Needs threadsMutex.
+void prepare(ThreadBuffer& buffer, uint64_t zones)
+{
+    const uint64_t first = buffer.count.load(std::memory_order_relaxed);
+    uint64_t last = (first + zones + CpuProfiler::ChunkZones - 1) / CpuProfiler::ChunkZones;
+    if (last > CpuProfiler::MaxChunks)
+        last = CpuProfiler::MaxChunks;
+    for (uint64_t chunk = first / CpuProfiler::ChunkZones; chunk < last; chunk++) {
+        if (buffer.chunks[chunk].load(std::memory_order_relaxed))
+            continue;
+        // Touch every page now so the first zone in it does not fault.
+        Chunk* prepared = new Chunk;
+        std::memset(prepared, 0, sizeof(Chunk));
+        buffer.chunks[chunk].store(prepared, std::memory_order_release);
+    }
+}
+
+void prepareAll()
+{
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    for (const std::unique_ptr<ThreadBuffer>& buffer : threads)
+        prepare(*buffer, CpuProfiler::PreparedZones);
+}
+
+ThreadBuffer& getBuffer()
+{
+    if (!localBuffer) {
+        std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer);
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        buffer->id = (unsigned int)threads.size() + 1;
+        buffer->name = "Thread " + std::to_string(buffer->id);
+        prepare(*buffer, CpuProfiler::PreparedZones);
+        localBuffer = buffer.get();
+        threads.push_back(std::move(buffer));
+    }
+    return *localBuffer;
+}
+
+}
+
+void CpuProfiler::setEnabled(bool enable)
+{
+    if (enable)
+        prepareAll();
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool CpuProfiler::isEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void CpuProfiler::setThreadName(const char* name)
+{
+    ThreadBuffer& buffer = getBuffer();
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    buffer.name = name;
+}
+
+void CpuProfiler::reserve(uint64_t zones)
+{
+    ThreadBuffer& buffer = getBuffer();
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    prepare(buffer, zones);
+}
+
+uint64_t CpuProfiler::now()
+{
+#if CPU_PROFILER_RDTSC
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+void CpuProfiler::record(const char* name, uint64_t start, uint64_t end)
+{
+    ThreadBuffer& buffer = getBuffer();
+    uint64_t index = buffer.count.load(std::memory_order_relaxed);
+    uint64_t chunk = index / ChunkZones;
+    Chunk* zones = chunk < MaxChunks ? buffer.chunks[chunk].load(std::memory_order_acquire) : nullptr;
+    if (!zones) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    zones->zones[index % ChunkZones] = { name, start, end };
+    buffer.count.store(index + 1, std::memory_order_release);
+}
+
+void CpuProfiler::markFrame()
+{
+    uint64_t end = now();
+    if (frameStart && isEnabled())
+        record("Frame", frameStart, end);
+    frameStart = end;
+    frameCount.fetch_add(1, std::memory_order_relaxed);
+    if (isEnabled())
+        prepareAll();
+}
+
+uint64_t CpuProfiler::getFrameCount()
+{
+    return frameCount.load(std::memory_order_relaxed);
+}
+
+void CpuProfiler::exportTrace(ChromeTrace& trace)
+{
+    Calibration current = calibrate();
+    double microsecondsPerTick = current.ticks > origin.ticks
+        ? (current.microseconds - origin.microseconds) / (double)(current.ticks - origin.ticks) : 0.0;
+    auto toMicroseconds = [&](uint64_t ticks) {
+        return origin.microseconds + (double)(int64_t)(ticks - origin.ticks) * microsecondsPerTick;
+    };
+
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    for (const std::unique_ptr<ThreadBuffer>& buffer : threads) {
+        trace.setThreadName(buffer->id, buffer->name);
+        uint64_t count = buffer->count.load(std::memory_order_acquire);
+        for (uint64_t i = 0; i < count; i++) {
+            const Zone& zone = buffer->chunks[i / ChunkZones].load(std::memory_order_relaxed)->zones[i % ChunkZones];
+            double start = toMicroseconds(zone.start);
+            trace.add({ zone.name, start, toMicroseconds(zone.end) - start, buffer->id });
+        }
+    }
+}
+
+uint64_t CpuProfiler::getZoneCount()
+{
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    uint64_t total = 0;
+    for (const std::unique_ptr<ThreadBuffer>& buffer : threads)
+        total += buffer->count.load(std::memory_order_relaxed);
+    return total;
+}
+
+uint64_t CpuProfiler::getDroppedZones()
+{
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    uint64_t total = 0;
+    for (const std::unique_ptr<ThreadBuffer>& buffer : threads)
+        total += buffer->dropped.load(std::memory_order_relaxed);
+    return total;
+}
+
+#endif
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+
+#include "ChromeTrace.h"
+
+// Scoped CPU zones, compiled in unless CPU_PROFILER is defined to 0. With it
+// off the macros expand to nothing and this header declares nothing else.
+//
+//   PROFILE_ZONE("name")    times the rest of the enclosing block
+//   PROFILE_FRAME()         ends a frame: counts it and records a "Frame" zone
+//   PROFILE_THREAD("name")  labels the calling thread in the trace
+#ifndef CPU_PROFILER
+#define CPU_PROFILER 1
+#endif
+
+#if CPU_PROFILER
+
+// Each thread records into its own buffer of fixed-size chunks, so recording
+// takes no lock and never moves earlier zones; a reader sees every zone
+// published before it looked. Timestamps are rdtsc on x86-64 and steady_clock
+// elsewhere, converted to the steady_clock timeline on export so CPU and GPU
+// zones line up. Recording is off until setEnabled(true); a disabled zone costs
+// one branch.
+//
+// Recording never allocates. Chunks are allocated and touched ahead of time:
+// PreparedZones for a thread when it is named with PROFILE_THREAD, for every
+// thread when recording is enabled, and again at every PROFILE_FRAME. A thread
+// that records more than that within one frame drops the excess.
+class CpuProfiler
+{
+public:
+	static const unsigned int ChunkZones = 4096;
+	// Per thread; zones past ChunkZones * MaxChunks are dropped.
+	static const unsigned int MaxChunks = 1024;
+	// Zones each thread can record between frames without dropping any.
+	static const unsigned int PreparedZones = 4 * ChunkZones;
+
+	static void setEnabled(bool enabled);
+	static bool isEnabled();
+	static void setThreadName(const char* name);
+	// Prepares room for the calling thread to record zones more zones, for
+	// work that records more than PreparedZones without PROFILE_FRAME.
+	static void reserve(uint64_t zones);
+
+	static void markFrame();
+	static uint64_t getFrameCount();
+
+	// Safe while other threads keep recording.
+	static void exportTrace(ChromeTrace& trace);
+	static uint64_t getZoneCount();
+	static uint64_t getDroppedZones();
+
+	static uint64_t now();
+	// name must outlive the profiler.
+	static void record(const char* name, uint64_t start, uint64_t end);
+};
+
+class CpuZone
+{
+private:
+	const char* name;
+	uint64_t start;
+public:
+	inline CpuZone(const char* name)
+		: name(CpuProfiler::isEnabled() ? name : nullptr), start(this->name ? CpuProfiler::now() : 0)
+	{
+	};
+	inline ~CpuZone()
+	{
+		if (name)
+			CpuProfiler::record(name, start, CpuProfiler::now());
+	};
+
+	CpuZone(const CpuZone&) = delete;
+	CpuZone& operator=(const CpuZone&) = delete;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) CpuZone PROFILE_CONCAT(cpuZone, __LINE__)(name)
+#define PROFILE_FRAME() CpuProfiler::markFrame()
+#define PROFILE_THREAD(name) CpuProfiler::setThreadName(name)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+
+#endif
@@ -0,0 +1,157 @@
+#include "DeletionQueue.h"
+#include "BufferArena.h"
+#include "GLState.h"
+#include "CpuProfiler.h"
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct Frame
+{
+    GLsync fence = nullptr;
+    std::vector<unsigned int> buffers;
+    std::vector<unsigned int> vertexArrays;
+    std::vector<unsigned int> textures;
+    std::vector<std::pair<BufferArena*, unsigned int>> slices;
+
+    bool empty() const
+    {
+        return buffers.empty() && vertexArrays.empty() && textures.empty() && slices.empty();
+    }
+};
+
+Frame current;
+std::deque<Frame> pending;
+DeletionQueueStats stats;
+
+void release(Frame& frame)
+{
+    for (const std::pair<BufferArena*, unsigned int>& slice : frame.slices)
+        slice.first->free(slice.second);
+
+    if (!frame.vertexArrays.empty()) {
+        for (unsigned int id : frame.vertexArrays)
+            GLState::forgetVertexArray(id);
+        GLCall(glDeleteVertexArrays((GLsizei)frame.vertexArrays.size(), frame.vertexArrays.data()));
+        stats.batches++;
+    }
+    if (!frame.buffers.empty()) {
+        for (unsigned int id : frame.buffers)
+            GLState::forgetBuffer(id);
+        GLCall(glDeleteBuffers((GLsizei)frame.buffers.size(), frame.buffers.data()));
+        stats.batches++;
+    }
+    if (!frame.textures.empty()) {
+        for (unsigned int id : frame.textures)
+            GLState::forgetTexture(id);
+        GLCall(glDeleteTextures((GLsizei)frame.textures.size(), frame.textures.data()));
+        stats.batches++;
+    }
+    stats.deleted += (unsigned int)(frame.buffers.size() + frame.vertexArrays.size() + frame.textures.size() + frame.slices.size());
+
+    if (frame.fence) {
+        GLCall(glDeleteSync(frame.fence));
+    }
+    frame = Frame();
+}
+
+bool signalled(GLsync fence)
+{
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
+}
+
+void DeletionQueue::deleteBuffer(unsigned int id)
+{
+    if (!id)
+        return;
+    current.buffers.push_back(id);
+    stats.enqueued++;
+}
+
+void DeletionQueue::deleteVertexArray(unsigned int id)
+{
+    if (!id)
+        return;
+    current.vertexArrays.push_back(id);
+    stats.enqueued++;
+}
+
+void DeletionQueue::deleteTexture(unsigned int id)
+{
+    if (!id)
+        return;
+    current.textures.push_back(id);
+    stats.enqueued++;
+}
+
+void DeletionQueue::freeArenaSlice(BufferArena* arena, unsigned int handle)
+{
+    if (!arena || handle == BufferArena::InvalidHandle)
+        return;
+    current.slices.push_back(std::make_pair(arena, handle));
+    stats.enqueued++;
+}
+
+void DeletionQueue::forgetArena(BufferArena* arena)
+{
+    auto drop = [arena](Frame& frame) {
+        for (size_t i = 0; i < frame.slices.size();) {
+            if (frame.slices[i].first == arena) {
+                frame.slices[i] = frame.slices.back();
+                frame.slices.pop_back();
+            }
+            else {
+                i++;
+            }
+        }
+    };
+    drop(current);
+    for (Frame& frame : pending)
+        drop(frame);
+}
+
+void DeletionQueue::endFrame()
+{
+    PROFILE_ZONE("DeletionQueue::endFrame");
+    if (!current.empty()) {
+        current.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        pending.push_back(std::move(current));
+        current = Frame();
+    }
+
+    // Fences signal in submission order, so stop at the first one still busy.
+    while (!pending.empty() && signalled(pending.front().fence)) {
+        release(pending.front());
+        pending.pop_front();
+    }
+    if (pending.size() > MaxPendingFrames) {
+        stats.stalls++;
+        GLCall(glClientWaitSync(pending.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED));
+        release(pending.front());
+        pending.pop_front();
+    }
+    stats.pendingFrames = (unsigned int)pending.size();
+}
+
+void DeletionQueue::flush()
+{
+    if (pending.empty() && current.empty())
+        return;
+    GLCall(glFinish());
+    for (Frame& frame : pending)
+        release(frame);
+    pending.clear();
+    release(current);
+    stats.pendingFrames = 0;
+}
+
+const DeletionQueueStats& DeletionQueue::getStats()
+{
+    return stats;
+}
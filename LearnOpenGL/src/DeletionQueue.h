@@ -0,0 +1,44 @@
+#pragma once
+#include "Application.h"
+
+class BufferArena;
+
+struct DeletionQueueStats
+{
+	unsigned int enqueued = 0;
+	unsigned int deleted = 0;
+	// glDelete* calls issued; one per object type per retired frame.
+	unsigned int batches = 0;
+	unsigned int pendingFrames = 0;
+	// Frames that had to block because too many were still in flight.
+	unsigned int stalls = 0;
+};
+
+// Deferred destruction of GL objects. Owners hand their names over when they
+// die. The names are collected per frame, endFrame() fences that frame, and
+// once the fence has signalled the GPU can no longer be using them, so they
+// are released with one glDelete* call per object type.
+//
+// Arena slices go through the same queue: freeing one immediately would let
+// the next allocation overwrite data an in-flight draw still reads.
+class DeletionQueue
+{
+public:
+	// Frames allowed in flight before endFrame() waits for the oldest one.
+	static const unsigned int MaxPendingFrames = 8;
+
+	static void deleteBuffer(unsigned int id);
+	static void deleteVertexArray(unsigned int id);
+	static void deleteTexture(unsigned int id);
+	static void freeArenaSlice(BufferArena* arena, unsigned int handle);
+	// Drops pending slice frees for an arena that is being destroyed.
+	static void forgetArena(BufferArena* arena);
+
+	// Fences everything queued since the last call and releases every earlier
+	// frame whose fence has signalled. Call once per frame after the swap.
+	static void endFrame();
+	// Waits for the GPU and releases everything. Needs a current context.
+	static void flush();
+
+	static const DeletionQueueStats& getStats();
+};
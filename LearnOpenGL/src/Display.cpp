@@ -1,5 +1,16 @@
+// glad has to be included before GLFW.
+#include "DeletionQueue.h"
 #include "Display.h"
 
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if HEADLESS_DISPLAY
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
 
 const char* ConstructorException::what() const throw()
 {
@@ -7,8 +18,184 @@ const char* ConstructorException::what() const throw()
 }
 
 
-Display::Display(int width, int height, std::string title)
+#if HEADLESS_DISPLAY
+
+struct Display::Headless
+{
+    static const unsigned int FramesInFlight = 2;
+
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    // Only without EGL_KHR_surfaceless_context; never drawn to.
+    EGLSurface surface = EGL_NO_SURFACE;
+    int width = 0;
+    int height = 0;
+    unsigned int framebuffer = 0;
+    unsigned int colour = 0;
+    unsigned int depthStencil = 0;
+    GLsync fences[FramesInFlight] = {};
+    unsigned int frame = 0;
+    unsigned int frameCount = 0;
+    std::string dumpPrefix;
+    std::vector<unsigned char> pixels;
+
+    bool create();
+    void destroy();
+    void dump();
+};
+
+namespace {
+
+bool hasExtension(const char* extensions, const char* name)
+{
+    size_t length = std::strlen(name);
+    for (const char* found = extensions ? std::strstr(extensions, name) : nullptr; found; found = std::strstr(found + length, name)) {
+        if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0'))
+            return true;
+    }
+    return false;
+}
+
+}
+
+bool Display::Headless::create()
+{
+    // Mesa's surfaceless platform needs neither a display server nor a GPU.
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay && hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+        std::cerr << "EGL error: no display to render headless on" << std::endl;
+        display = EGL_NO_DISPLAY;
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "EGL error: desktop OpenGL is not supported" << std::endl;
+        return false;
+    }
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    eglChooseConfig(display, configAttributes, &config, 1, &configCount);
+    const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (configCount == 0 && !hasExtension(extensions, "EGL_KHR_no_config_context")) {
+        std::cerr << "EGL error: no config renders desktop OpenGL" << std::endl;
+        return false;
+    }
+
+    // The same 3.3 core context the window asks GLFW for.
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        // A debug context, as for the window, so the KHR_debug sink gets messages.
+        EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE,
+        EGL_NONE
+    };
+    context = eglCreateContext(display, configCount ? config : (EGLConfig)nullptr, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT) {
+        std::cerr << "EGL error: failed to create an OpenGL 3.3 core context (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        return false;
+    }
+
+    if (!hasExtension(extensions, "EGL_KHR_surfaceless_context")) {
+        const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = configCount ? eglCreatePbufferSurface(display, config, surfaceAttributes) : EGL_NO_SURFACE;
+        if (surface == EGL_NO_SURFACE) {
+            std::cerr << "EGL error: failed to create a pbuffer surface" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void Display::Headless::destroy()
+{
+    if (framebuffer) {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &colour);
+        glDeleteRenderbuffers(1, &depthStencil);
+        for (GLsync& fence : fences) {
+            if (fence)
+                glDeleteSync(fence);
+        }
+    }
+    if (display != EGL_NO_DISPLAY) {
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (surface != EGL_NO_SURFACE)
+            eglDestroySurface(display, surface);
+        if (context != EGL_NO_CONTEXT)
+            eglDestroyContext(display, context);
+        eglTerminate(display);
+    }
+}
+
+void Display::Headless::dump()
+{
+    // Read back RGBA, which has no row padding, and write RGB rows top down.
+    pixels.resize((size_t)width * height * 4);
+    GLCall(glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data()));
+
+    char number[16];
+    std::snprintf(number, sizeof(number), "%05u", frame);
+    std::string path = dumpPrefix + number + ".ppm";
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Failed to open " << path << " for writing" << std::endl;
+        return;
+    }
+    std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+    std::vector<unsigned char> row((size_t)width * 3);
+    for (int y = height - 1; y >= 0; y--) {
+        const unsigned char* source = &pixels[(size_t)y * width * 4];
+        for (int x = 0; x < width; x++) {
+            row[x * 3 + 0] = source[x * 4 + 0];
+            row[x * 3 + 1] = source[x * 4 + 1];
+            row[x * 3 + 2] = source[x * 4 + 2];
+        }
+        std::fwrite(row.data(), 1, row.size(), file);
+    }
+    std::fclose(file);
+}
+
+#else
+
+struct Display::Headless
 {
+};
+
+#endif
+
+
+Display::Display(int width, int height, std::string title, const HeadlessSettings* settings)
+    : window(nullptr)
+{
+    if (settings) {
+#if HEADLESS_DISPLAY
+        headless.reset(new Headless);
+        headless->width = width;
+        headless->height = height;
+        headless->frameCount = settings->frameCount;
+        headless->dumpPrefix = settings->dumpPrefix;
+        if (!headless->create()) {
+            headless->destroy();
+            throw new ConstructorException;
+        }
+        return;
+#else
+        std::cerr << "Headless rendering is not compiled in (HEADLESS_DISPLAY=0)" << std::endl;
+        throw new ConstructorException;
+#endif
+    }
+
     window = glfwCreateWindow(width, height, title.c_str(), NULL, NULL);
     if (window == NULL) {
         throw new ConstructorException;
@@ -17,16 +204,119 @@ Display::Display(int width, int height, std::string title)
 
 Display::~Display()
 {
+    // Everything that outlived the render loop is released while the context
+    // is still alive.
+    DeletionQueue::flush();
+#if HEADLESS_DISPLAY
+    if (headless) {
+        headless->destroy();
+        return;
+    }
+#endif
     glfwTerminate();
 }
 
 int Display::shouldClose()
 {
+#if HEADLESS_DISPLAY
+    if (headless)
+        return headless->frameCount && headless->frame >= headless->frameCount;
+#endif
     return glfwWindowShouldClose(window);
 }
 
 void Display::createContext(GLFWframebuffersizefun framebuffer_size_callback)
 {
+#if HEADLESS_DISPLAY
+    // The offscreen framebuffer never resizes, so there is nothing to call back.
+    if (headless) {
+        eglMakeCurrent(headless->display, headless->surface, headless->surface, headless->context);
+        return;
+    }
+#endif
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-}
\ No newline at end of file
+}
+
+void Display::createFramebuffer()
+{
+#if HEADLESS_DISPLAY
+    if (!headless)
+        return;
+    GLCall(glGenRenderbuffers(1, &headless->colour));
+    GLCall(glBindRenderbuffer(GL_RENDERBUFFER, headless->colour));
+    GLCall(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, headless->width, headless->height));
+    GLCall(glGenRenderbuffers(1, &headless->depthStencil));
+    GLCall(glBindRenderbuffer(GL_RENDERBUFFER, headless->depthStencil));
+    GLCall(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, headless->width, headless->height));
+    GLCall(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+
+    GLCall(glGenFramebuffers(1, &headless->framebuffer));
+    GLCall(glBindFramebuffer(GL_FRAMEBUFFER, headless->framebuffer));
+    GLCall(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, headless->colour));
+    GLCall(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, headless->depthStencil));
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "Headless framebuffer is incomplete" << std::endl;
+    // A context without a surface starts with an empty viewport.
+    GLCall(glViewport(0, 0, headless->width, headless->height));
+#endif
+}
+
+SwapMode Display::setSwapMode(SwapMode mode)
+{
+    if (headless)
+        return mode;
+    if (mode == SwapMode::Adaptive && !glfwExtensionSupported("WGL_EXT_swap_control_tear")
+        && !glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+        mode = SwapMode::VSync;
+    glfwSwapInterval(mode == SwapMode::VSync ? 1 : mode == SwapMode::Adaptive ? -1 : 0);
+    return mode;
+}
+
+void Display::present()
+{
+#if HEADLESS_DISPLAY
+    if (headless) {
+        if (!headless->dumpPrefix.empty())
+            headless->dump();
+        // Without a swap chain nothing stops the CPU from queueing frames
+        // without bound, so wait for the one two frames back.
+        GLsync& fence = headless->fences[headless->frame % Headless::FramesInFlight];
+        if (fence) {
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            glDeleteSync(fence);
+        }
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        headless->frame++;
+        return;
+    }
+#endif
+    glfwSwapBuffers(window);
+}
+
+void Display::pollEvents()
+{
+    if (!headless)
+        glfwPollEvents();
+}
+
+void Display::getFramebufferSize(int& width, int& height) const
+{
+#if HEADLESS_DISPLAY
+    if (headless) {
+        width = headless->width;
+        height = headless->height;
+        return;
+    }
+#endif
+    glfwGetFramebufferSize(window, &width, &height);
+}
+
+ProcAddressLoader Display::getProcAddressLoader() const
+{
+#if HEADLESS_DISPLAY
+    if (headless)
+        return (ProcAddressLoader)eglGetProcAddress;
+#endif
+    return (ProcAddressLoader)glfwGetProcAddress;
+}
@@ -1,10 +1,22 @@
 #pragma once
 #include <exception>
 #include <iostream>
+#include <memory>
 #include <string>
 
 #include <GLFW/glfw3.h>
 
+// Headless rendering needs EGL, so it is only compiled in where EGL is
+// expected (Linux, including Mesa's llvmpipe on machines without a GPU).
+// Define HEADLESS_DISPLAY to 0 or 1 to override.
+#ifndef HEADLESS_DISPLAY
+#if defined(__linux__)
+#define HEADLESS_DISPLAY 1
+#else
+#define HEADLESS_DISPLAY 0
+#endif
+#endif
+
 class ConstructorException : public std::exception
 {
 private:
@@ -12,17 +24,52 @@ public:
 	virtual const char* what() const throw();
 };
 
+// Swap intervals: VSync waits for vertical blank (1), Adaptive does too but
+// tears instead of waiting when a frame is late (-1), Off never waits (0).
+enum class SwapMode { VSync, Adaptive, Off };
+
+// Renders into a framebuffer object on a windowless EGL context instead of a
+// GLFW window. shouldClose() turns true after frameCount frames (0 runs until
+// killed); with dumpPrefix set every frame is written to
+// <dumpPrefix><frame>.ppm.
+struct HeadlessSettings
+{
+	unsigned int frameCount;
+	std::string dumpPrefix;
+};
+
+typedef void* (*ProcAddressLoader)(const char* name);
+
 class Display
 {
 private:
+	struct Headless;
+
 	GLFWwindow* window;
+	std::unique_ptr<Headless> headless;
 public:
-	Display(int width, int height, std::string title);
+	// Opens a window, or goes headless when settings are given; GLFW need not
+	// be initialised then. Throws ConstructorException on failure.
+	Display(int width, int height, std::string title, const HeadlessSettings* settings = nullptr);
 	~Display();
 
 	int shouldClose();
 	void createContext(GLFWframebuffersizefun framebuffer_size_callback);
+	// Needs GL loaded. Headless creates the offscreen framebuffer and leaves
+	// it bound; a window already has one.
+	void createFramebuffer();
+	// Needs the context current. Adaptive falls back to VSync without
+	// EXT_swap_control_tear; returns the mode actually applied. Headless
+	// presents never wait, whatever the mode.
+	SwapMode setSwapMode(SwapMode mode);
+	// Swaps buffers, or ends a headless frame: dumps it when asked and keeps
+	// at most two frames in flight, like a swap chain would.
+	void present();
+	void pollEvents();
+	void getFramebufferSize(int& width, int& height) const;
+	ProcAddressLoader getProcAddressLoader() const;
 
+	// Null when headless.
 	inline GLFWwindow* getWindow() const { return window; };
+	inline bool isHeadless() const { return headless != nullptr; };
 };
-
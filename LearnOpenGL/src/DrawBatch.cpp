@@ -0,0 +1,124 @@
+#include "DrawBatch.h"
+#include "GLState.h"
+#include "DeletionQueue.h"
+#include "GpuProfiler.h"
+
+#include <cstdint>
+#include <cstring>
+
+DrawBatch::DrawBatch(const VertexLayoutDesc& layout)
+    : layout(&layout), indirectBufferID(0), objectBufferID(0), objectTextureID(0),
+    indirect(false), built(false), objectDataDirty(false)
+{
+}
+
+DrawBatch::~DrawBatch()
+{
+    DeletionQueue::deleteBuffer(indirectBufferID);
+    DeletionQueue::deleteTexture(objectTextureID);
+    DeletionQueue::deleteBuffer(objectBufferID);
+}
+
+unsigned int DrawBatch::add(const void* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount)
+{
+    ASSERT(!built);
+    unsigned int drawId = (unsigned int)commands.size();
+    unsigned int baseVertex = (unsigned int)(vertexData.size() / layout->stride);
+
+    DrawElementsIndirectCommand command;
+    command.count = indexCount;
+    command.instanceCount = 1;
+    command.firstIndex = (GLuint)indexData.size();
+    command.baseVertex = (GLint)baseVertex;
+    command.baseInstance = drawId;
+    commands.push_back(command);
+
+    const unsigned char* bytes = (const unsigned char*)vertices;
+    vertexData.insert(vertexData.end(), bytes, bytes + vertexCount * layout->stride);
+    indexData.insert(indexData.end(), indices, indices + indexCount);
+    vertexDrawIds.insert(vertexDrawIds.end(), vertexCount, drawId);
+
+    BatchObjectData identity = { { 0.0f, 0.0f, 0.0f }, 1.0f, { 1.0f, 1.0f, 1.0f, 1.0f } };
+    objectData.push_back(identity);
+    return drawId;
+}
+
+void DrawBatch::build()
+{
+    ASSERT(!built);
+    built = true;
+    indirect = GLAD_GL_VERSION_4_3 != 0;
+
+    vao.reset(new VertexArray());
+    vbo.reset(new VertexBuffer(vertexData.data(), (unsigned int)vertexData.size()));
+    ebo.reset(new ElementBuffer(indexData.data(), (int)indexData.size()));
+    ebo->bind();
+
+    layout->apply();
+    const unsigned int drawIdLocation = getDrawIdLocation();
+
+    if (indirect) {
+        // One id per draw, stepped by baseInstance.
+        std::vector<unsigned int> ids(commands.size());
+        for (unsigned int i = 0; i < ids.size(); i++)
+            ids[i] = i;
+        drawIdBuffer.reset(new VertexBuffer(ids.data(), (unsigned int)(ids.size() * sizeof(unsigned int))));
+        GLCall(glVertexAttribIPointer(drawIdLocation, 1, GL_UNSIGNED_INT, sizeof(unsigned int), (const void*)0));
+        GLCall(glVertexAttribDivisor(drawIdLocation, 1));
+
+        GLCall(glGenBuffers(1, &indirectBufferID));
+        GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBufferID);
+        GLCall(glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STATIC_DRAW));
+    }
+    else {
+        drawIdBuffer.reset(new VertexBuffer(vertexDrawIds.data(), (unsigned int)(vertexDrawIds.size() * sizeof(unsigned int))));
+        GLCall(glVertexAttribIPointer(drawIdLocation, 1, GL_UNSIGNED_INT, sizeof(unsigned int), (const void*)0));
+
+        for (const DrawElementsIndirectCommand& command : commands) {
+            counts.push_back((GLsizei)command.count);
+            indexOffsets.push_back((const void*)(uintptr_t)(command.firstIndex * ebo->getIndexSize()));
+            baseVertices.push_back(command.baseVertex);
+        }
+    }
+    GLCall(glEnableVertexAttribArray(drawIdLocation));
+
+    GLCall(glGenBuffers(1, &objectBufferID));
+    GLState::bindBuffer(GL_TEXTURE_BUFFER, objectBufferID);
+    GLCall(glBufferData(GL_TEXTURE_BUFFER, objectData.size() * sizeof(BatchObjectData), objectData.data(), GL_DYNAMIC_DRAW));
+    GLCall(glGenTextures(1, &objectTextureID));
+    GLState::bindTexture(0, GL_TEXTURE_BUFFER, objectTextureID);
+    GLCall(glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, objectBufferID));
+
+    // The CPU copies are only needed to build the buffers.
+    vertexData = std::vector<unsigned char>();
+    indexData = std::vector<unsigned int>();
+    vertexDrawIds = std::vector<unsigned int>();
+}
+
+void DrawBatch::setObjectData(unsigned int drawId, const BatchObjectData& data)
+{
+    objectData[drawId] = data;
+    objectDataDirty = true;
+}
+
+void DrawBatch::draw(unsigned int textureUnit)
+{
+    ASSERT(built);
+    GPU_SCOPE("DrawBatch::draw");
+    if (objectDataDirty) {
+        GLState::bindBuffer(GL_TEXTURE_BUFFER, objectBufferID);
+        GLCall(glBufferSubData(GL_TEXTURE_BUFFER, 0, objectData.size() * sizeof(BatchObjectData), objectData.data()));
+        objectDataDirty = false;
+    }
+    GLState::bindTexture(textureUnit, GL_TEXTURE_BUFFER, objectTextureID);
+    vao->bind();
+
+    if (indirect) {
+        GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBufferID);
+        GLCall(glMultiDrawElementsIndirect(GL_TRIANGLES, ebo->getType(), nullptr, (GLsizei)commands.size(), 0));
+    }
+    else {
+        GLCall(glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), ebo->getType(),
+            indexOffsets.data(), (GLsizei)counts.size(), baseVertices.data()));
+    }
+}
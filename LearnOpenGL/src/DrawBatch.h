@@ -0,0 +1,81 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "Application.h"
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+#include "ElementBuffer.h"
+#include "VertexLayout.h"
+
+// Per-object constants, fetched by the batch shader from a texture buffer at
+// drawId * 2 and drawId * 2 + 1.
+struct BatchObjectData
+{
+	float offset[3];
+	float scale;
+	float colour[4];
+};
+
+// Packs meshes that share a vertex layout into one vertex and one element
+// buffer and draws all of them with a single multi-draw call.
+//
+// With GL 4.3 the batch issues glMultiDrawElementsIndirect, and each command's
+// baseInstance selects the draw id from an instanced attribute. This gives the
+// shader the same value as gl_DrawID without requiring GL 4.6 or
+// ARB_shader_draw_parameters. On GL 3.3 it falls back to
+// glMultiDrawElementsBaseVertex with the draw id stored per vertex. Either way
+// the shader reads it from the first location after the layout's attributes.
+class DrawBatch
+{
+public:
+	struct DrawElementsIndirectCommand
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+private:
+	const VertexLayoutDesc* layout;
+	std::vector<unsigned char> vertexData;
+	std::vector<unsigned int> indexData;
+	std::vector<unsigned int> vertexDrawIds;
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<BatchObjectData> objectData;
+
+	// glMultiDrawElementsBaseVertex arguments for the GL 3.3 path.
+	std::vector<GLsizei> counts;
+	std::vector<const void*> indexOffsets;
+	std::vector<GLint> baseVertices;
+
+	std::unique_ptr<VertexArray> vao;
+	std::unique_ptr<VertexBuffer> vbo;
+	std::unique_ptr<VertexBuffer> drawIdBuffer;
+	std::unique_ptr<ElementBuffer> ebo;
+	unsigned int indirectBufferID;
+	unsigned int objectBufferID;
+	unsigned int objectTextureID;
+	bool indirect;
+	bool built;
+	bool objectDataDirty;
+public:
+	DrawBatch(const VertexLayoutDesc& layout = DefaultVertexLayout::describe());
+	~DrawBatch();
+
+	// Appends a mesh and returns its draw id. Only valid before build().
+	unsigned int add(const void* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount);
+	// Uploads the packed buffers and picks the draw path.
+	void build();
+
+	void setObjectData(unsigned int drawId, const BatchObjectData& data);
+	// Draws every mesh in the batch. The object data texture buffer is bound
+	// to textureUnit, which the program's samplerBuffer must use.
+	void draw(unsigned int textureUnit = 0);
+
+	inline unsigned int getObjectCount() const { return (unsigned int)commands.size(); };
+	inline bool isIndirect() const { return indirect; };
+	inline const VertexLayoutDesc& getLayout() const { return *layout; };
+	inline unsigned int getDrawIdLocation() const { return layout->count; };
+};
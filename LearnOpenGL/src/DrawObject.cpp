@@ -1,24 +1,58 @@
 #include "DrawObject.h"
 #include "Application.h"
 
-DrawObject::DrawObject(VertexBuffer *vbo, ElementBuffer* ebo)
+#include <cstdint>
+
+DrawObject::DrawObject(VertexBuffer *vbo, ElementBuffer* ebo, const VertexLayoutDesc& layout)
+	: vbo(vbo), ebo(ebo), instances(nullptr), layout(&layout)
 {
-	this->vao = VertexArray();
-	this->vbo = vbo;
-	this->ebo = ebo;
 	vao.bind();
 	vbo->bind();
 	ebo->bind();
 
-	GLCall(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (const void*)0));
-	GLCall(glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (const void*)(3 * sizeof(float))));
-	GLCall(glEnableVertexAttribArray(0));
-	GLCall(glEnableVertexAttribArray(1));
+	// Attributes start at the beginning of the buffer; arena slices are reached
+	// through the base vertex at draw time, so compaction can move them.
+	layout.apply();
 }
 
 void DrawObject::draw()
 {
+	bind();
+	drawElements();
+}
+
+void DrawObject::bind()
+{
+	// The element buffer binding is part of the VAO, captured in the constructor.
 	vao.bind();
-	ebo->bind();
-	GLCall(glDrawElements(GL_TRIANGLES, ebo->getCount(), GL_UNSIGNED_INT, nullptr));
+}
+
+void DrawObject::drawElements()
+{
+	GLCall(glDrawElementsBaseVertex(GL_TRIANGLES, ebo->getCount(), ebo->getType(),
+		(const void*)(uintptr_t)ebo->getOffset(), getBaseVertex()));
+}
+
+void DrawObject::setInstanceBuffer(InstanceBuffer* instances)
+{
+	this->instances = instances;
+	instances->setAttributes(vao.getId());
+}
+
+void DrawObject::drawInstanced(unsigned int count)
+{
+	ASSERT(instances);
+	// More would read past the end of the instance buffer.
+	ASSERT(count <= instances->getUploadedCount());
+	bind();
+	// A streamed upload starts part way into its buffer.
+	unsigned int firstInstance = instances->getFirstInstance();
+	if (firstInstance) {
+		GLCall(glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, ebo->getCount(), ebo->getType(),
+			(const void*)(uintptr_t)ebo->getOffset(), count, getBaseVertex(), firstInstance));
+	}
+	else {
+		GLCall(glDrawElementsInstancedBaseVertex(GL_TRIANGLES, ebo->getCount(), ebo->getType(),
+			(const void*)(uintptr_t)ebo->getOffset(), count, getBaseVertex()));
+	}
 }
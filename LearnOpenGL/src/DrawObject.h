@@ -3,6 +3,8 @@
 #include "VertexBuffer.h"
 #include "VertexArray.h"
 #include "ElementBuffer.h"
+#include "InstanceBuffer.h"
+#include "VertexLayout.h"
 
 class DrawObject
 {
@@ -10,11 +12,27 @@ private:
 	VertexArray vao;
 	VertexBuffer *vbo;
 	ElementBuffer *ebo;
+	InstanceBuffer *instances;
+	const VertexLayoutDesc* layout;
 
 public:
-	DrawObject(VertexBuffer* vbo, ElementBuffer* ebo);
+	DrawObject(VertexBuffer* vbo, ElementBuffer* ebo, const VertexLayoutDesc& layout = DefaultVertexLayout::describe());
 	~DrawObject() = default;
 
 	void draw();
+	void bind();
+	// Issues the draw call, assuming bind() has already been called.
+	void drawElements();
+	// First vertex of this object's data, non-zero when the VBO is an arena slice.
+	inline int getBaseVertex() { return (int)(vbo->getOffset() / layout->stride); };
+	inline const VertexLayoutDesc& getLayout() const { return *layout; };
+	inline ElementBuffer* getElementBuffer() { return ebo; };
+
+	// Attaches per-instance attributes (locations 2-6) to this object's VAO.
+	void setInstanceBuffer(InstanceBuffer* instances);
+	// Draws count instances in one call. Requires setInstanceBuffer(), and count
+	// at most the instances uploaded.
+	void drawInstanced(unsigned int count);
+	inline unsigned int getVaoId() { return vao.getId(); };
 };
 
@@ -1,20 +1,104 @@
 #include "ElementBuffer.h"
 #include "Application.h"
+#include "GLState.h"
+#include "IndexConversion.h"
+#include "DeletionQueue.h"
+
+#include <vector>
+
+namespace {
+
+// Returns a pointer to the indices in the chosen type, converting into
+// storage if they need narrowing.
+const void* narrowIndices(const unsigned int* data, int count, unsigned int& type, std::vector<unsigned char>& storage)
+{
+    type = selectIndexType(data, count);
+    if (type == GL_UNSIGNED_INT)
+        return data;
+
+    storage.resize(count * indexTypeSize(type));
+    if (type == GL_UNSIGNED_SHORT)
+        convertIndices16(data, (uint16_t*)storage.data(), count);
+    else
+        convertIndices8(data, storage.data(), count);
+    return storage.data();
+}
+
+}
 
 ElementBuffer::ElementBuffer(const unsigned int* data, int count)
-    : count(count)
+    : count(count), arena(nullptr), allocation(BufferArena::InvalidHandle)
 {
+    std::vector<unsigned char> storage;
+    const void* indices = narrowIndices(data, count, type, storage);
+
+    // Upload through GL_COPY_WRITE_BUFFER: the element array binding belongs to
+    // whichever VAO is current, and DrawObject relies on its VAO keeping its own.
     GLCall(glGenBuffers(1, &bufferID));
-    GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferID));
-    GLCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), data, GL_STATIC_DRAW));
+    GLState::bindBuffer(GL_COPY_WRITE_BUFFER, bufferID);
+    GLCall(glBufferData(GL_COPY_WRITE_BUFFER, count * getIndexSize(), indices, GL_STATIC_DRAW));
+}
+
+ElementBuffer::ElementBuffer(BufferArena* arena, const unsigned int* data, int count)
+    : bufferID(0), count(count), arena(arena)
+{
+    std::vector<unsigned char> storage;
+    const void* indices = narrowIndices(data, count, type, storage);
+
+    allocation = arena->allocate(count * getIndexSize(), getIndexSize(), indices);
+    ASSERT(allocation != BufferArena::InvalidHandle);
+}
+
+ElementBuffer::~ElementBuffer()
+{
+    release();
+}
+
+void ElementBuffer::release()
+{
+    if (arena)
+        DeletionQueue::freeArenaSlice(arena, allocation);
+    else
+        DeletionQueue::deleteBuffer(bufferID);
+}
+
+ElementBuffer::ElementBuffer(ElementBuffer&& other)
+    : bufferID(other.bufferID), count(other.count), type(other.type), arena(other.arena), allocation(other.allocation)
+{
+    other.bufferID = 0;
+    other.count = 0;
+    other.arena = nullptr;
+    other.allocation = BufferArena::InvalidHandle;
+}
+
+ElementBuffer& ElementBuffer::operator=(ElementBuffer&& other)
+{
+    if (this != &other) {
+        release();
+        bufferID = other.bufferID;
+        count = other.count;
+        type = other.type;
+        arena = other.arena;
+        allocation = other.allocation;
+        other.bufferID = 0;
+        other.count = 0;
+        other.arena = nullptr;
+        other.allocation = BufferArena::InvalidHandle;
+    }
+    return *this;
 }
 
 void ElementBuffer::bind()
 {
-    GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferID));
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, getId());
 }
 
 void ElementBuffer::unbind()
 {
-    GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+    GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+unsigned int ElementBuffer::getIndexSize()
+{
+    return indexTypeSize(type);
 }
@@ -1,16 +1,36 @@
 #pragma once
+#include "BufferArena.h"
+
+// Indices are stored in the narrowest of 8, 16 or 32 bits that can hold the
+// largest index; getType() gives the matching GL type for the draw call.
 class ElementBuffer
 {
 private:
 	unsigned int bufferID;
 	int count;
+	unsigned int type;
+	BufferArena* arena;
+	unsigned int allocation;
+
+	void release();
 public:
 	ElementBuffer(const unsigned int* data, int count);
-	~ElementBuffer() = default;
+	// Sub-allocates from a shared arena instead of creating a buffer object.
+	ElementBuffer(BufferArena* arena, const unsigned int* data, int count);
+	// Hands the buffer or arena slice to the DeletionQueue.
+	~ElementBuffer();
+
+	ElementBuffer(const ElementBuffer&) = delete;
+	ElementBuffer& operator=(const ElementBuffer&) = delete;
+	ElementBuffer(ElementBuffer&& other);
+	ElementBuffer& operator=(ElementBuffer&& other);
 
 	void bind();
 	void unbind();
-	inline unsigned int getId() { return bufferID; };
+	inline unsigned int getId() { return arena ? arena->getBufferId(allocation) : bufferID; };
 	inline int getCount() { return count; };
+	inline unsigned int getType() { return type; };
+	unsigned int getIndexSize();
+	// Byte offset of the first index within getId(); 0 unless arena backed.
+	inline unsigned int getOffset() { return arena ? arena->getOffset(allocation) : 0; };
 };
-
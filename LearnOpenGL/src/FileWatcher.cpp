@@ -0,0 +1,115 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::string directoryOf(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+void addOnce(std::vector<std::string>& changed, const std::string& path)
+{
+    if (std::find(changed.begin(), changed.end(), path) == changed.end())
+        changed.push_back(path);
+}
+
+}
+
+FileWatcher::FileWatcher()
+    : lastScan(std::chrono::steady_clock::now())
+{
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if (inotifyFd >= 0)
+        close(inotifyFd);
+#endif
+}
+
+long long FileWatcher::modificationTime(const std::string& path)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return 0;
+    // st_mtime only has whole seconds; folding in the size catches most
+    // saves within the same second.
+    return (long long)info.st_mtime * 1000003 + (long long)info.st_size;
+}
+
+void FileWatcher::watch(const std::string& path)
+{
+    for (const WatchedFile& file : files)
+        if (file.path == path)
+            return;
+    files.push_back({ path, modificationTime(path) });
+
+#ifdef __linux__
+    if (inotifyFd < 0)
+        return;
+    std::string directory = directoryOf(path);
+    for (const WatchedDirectory& watched : directories)
+        if (watched.path == directory)
+            return;
+    int descriptor = inotify_add_watch(inotifyFd, directory.empty() ? "." : directory.c_str(),
+        IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (descriptor >= 0)
+        directories.push_back({ descriptor, directory });
+#endif
+}
+
+void FileWatcher::poll(std::vector<std::string>& changed)
+{
+#ifdef __linux__
+    if (inotifyFd >= 0) {
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+            for (char* at = buffer; at < buffer + length;) {
+                const inotify_event* event = (const inotify_event*)at;
+                at += sizeof(inotify_event) + event->len;
+                if (event->len == 0)
+                    continue;
+                for (const WatchedDirectory& directory : directories) {
+                    if (directory.descriptor != event->wd)
+                        continue;
+                    std::string path = directory.path + event->name;
+                    for (const WatchedFile& file : files)
+                        if (file.path == path)
+                            addOnce(changed, path);
+                }
+            }
+        }
+        return;
+    }
+#endif
+
+    // milliseconds takes its count by reference; a copy keeps the constant
+    // from needing a definition.
+    const unsigned int interval = ScanIntervalMilliseconds;
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastScan < std::chrono::milliseconds(interval))
+        return;
+    lastScan = now;
+    for (WatchedFile& file : files) {
+        long long modified = modificationTime(file.path);
+        if (modified != file.modified) {
+            file.modified = modified;
+            addOnce(changed, file.path);
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Reports changes to a set of files without blocking. On Linux this uses
+// inotify on the files' directories, which also catches editors that save by
+// renaming a new file over the old one. Elsewhere modification times and sizes
+// are compared every ScanIntervalMilliseconds.
+class FileWatcher
+{
+private:
+	struct WatchedFile
+	{
+		std::string path;
+		long long modified;
+	};
+	std::vector<WatchedFile> files;
+	std::chrono::steady_clock::time_point lastScan;
+#ifdef __linux__
+	struct WatchedDirectory
+	{
+		int descriptor;
+		std::string path;
+	};
+	int inotifyFd;
+	std::vector<WatchedDirectory> directories;
+#endif
+
+	static long long modificationTime(const std::string& path);
+public:
+	static const unsigned int ScanIntervalMilliseconds = 250;
+
+	FileWatcher();
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	// Adding the same path twice is harmless.
+	void watch(const std::string& path);
+	// Appends each watched file that changed since the last call, once.
+	void poll(std::vector<std::string>& changed);
+
+	inline unsigned int getWatchedCount() const { return (unsigned int)files.size(); };
+};
@@ -0,0 +1,147 @@
+#include "FramePacer.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace {
+
+const double MinSpinMargin = 0.25;
+const double MaxSpinMargin = 4.0;
+
+double millisecondsBetween(FramePacer::Clock::time_point start, FramePacer::Clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+}
+
+FramePacer::FramePacer(double fixedStepSeconds, unsigned int maxSteps)
+    : fixedStep(fixedStepSeconds), accumulator(0.0), maxSteps(maxSteps), targetFrame(0.0), spinMargin(1.0), sleepOvershoot(0.0),
+    frameCount(0), previousFrame(0.0), historyNext(0)
+{
+    startTime = Clock::now();
+    frameStart = startTime;
+    presentStart = startTime;
+    presentEnd = startTime;
+    deadline = startTime;
+    history.reserve(HistorySize);
+}
+
+void FramePacer::setFrameLimit(double framesPerSecond)
+{
+    targetFrame = framesPerSecond > 0.0 ? 1000.0 / framesPerSecond : 0.0;
+}
+
+unsigned int FramePacer::beginFrame()
+{
+    Clock::time_point now = Clock::now();
+    double elapsed = 0.0;
+    if (frameCount > 0) {
+        elapsed = std::chrono::duration<double>(now - frameStart).count();
+        record(now);
+    }
+    frameStart = now;
+    frameCount++;
+
+    accumulator += elapsed;
+    unsigned int steps = (unsigned int)(accumulator / fixedStep);
+    if (steps > maxSteps) {
+        steps = maxSteps;
+        accumulator = std::fmod(accumulator, fixedStep);
+    }
+    else {
+        accumulator -= steps * fixedStep;
+    }
+    return steps;
+}
+
+void FramePacer::beginPresent()
+{
+    presentStart = Clock::now();
+}
+
+void FramePacer::limit()
+{
+    if (targetFrame <= 0.0)
+        return;
+    Clock::time_point now = Clock::now();
+    Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double, std::milli>(targetFrame));
+    // Restart the cadence after falling a whole frame behind instead of
+    // rushing to catch up.
+    if (deadline + period < frameStart)
+        deadline = frameStart;
+    deadline += period;
+    if (deadline <= now) {
+        deadline = now;
+        return;
+    }
+
+    double remaining = millisecondsBetween(now, deadline);
+    if (remaining > spinMargin) {
+        Clock::time_point wake = deadline - std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double, std::milli>(spinMargin));
+        std::this_thread::sleep_until(wake);
+        // Spin for twice the typical overshoot. Rare long preemptions are not
+        // worth burning a core on every frame, so the margin is capped.
+        double overshoot = millisecondsBetween(wake, Clock::now());
+        sleepOvershoot = sleepOvershoot * 0.9 + overshoot * 0.1;
+        spinMargin = std::min(MaxSpinMargin, MinSpinMargin + 2.0 * sleepOvershoot);
+    }
+    while (Clock::now() < deadline)
+        std::this_thread::yield();
+}
+
+void FramePacer::endFrame()
+{
+    presentEnd = Clock::now();
+    PROFILE_ZONE("Frame limiter");
+    limit();
+}
+
+void FramePacer::record(Clock::time_point frameEnd)
+{
+    FrameTiming timing;
+    timing.cpu = millisecondsBetween(frameStart, presentStart);
+    timing.present = millisecondsBetween(presentStart, presentEnd);
+    timing.frame = millisecondsBetween(frameStart, frameEnd);
+    timing.jitter = history.empty() ? 0.0 : std::fabs(timing.frame - previousFrame);
+    previousFrame = timing.frame;
+
+    if (history.size() < HistorySize)
+        history.push_back(timing);
+    else
+        history[historyNext] = timing;
+    historyNext = (historyNext + 1) % HistorySize;
+}
+
+unsigned int FramePacer::getHistoryCount() const
+{
+    return (unsigned int)history.size();
+}
+
+const FrameTiming& FramePacer::getHistory(unsigned int age) const
+{
+    return history[(historyNext + HistorySize - 1 - age) % HistorySize];
+}
+
+FrameTiming FramePacer::getAverage() const
+{
+    FrameTiming average = {};
+    if (history.empty())
+        return average;
+    for (const FrameTiming& timing : history) {
+        average.cpu += timing.cpu;
+        average.present += timing.present;
+        average.frame += timing.frame;
+        average.jitter += timing.jitter;
+    }
+    double count = (double)history.size();
+    average.cpu /= count;
+    average.present /= count;
+    average.frame /= count;
+    average.jitter /= count;
+    return average;
+}
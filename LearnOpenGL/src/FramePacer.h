@@ -0,0 +1,80 @@
+#pragma once
+#include <chrono>
+#include <vector>
+
+// One frame as measured by the FramePacer, in milliseconds.
+struct FrameTiming
+{
+	// From beginFrame() to beginPresent(): input, simulation and draw submission.
+	double cpu;
+	// From beginPresent() to endFrame(): the buffer swap, including any vsync wait.
+	double present;
+	// From this frame's beginFrame() to the next one, limiter wait included.
+	double frame;
+	// How far frame differs from the previous frame's.
+	double jitter;
+};
+
+// Frame clock for the main loop. Simulation runs in fixed steps that are
+// decoupled from the render rate: beginFrame() returns how many steps are due,
+// and getAlpha() is how far rendering is between the last two steps. An
+// optional frame limiter ends each frame by sleeping until shortly before the
+// deadline and spinning the rest, since sleeps overshoot by up to a scheduler
+// tick. The spin margin follows the measured overshoot. Deadlines follow on
+// from each other, so work done between endFrame() and the next beginFrame()
+// shortens the next wait instead of stretching the frame.
+//
+// The last HistorySize frames are kept in a ring buffer. A frame is recorded
+// when the next one begins, once its full length is known.
+class FramePacer
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+	static const unsigned int HistorySize = 256;
+private:
+	Clock::time_point startTime;
+	Clock::time_point frameStart;
+	Clock::time_point presentStart;
+	Clock::time_point presentEnd;
+	Clock::time_point deadline;
+	double fixedStep;
+	double accumulator;
+	unsigned int maxSteps;
+	double targetFrame;
+	double spinMargin;
+	double sleepOvershoot;
+	unsigned long long frameCount;
+	double previousFrame;
+	std::vector<FrameTiming> history;
+	unsigned int historyNext;
+
+	void limit();
+	void record(Clock::time_point frameEnd);
+public:
+	// At most maxSteps steps run per frame; beyond that the simulation slows
+	// down rather than spiralling after a long stall.
+	FramePacer(double fixedStepSeconds = 1.0 / 60.0, unsigned int maxSteps = 8);
+
+	// Caps the frame rate; 0 leaves it uncapped.
+	void setFrameLimit(double framesPerSecond);
+
+	// Starts a frame and returns the number of fixed steps to simulate.
+	unsigned int beginFrame();
+	// Marks the end of CPU work, just before the swap.
+	void beginPresent();
+	// Records the frame after the swap and waits out the frame limit.
+	void endFrame();
+
+	inline double getFixedStep() const { return fixedStep; };
+	// Fraction of a step between the last simulated state and now, in [0, 1).
+	inline double getAlpha() const { return accumulator / fixedStep; };
+	inline double getSeconds() const { return std::chrono::duration<double>(frameStart - startTime).count(); };
+	inline unsigned long long getFrameCount() const { return frameCount; };
+
+	// Frames recorded so far, up to HistorySize.
+	unsigned int getHistoryCount() const;
+	// 0 is the most recent frame.
+	const FrameTiming& getHistory(unsigned int age) const;
+	// Average of the recorded frames.
+	FrameTiming getAverage() const;
+};
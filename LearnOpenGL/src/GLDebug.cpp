@@ -0,0 +1,149 @@
+#include "GLDebug.h"
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+//
+// Error checking functions.
+//
+
+unsigned int glErrorSampleCounter = 0;
+
+void GLClearError()
+{
+    while (glGetError() != GL_NO_ERROR);
+}
+
+bool GLLogCall(const char* function, const char* file, int line)
+{
+    bool ok = true;
+    while (GLenum error = glGetError()) {
+        std::cerr << "[OpenGL Error] (0x" << std::hex << error << std::dec << ") "
+            << function << " " << file << ":" << line << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+bool hasGLExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension && std::strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+//
+// KHR_debug sink.
+//
+
+namespace {
+
+// Same signatures for the core 4.3 entry points and GL_KHR_debug on desktop GL.
+typedef void (APIENTRYP DebugMessageCallbackProc)(GLDEBUGPROC callback, const void* userParam);
+typedef void (APIENTRYP DebugMessageControlProc)(GLenum source, GLenum type, GLenum severity, GLsizei count, const GLuint* ids, GLboolean enabled);
+
+const size_t MaxQueuedMessages = 256;
+
+std::mutex queueMutex;
+std::vector<GLDebugMessage> queue;
+std::atomic<unsigned int> errorCount(0);
+std::atomic<unsigned int> droppedCount(0);
+bool installed = false;
+
+void APIENTRY onDebugMessage(GLenum source, GLenum type, GLuint id, GLenum severity,
+    GLsizei length, const GLchar* message, const void*)
+{
+    if (type == GL_DEBUG_TYPE_ERROR)
+        errorCount++;
+
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (queue.size() >= MaxQueuedMessages) {
+        droppedCount++;
+        return;
+    }
+    size_t size = length >= 0 ? (size_t)length : std::strlen(message);
+    queue.push_back({ source, type, id, severity, std::string(message, size) });
+}
+
+const char* severityName(GLenum severity)
+{
+    switch (severity) {
+    case GL_DEBUG_SEVERITY_HIGH: return "high";
+    case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+    case GL_DEBUG_SEVERITY_LOW: return "low";
+    default: return "notification";
+    }
+}
+
+}
+
+bool GLDebugSink::install(GLADloadproc loader, bool verbose)
+{
+    DebugMessageCallbackProc debugMessageCallback = nullptr;
+    DebugMessageControlProc debugMessageControl = nullptr;
+    if (GLAD_GL_VERSION_4_3) {
+        debugMessageCallback = glDebugMessageCallback;
+        debugMessageControl = glDebugMessageControl;
+    }
+    else if (hasGLExtension("GL_KHR_debug")) {
+        debugMessageCallback = (DebugMessageCallbackProc)loader("glDebugMessageCallback");
+        debugMessageControl = (DebugMessageControlProc)loader("glDebugMessageControl");
+    }
+    if (!debugMessageCallback || !debugMessageControl)
+        return false;
+
+    GLClearError();
+    glEnable(GL_DEBUG_OUTPUT);
+    // Deliberately not GL_DEBUG_OUTPUT_SYNCHRONOUS: the driver may report from
+    // its own thread instead of stalling the calling one.
+    debugMessageCallback(onDebugMessage, nullptr);
+    if (!verbose) {
+        debugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+        debugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_ERROR, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+        debugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_HIGH, 0, nullptr, GL_TRUE);
+    }
+    installed = glGetError() == GL_NO_ERROR;
+    return installed;
+}
+
+bool GLDebugSink::isInstalled()
+{
+    return installed;
+}
+
+void GLDebugSink::take(std::vector<GLDebugMessage>& messages)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    messages.insert(messages.end(), queue.begin(), queue.end());
+    queue.clear();
+}
+
+unsigned int GLDebugSink::drain()
+{
+    std::vector<GLDebugMessage> messages;
+    take(messages);
+
+    unsigned int errors = 0;
+    for (const GLDebugMessage& message : messages) {
+        if (message.type == GL_DEBUG_TYPE_ERROR)
+            errors++;
+        std::cerr << "[OpenGL Debug] (" << severityName(message.severity) << ", id " << message.id << ") "
+            << message.text << std::endl;
+    }
+    unsigned int dropped = droppedCount.exchange(0);
+    if (dropped)
+        std::cerr << "[OpenGL Debug] " << dropped << " messages dropped" << std::endl;
+    return errors;
+}
+
+unsigned int GLDebugSink::getErrorCount()
+{
+    return errorCount;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Application.h"
+
+struct GLDebugMessage
+{
+	GLenum source;
+	GLenum type;
+	GLuint id;
+	GLenum severity;
+	std::string text;
+};
+
+// Receives KHR_debug messages from the driver. With GL_ERROR_CHECK_NONE this is
+// the only error reporting path. The callback may run on a driver thread, so it
+// only queues messages; drain() prints them from the render thread.
+class GLDebugSink
+{
+public:
+	// Enables asynchronous debug output if GL 4.3 or GL_KHR_debug is available.
+	// Only errors and high severity messages are delivered unless verbose is set.
+	// Returns false if the context has no debug output support.
+	static bool install(GLADloadproc loader, bool verbose = false);
+	static bool isInstalled();
+
+	// Prints and clears the queued messages, returning how many were errors.
+	static unsigned int drain();
+	static void take(std::vector<GLDebugMessage>& messages);
+
+	static unsigned int getErrorCount();
+};
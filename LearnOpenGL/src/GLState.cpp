@@ -0,0 +1,427 @@
+#include "GLState.h"
+
+#include <iostream>
+#include <unordered_map>
+
+namespace {
+
+const unsigned int Unknown = 0xFFFFFFFFu;
+
+// Buffer targets whose binding is global context state.
+const GLenum bufferTargets[] = {
+    GL_ARRAY_BUFFER,
+    GL_UNIFORM_BUFFER,
+    GL_COPY_READ_BUFFER,
+    GL_COPY_WRITE_BUFFER,
+    GL_DRAW_INDIRECT_BUFFER,
+    GL_TEXTURE_BUFFER,
+    GL_PIXEL_PACK_BUFFER,
+    GL_PIXEL_UNPACK_BUFFER,
+    GL_SHADER_STORAGE_BUFFER,
+};
+const GLenum bufferBindingQueries[] = {
+    GL_ARRAY_BUFFER_BINDING,
+    GL_UNIFORM_BUFFER_BINDING,
+    GL_COPY_READ_BUFFER_BINDING,
+    GL_COPY_WRITE_BUFFER_BINDING,
+    GL_DRAW_INDIRECT_BUFFER_BINDING,
+    GL_TEXTURE_BUFFER_BINDING,
+    GL_PIXEL_PACK_BUFFER_BINDING,
+    GL_PIXEL_UNPACK_BUFFER_BINDING,
+    GL_SHADER_STORAGE_BUFFER_BINDING,
+};
+const int BufferTargetCount = sizeof(bufferTargets) / sizeof(bufferTargets[0]);
+
+const GLenum textureTargets[] = {
+    GL_TEXTURE_2D,
+    GL_TEXTURE_3D,
+    GL_TEXTURE_CUBE_MAP,
+    GL_TEXTURE_2D_ARRAY,
+    GL_TEXTURE_BUFFER,
+};
+const GLenum textureBindingQueries[] = {
+    GL_TEXTURE_BINDING_2D,
+    GL_TEXTURE_BINDING_3D,
+    GL_TEXTURE_BINDING_CUBE_MAP,
+    GL_TEXTURE_BINDING_2D_ARRAY,
+    GL_TEXTURE_BINDING_BUFFER,
+};
+const int TextureTargetCount = sizeof(textureTargets) / sizeof(textureTargets[0]);
+
+const GLenum capabilities[] = {
+    GL_BLEND,
+    GL_DEPTH_TEST,
+    GL_CULL_FACE,
+    GL_SCISSOR_TEST,
+    GL_STENCIL_TEST,
+};
+const int CapabilityCount = sizeof(capabilities) / sizeof(capabilities[0]);
+
+struct BufferRange
+{
+    unsigned int id;
+    GLintptr offset;
+    GLsizeiptr size;
+};
+
+struct Cache
+{
+    unsigned int vertexArray;
+    std::unordered_map<unsigned int, unsigned int> elementBuffers;
+    unsigned int buffers[BufferTargetCount];
+    BufferRange uniformRanges[GLState::MaxUniformBufferBindings];
+    unsigned int program;
+    unsigned int activeTexture;
+    unsigned int textures[GLState::MaxTextureUnits][TextureTargetCount];
+    unsigned int capabilities[CapabilityCount];
+    unsigned int blendSource;
+    unsigned int blendDestination;
+    unsigned int depthFunc;
+    unsigned int depthMask;
+};
+
+Cache cache;
+bool cacheInitialized = false;
+bool validation = false;
+GLStateStats stats;
+
+Cache& getCache()
+{
+    if (!cacheInitialized) {
+        GLState::invalidate();
+        cacheInitialized = true;
+    }
+    return cache;
+}
+
+int bufferSlot(GLenum target)
+{
+    for (int i = 0; i < BufferTargetCount; i++)
+        if (bufferTargets[i] == target)
+            return i;
+    return -1;
+}
+
+int textureSlot(GLenum target)
+{
+    for (int i = 0; i < TextureTargetCount; i++)
+        if (textureTargets[i] == target)
+            return i;
+    return -1;
+}
+
+int capabilitySlot(GLenum capability)
+{
+    for (int i = 0; i < CapabilityCount; i++)
+        if (capabilities[i] == capability)
+            return i;
+    return -1;
+}
+
+// Returns true if the call can be skipped, updating the counters either way.
+bool skip(unsigned int cached, unsigned int wanted, unsigned int& categoryCounter)
+{
+    stats.requested++;
+    if (cached != wanted)
+        return false;
+    stats.skipped++;
+    categoryCounter++;
+    return true;
+}
+
+void validate(const char* what, GLenum query, unsigned int expected)
+{
+    if (!validation || expected == Unknown)
+        return;
+    GLint actual = 0;
+    GLCall(glGetIntegerv(query, &actual));
+    if ((unsigned int)actual != expected) {
+        stats.validationMismatches++;
+        std::cerr << "[GLState] " << what << " cache mismatch: cached " << expected
+            << ", driver " << actual << std::endl;
+    }
+}
+
+void setActiveTexture(Cache& c, unsigned int unit)
+{
+    if (c.activeTexture == unit)
+        return;
+    GLCall(glActiveTexture(GL_TEXTURE0 + unit));
+    c.activeTexture = unit;
+}
+
+void applyCapability(GLenum capability, bool enabled)
+{
+    if (enabled) {
+        GLCall(glEnable(capability));
+    }
+    else {
+        GLCall(glDisable(capability));
+    }
+}
+
+void setCapability(GLenum capability, bool enabled)
+{
+    Cache& c = getCache();
+    int slot = capabilitySlot(capability);
+    if (slot < 0) {
+        applyCapability(capability, enabled);
+        return;
+    }
+
+    if (!skip(c.capabilities[slot], enabled ? 1 : 0, stats.fixedFunctionSkipped)) {
+        applyCapability(capability, enabled);
+        c.capabilities[slot] = enabled ? 1 : 0;
+    }
+
+    if (validation) {
+        GLCall(GLboolean actual = glIsEnabled(capability));
+        if ((actual == GL_TRUE) != enabled) {
+            stats.validationMismatches++;
+            std::cerr << "[GLState] capability 0x" << std::hex << capability << std::dec
+                << " cache mismatch" << std::endl;
+        }
+    }
+}
+
+}
+
+void GLState::bindVertexArray(unsigned int id)
+{
+    Cache& c = getCache();
+    if (!skip(c.vertexArray, id, stats.vertexArraySkipped)) {
+        GLCall(glBindVertexArray(id));
+        c.vertexArray = id;
+        stats.vertexArrayBinds++;
+    }
+    validate("vertex array", GL_VERTEX_ARRAY_BINDING, c.vertexArray);
+}
+
+void GLState::bindBuffer(GLenum target, unsigned int id)
+{
+    Cache& c = getCache();
+
+    if (target == GL_ELEMENT_ARRAY_BUFFER) {
+        // Only meaningful if the current VAO is known.
+        auto it = c.vertexArray != Unknown ? c.elementBuffers.find(c.vertexArray) : c.elementBuffers.end();
+        unsigned int cached = it != c.elementBuffers.end() ? it->second : Unknown;
+        if (!skip(cached, id, stats.bufferSkipped)) {
+            GLCall(glBindBuffer(target, id));
+            if (c.vertexArray != Unknown)
+                c.elementBuffers[c.vertexArray] = id;
+        }
+        validate("element array buffer", GL_ELEMENT_ARRAY_BUFFER_BINDING, id);
+        return;
+    }
+
+    int slot = bufferSlot(target);
+    if (slot < 0) {
+        GLCall(glBindBuffer(target, id));
+        return;
+    }
+    if (!skip(c.buffers[slot], id, stats.bufferSkipped)) {
+        GLCall(glBindBuffer(target, id));
+        c.buffers[slot] = id;
+    }
+    validate("buffer", bufferBindingQueries[slot], c.buffers[slot]);
+}
+
+void GLState::useProgram(unsigned int id)
+{
+    Cache& c = getCache();
+    if (!skip(c.program, id, stats.programSkipped)) {
+        GLCall(glUseProgram(id));
+        c.program = id;
+        stats.programBinds++;
+    }
+    validate("program", GL_CURRENT_PROGRAM, c.program);
+}
+
+void GLState::bindTexture(unsigned int unit, GLenum target, unsigned int id)
+{
+    Cache& c = getCache();
+    int slot = textureSlot(target);
+    if (slot < 0 || unit >= MaxTextureUnits) {
+        setActiveTexture(c, unit);
+        GLCall(glBindTexture(target, id));
+        return;
+    }
+
+    if (!skip(c.textures[unit][slot], id, stats.textureSkipped)) {
+        setActiveTexture(c, unit);
+        GLCall(glBindTexture(target, id));
+        c.textures[unit][slot] = id;
+    }
+    if (validation) {
+        setActiveTexture(c, unit);
+        validate("texture", textureBindingQueries[slot], c.textures[unit][slot]);
+    }
+}
+
+void GLState::bindUniformBufferRange(unsigned int index, unsigned int id, GLintptr offset, GLsizeiptr size)
+{
+    Cache& c = getCache();
+    int slot = bufferSlot(GL_UNIFORM_BUFFER);
+    if (index >= MaxUniformBufferBindings) {
+        GLCall(glBindBufferRange(GL_UNIFORM_BUFFER, index, id, offset, size));
+        c.buffers[slot] = id;
+        stats.uniformBufferRangeBinds++;
+        return;
+    }
+
+    BufferRange& range = c.uniformRanges[index];
+    stats.requested++;
+    if (range.id == id && range.offset == offset && range.size == size) {
+        stats.skipped++;
+        stats.bufferSkipped++;
+    }
+    else {
+        GLCall(glBindBufferRange(GL_UNIFORM_BUFFER, index, id, offset, size));
+        range.id = id;
+        range.offset = offset;
+        range.size = size;
+        c.buffers[slot] = id;
+        stats.uniformBufferRangeBinds++;
+    }
+    if (validation) {
+        GLint actual = 0;
+        GLCall(glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, index, &actual));
+        if ((unsigned int)actual != range.id) {
+            stats.validationMismatches++;
+            std::cerr << "[GLState] uniform buffer binding " << index << " cache mismatch: cached " << range.id
+                << ", driver " << actual << std::endl;
+        }
+    }
+}
+
+void GLState::enable(GLenum capability)
+{
+    setCapability(capability, true);
+}
+
+void GLState::disable(GLenum capability)
+{
+    setCapability(capability, false);
+}
+
+void GLState::blendFunc(GLenum source, GLenum destination)
+{
+    Cache& c = getCache();
+    stats.requested++;
+    if (c.blendSource == source && c.blendDestination == destination) {
+        stats.skipped++;
+        stats.fixedFunctionSkipped++;
+    }
+    else {
+        GLCall(glBlendFunc(source, destination));
+        c.blendSource = source;
+        c.blendDestination = destination;
+    }
+    validate("blend source", GL_BLEND_SRC_RGB, c.blendSource);
+    validate("blend destination", GL_BLEND_DST_RGB, c.blendDestination);
+}
+
+void GLState::depthFunc(GLenum func)
+{
+    Cache& c = getCache();
+    if (!skip(c.depthFunc, func, stats.fixedFunctionSkipped)) {
+        GLCall(glDepthFunc(func));
+        c.depthFunc = func;
+    }
+    validate("depth func", GL_DEPTH_FUNC, c.depthFunc);
+}
+
+void GLState::depthMask(bool write)
+{
+    Cache& c = getCache();
+    if (!skip(c.depthMask, write ? 1 : 0, stats.fixedFunctionSkipped)) {
+        GLCall(glDepthMask(write ? GL_TRUE : GL_FALSE));
+        c.depthMask = write ? 1 : 0;
+    }
+    validate("depth mask", GL_DEPTH_WRITEMASK, c.depthMask);
+}
+
+void GLState::forgetVertexArray(unsigned int id)
+{
+    Cache& c = getCache();
+    c.elementBuffers.erase(id);
+    if (c.vertexArray == id)
+        c.vertexArray = 0;
+}
+
+void GLState::forgetBuffer(unsigned int id)
+{
+    Cache& c = getCache();
+    for (unsigned int& buffer : c.buffers)
+        if (buffer == id)
+            buffer = 0;
+    for (BufferRange& range : c.uniformRanges)
+        if (range.id == id)
+            range.id = 0;
+    // Deleting a buffer only detaches it from the currently bound VAO.
+    if (c.vertexArray != Unknown) {
+        auto it = c.elementBuffers.find(c.vertexArray);
+        if (it != c.elementBuffers.end() && it->second == id)
+            it->second = 0;
+    }
+}
+
+void GLState::forgetProgram(unsigned int id)
+{
+    // A deleted program stays in use until another one is bound, so the cache
+    // remains correct; just make sure a recycled name is not mistaken for it.
+    Cache& c = getCache();
+    if (c.program == id)
+        c.program = Unknown;
+}
+
+void GLState::forgetTexture(unsigned int id)
+{
+    Cache& c = getCache();
+    for (auto& unit : c.textures)
+        for (unsigned int& texture : unit)
+            if (texture == id)
+                texture = 0;
+}
+
+void GLState::invalidate()
+{
+    cache.vertexArray = Unknown;
+    cache.elementBuffers.clear();
+    for (unsigned int& buffer : cache.buffers)
+        buffer = Unknown;
+    for (BufferRange& range : cache.uniformRanges)
+        range.id = Unknown;
+    cache.program = Unknown;
+    cache.activeTexture = Unknown;
+    for (auto& unit : cache.textures)
+        for (unsigned int& texture : unit)
+            texture = Unknown;
+    for (unsigned int& capability : cache.capabilities)
+        capability = Unknown;
+    cache.blendSource = Unknown;
+    cache.blendDestination = Unknown;
+    cache.depthFunc = Unknown;
+    cache.depthMask = Unknown;
+    cacheInitialized = true;
+}
+
+void GLState::setValidation(bool enabled)
+{
+    validation = enabled;
+}
+
+bool GLState::getValidation()
+{
+    return validation;
+}
+
+const GLStateStats& GLState::getStats()
+{
+    return stats;
+}
+
+void GLState::resetStats()
+{
+    stats = GLStateStats();
+}
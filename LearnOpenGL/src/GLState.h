@@ -0,0 +1,66 @@
+#pragma once
+#include "Application.h"
+
+struct GLStateStats
+{
+	unsigned int requested = 0;
+	unsigned int skipped = 0;
+
+	unsigned int vertexArraySkipped = 0;
+	unsigned int bufferSkipped = 0;
+	unsigned int programSkipped = 0;
+	unsigned int textureSkipped = 0;
+	unsigned int fixedFunctionSkipped = 0;
+
+	// Binds forwarded to GL.
+	unsigned int vertexArrayBinds = 0;
+	unsigned int programBinds = 0;
+	unsigned int uniformBufferRangeBinds = 0;
+
+	unsigned int validationMismatches = 0;
+};
+
+// Shadow copy of the GL binding state for the current context. Every bind in the
+// code base goes through here so calls that would not change anything are dropped
+// before they reach the driver. Cached values start out unknown, so the first call
+// for each binding is always forwarded.
+//
+// The element array binding is vertex array state, so it is cached per VAO.
+class GLState
+{
+public:
+	static const unsigned int MaxTextureUnits = 32;
+	static const unsigned int MaxUniformBufferBindings = 16;
+
+	static void bindVertexArray(unsigned int id);
+	static void bindBuffer(GLenum target, unsigned int id);
+	static void useProgram(unsigned int id);
+	static void bindTexture(unsigned int unit, GLenum target, unsigned int id);
+	// glBindBufferRange on GL_UNIFORM_BUFFER. Also moves the generic
+	// GL_UNIFORM_BUFFER binding, as GL does.
+	static void bindUniformBufferRange(unsigned int index, unsigned int id, GLintptr offset, GLsizeiptr size);
+
+	static void enable(GLenum capability);
+	static void disable(GLenum capability);
+	static void blendFunc(GLenum source, GLenum destination);
+	static void depthFunc(GLenum func);
+	static void depthMask(bool write);
+
+	// Must be called before the matching glDelete* so the cache does not keep a
+	// name that GL has silently unbound.
+	static void forgetVertexArray(unsigned int id);
+	static void forgetBuffer(unsigned int id);
+	static void forgetProgram(unsigned int id);
+	static void forgetTexture(unsigned int id);
+
+	// Marks everything unknown, e.g. after code that talks to GL directly.
+	static void invalidate();
+
+	// When enabled, each call cross-checks the cache against glGet* and reports
+	// any difference. This is slow and meant for debug builds only.
+	static void setValidation(bool enabled);
+	static bool getValidation();
+
+	static const GLStateStats& getStats();
+	static void resetStats();
+};
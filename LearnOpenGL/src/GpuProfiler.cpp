@@ -0,0 +1,218 @@
+#include "GpuProfiler.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+struct ScopeRecord
+{
+    const char* name;
+    unsigned int depth;
+};
+
+struct FrameSlot
+{
+    // Two timestamps per scope: begin at 2i, end at 2i + 1.
+    unsigned int queries[GpuProfiler::MaxScopesPerFrame * 2];
+    std::vector<ScopeRecord> scopes;
+    // The most recently issued query; the frame is done once it is.
+    unsigned int lastIssued;
+    // GL timestamp and steady_clock time taken together at frame start.
+    GLint64 gpuBase;
+    double cpuBase;
+};
+
+// Stack entry of a scope past MaxScopesPerFrame.
+const unsigned int Unmeasured = 0xFFFFFFFFu;
+
+bool enabled = false;
+bool tracing = false;
+bool created = false;
+FrameSlot slots[GpuProfiler::FrameLatency];
+unsigned int frameIndex = 0;
+bool frameOpen = false;
+std::vector<unsigned int> stack;
+std::vector<GpuScopeStats> stats;
+std::vector<TraceEvent> events;
+unsigned int droppedFrames = 0;
+
+double cpuMicroseconds()
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+GpuScopeStats& findStats(const char* name, unsigned int depth)
+{
+    for (GpuScopeStats& entry : stats)
+        if (entry.depth == depth && (entry.name == name || std::strcmp(entry.name, name) == 0))
+            return entry;
+    stats.push_back({ name, depth, 0, 0.0, 0.0, 0.0 });
+    return stats.back();
+}
+
+// Reads a finished frame back into the statistics. Returns false, leaving
+// the slot untouched, if the GPU has not got that far yet.
+bool resolve(FrameSlot& slot, bool wait)
+{
+    if (slot.scopes.empty())
+        return true;
+
+    GLuint available = GL_FALSE;
+    GLCall(glGetQueryObjectuiv(slot.lastIssued, GL_QUERY_RESULT_AVAILABLE, &available));
+    if (!available && !wait)
+        return false;
+
+    // Queries complete in order, so every earlier result is in as well.
+    for (size_t i = 0; i < slot.scopes.size(); i++) {
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        GLCall(glGetQueryObjectui64v(slot.queries[i * 2], GL_QUERY_RESULT, &begin));
+        GLCall(glGetQueryObjectui64v(slot.queries[i * 2 + 1], GL_QUERY_RESULT, &end));
+        double milliseconds = (double)(end - begin) / 1e6;
+
+        GpuScopeStats& entry = findStats(slot.scopes[i].name, slot.scopes[i].depth);
+        if (entry.count == 0 || milliseconds < entry.min)
+            entry.min = milliseconds;
+        if (entry.count == 0 || milliseconds > entry.max)
+            entry.max = milliseconds;
+        entry.total += milliseconds;
+        entry.count++;
+
+        if (tracing && events.size() < GpuProfiler::MaxTraceEvents) {
+            double start = slot.cpuBase + (double)((GLint64)begin - slot.gpuBase) / 1e3;
+            events.push_back({ slot.scopes[i].name, start, milliseconds * 1e3, GpuProfiler::TraceThread });
+        }
+    }
+    slot.scopes.clear();
+    return true;
+}
+
+void closeFrame()
+{
+    while (!stack.empty())
+        GpuProfiler::pop();
+    frameOpen = false;
+}
+
+}
+
+void GpuProfiler::setEnabled(bool enable)
+{
+    if (enable && !created) {
+        for (FrameSlot& slot : slots) {
+            GLCall(glGenQueries(MaxScopesPerFrame * 2, slot.queries));
+            slot.scopes.reserve(MaxScopesPerFrame);
+            slot.lastIssued = 0;
+            slot.gpuBase = 0;
+            slot.cpuBase = 0.0;
+        }
+        stack.reserve(32);
+        created = true;
+    }
+    if (!enable && frameOpen)
+        closeFrame();
+    enabled = enable;
+}
+
+bool GpuProfiler::isEnabled()
+{
+    return enabled;
+}
+
+void GpuProfiler::setTracing(bool enable)
+{
+    tracing = enable;
+}
+
+void GpuProfiler::beginFrame()
+{
+    if (!enabled)
+        return;
+    if (frameOpen) {
+        closeFrame();
+        frameIndex++;
+    }
+
+    FrameSlot& slot = slots[frameIndex % FrameLatency];
+    if (!resolve(slot, false)) {
+        droppedFrames++;
+        slot.scopes.clear();
+    }
+
+    // Pairs the GPU clock with the CPU one so trace events share a timeline.
+    // Queried without a fence, so the offset includes a little driver latency.
+    if (tracing) {
+        GLCall(glGetInteger64v(GL_TIMESTAMP, &slot.gpuBase));
+        slot.cpuBase = cpuMicroseconds();
+    }
+    frameOpen = true;
+}
+
+void GpuProfiler::push(const char* name)
+{
+    if (!enabled || !frameOpen)
+        return;
+    FrameSlot& slot = slots[frameIndex % FrameLatency];
+    if (slot.scopes.size() == MaxScopesPerFrame) {
+        // Keep the stack balanced; the scope simply goes unmeasured.
+        stack.push_back(Unmeasured);
+        return;
+    }
+    unsigned int index = (unsigned int)slot.scopes.size();
+    slot.scopes.push_back({ name, (unsigned int)stack.size() });
+    GLCall(glQueryCounter(slot.queries[index * 2], GL_TIMESTAMP));
+    slot.lastIssued = slot.queries[index * 2];
+    stack.push_back(index);
+}
+
+void GpuProfiler::pop()
+{
+    if (!enabled || stack.empty())
+        return;
+    unsigned int index = stack.back();
+    stack.pop_back();
+    if (index != Unmeasured) {
+        FrameSlot& slot = slots[frameIndex % FrameLatency];
+        GLCall(glQueryCounter(slot.queries[index * 2 + 1], GL_TIMESTAMP));
+        slot.lastIssued = slot.queries[index * 2 + 1];
+    }
+}
+
+const std::vector<GpuScopeStats>& GpuProfiler::getStats()
+{
+    return stats;
+}
+
+void GpuProfiler::resetStats()
+{
+    stats.clear();
+    droppedFrames = 0;
+}
+
+unsigned int GpuProfiler::getDroppedFrames()
+{
+    return droppedFrames;
+}
+
+void GpuProfiler::exportTrace(ChromeTrace& trace)
+{
+    trace.setThreadName(TraceThread, "GPU");
+    trace.append(events);
+}
+
+void GpuProfiler::shutdown()
+{
+    if (!created)
+        return;
+    if (frameOpen)
+        closeFrame();
+    // Oldest first, so the statistics keep frame order.
+    for (unsigned int i = 1; i <= FrameLatency; i++)
+        resolve(slots[(frameIndex + i) % FrameLatency], true);
+    for (FrameSlot& slot : slots) {
+        GLCall(glDeleteQueries(MaxScopesPerFrame * 2, slot.queries));
+    }
+    created = false;
+    enabled = false;
+}
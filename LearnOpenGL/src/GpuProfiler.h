@@ -0,0 +1,74 @@
+#pragma once
+#include <vector>
+
+#include "Application.h"
+#include "ChromeTrace.h"
+
+// Aggregated GPU time of one scope, in milliseconds.
+struct GpuScopeStats
+{
+	const char* name;
+	unsigned int depth;
+	unsigned int count;
+	double min;
+	double max;
+	double total;
+
+	inline double getAverage() const { return count ? total / count : 0.0; };
+};
+
+// GPU timing of nested scopes. Both ends of a scope are GL_TIMESTAMP
+// queries (glQueryCounter), which unlike GL_TIME_ELAPSED may nest. Queries
+// sit in a ring FrameLatency frames deep and a frame's results are read in
+// beginFrame() once the ring comes back round to it; a frame still not done
+// then is dropped rather than waited for.
+//
+// Results feed per-scope min / average / max statistics and, when tracing,
+// Chrome trace events mapped onto the CPU clock. Scope names must be string
+// literals or otherwise outlive the profiler. Does nothing until enabled.
+class GpuProfiler
+{
+public:
+	static const unsigned int FrameLatency = 4;
+	static const unsigned int MaxScopesPerFrame = 128;
+	// Trace events kept for export; later ones are dropped.
+	static const unsigned int MaxTraceEvents = 1 << 18;
+	// Thread id of GPU events in the trace.
+	static const unsigned int TraceThread = 0xFFFF;
+
+	// Needs a current context. Creating the query pool is deferred to here.
+	static void setEnabled(bool enabled);
+	static bool isEnabled();
+	static void setTracing(bool tracing);
+
+	// Call once per frame before the first scope.
+	static void beginFrame();
+	static void push(const char* name);
+	static void pop();
+
+	// Statistics ordered by first appearance.
+	static const std::vector<GpuScopeStats>& getStats();
+	static void resetStats();
+	// Frames whose queries were not ready when their slot was reused.
+	static unsigned int getDroppedFrames();
+	static void exportTrace(ChromeTrace& trace);
+
+	// Waits for the outstanding frames and deletes the queries. Needs a
+	// current context.
+	static void shutdown();
+};
+
+class GpuScope
+{
+public:
+	inline GpuScope(const char* name) { GpuProfiler::push(name); };
+	inline ~GpuScope() { GpuProfiler::pop(); };
+
+	GpuScope(const GpuScope&) = delete;
+	GpuScope& operator=(const GpuScope&) = delete;
+};
+
+#define GPU_SCOPE_CONCAT_(a, b) a##b
+#define GPU_SCOPE_CONCAT(a, b) GPU_SCOPE_CONCAT_(a, b)
+// Times the rest of the enclosing block on the GPU.
+#define GPU_SCOPE(name) GpuScope GPU_SCOPE_CONCAT(gpuScope, __LINE__)(name)
@@ -0,0 +1,98 @@
+#include "IndexConversion.h"
+#include "Application.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define INDEX_CONVERSION_SSE2 1
+#include <emmintrin.h>
+#endif
+
+uint32_t reduceIndexBits(const uint32_t* indices, size_t count)
+{
+    size_t i = 0;
+    uint32_t bits = 0;
+#ifdef INDEX_CONVERSION_SSE2
+    __m128i accumulator = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(indices + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(indices + i + 4));
+        __m128i c = _mm_loadu_si128((const __m128i*)(indices + i + 8));
+        __m128i d = _mm_loadu_si128((const __m128i*)(indices + i + 12));
+        accumulator = _mm_or_si128(accumulator, _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)));
+    }
+    accumulator = _mm_or_si128(accumulator, _mm_srli_si128(accumulator, 8));
+    accumulator = _mm_or_si128(accumulator, _mm_srli_si128(accumulator, 4));
+    bits = (uint32_t)_mm_cvtsi128_si32(accumulator);
+#endif
+    for (; i < count; i++)
+        bits |= indices[i];
+    return bits;
+}
+
+unsigned int selectIndexType(const uint32_t* indices, size_t count)
+{
+    uint32_t bits = reduceIndexBits(indices, count);
+    if (bits <= 0xFF)
+        return GL_UNSIGNED_BYTE;
+    if (bits <= 0xFFFF)
+        return GL_UNSIGNED_SHORT;
+    return GL_UNSIGNED_INT;
+}
+
+unsigned int indexTypeSize(unsigned int type)
+{
+    switch (type) {
+    case GL_UNSIGNED_BYTE: return 1;
+    case GL_UNSIGNED_SHORT: return 2;
+    default: return 4;
+    }
+}
+
+void convertIndices16Scalar(const uint32_t* in, uint16_t* out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        out[i] = (uint16_t)in[i];
+}
+
+void convertIndices8Scalar(const uint32_t* in, uint8_t* out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        out[i] = (uint8_t)in[i];
+}
+
+void convertIndices16(const uint32_t* in, uint16_t* out, size_t count)
+{
+    size_t i = 0;
+#ifdef INDEX_CONVERSION_SSE2
+    // SSE2 only has a signed 32 -> 16 pack, so bias into the signed range,
+    // pack, and undo the bias in 16 bits.
+    const __m128i bias32 = _mm_set1_epi32(0x8000);
+    const __m128i bias16 = _mm_set1_epi16((short)0x8000);
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(in + i)), bias32);
+        __m128i b = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(in + i + 4)), bias32);
+        __m128i packed = _mm_add_epi16(_mm_packs_epi32(a, b), bias16);
+        _mm_storeu_si128((__m128i*)(out + i), packed);
+    }
+#endif
+    for (; i < count; i++)
+        out[i] = (uint16_t)in[i];
+}
+
+void convertIndices8(const uint32_t* in, uint8_t* out, size_t count)
+{
+    size_t i = 0;
+#ifdef INDEX_CONVERSION_SSE2
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(in + i + 4));
+        __m128i c = _mm_loadu_si128((const __m128i*)(in + i + 8));
+        __m128i d = _mm_loadu_si128((const __m128i*)(in + i + 12));
+        // Values are at most 255, so neither saturating pack changes them.
+        __m128i low = _mm_packs_epi32(a, b);
+        __m128i high = _mm_packs_epi32(c, d);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(low, high));
+    }
+#endif
+    for (; i < count; i++)
+        out[i] = (uint8_t)in[i];
+}
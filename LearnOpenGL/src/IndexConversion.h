@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Helpers for storing indices in the narrowest type that can hold them.
+// The narrowing kernels use SSE2 when the target has it.
+
+// Bitwise OR of all indices. Every index fits in 8 or 16 bits exactly when
+// this does, so it answers the same question as the maximum with cheaper SIMD.
+uint32_t reduceIndexBits(const uint32_t* indices, size_t count);
+
+// Smallest of GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT and GL_UNSIGNED_INT that can
+// hold every index.
+unsigned int selectIndexType(const uint32_t* indices, size_t count);
+unsigned int indexTypeSize(unsigned int type);
+
+// Narrow indices that are known to fit.
+void convertIndices16(const uint32_t* in, uint16_t* out, size_t count);
+void convertIndices8(const uint32_t* in, uint8_t* out, size_t count);
+
+// Plain loops, for reference and benchmarking.
+void convertIndices16Scalar(const uint32_t* in, uint16_t* out, size_t count);
+void convertIndices8Scalar(const uint32_t* in, uint8_t* out, size_t count);
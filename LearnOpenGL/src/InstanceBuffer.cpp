@@ -0,0 +1,95 @@
+#include "InstanceBuffer.h"
+#include "GLState.h"
+#include "DeletionQueue.h"
+
+InstanceBuffer::InstanceBuffer(unsigned int initialCapacity)
+    : stream(nullptr), gpuCapacity(initialCapacity > 0 ? initialCapacity : 64), uploadedCount(0), firstInstance(0)
+{
+    instances.reserve(initialCapacity);
+    GLCall(glGenBuffers(1, &bufferID));
+    GLState::bindBuffer(GL_ARRAY_BUFFER, bufferID);
+    GLCall(glBufferData(GL_ARRAY_BUFFER, gpuCapacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW));
+}
+
+InstanceBuffer::InstanceBuffer(StreamingVertexBuffer* stream, unsigned int initialCapacity)
+    : stream(stream), bufferID(stream->getId()), gpuCapacity(0), uploadedCount(0), firstInstance(0)
+{
+    // Draws pick their part of the stream with baseInstance.
+    ASSERT(GLAD_GL_VERSION_4_2);
+    instances.reserve(initialCapacity);
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+    // A shared stream belongs to its owner.
+    if (!stream)
+        DeletionQueue::deleteBuffer(bufferID);
+}
+
+InstanceData& InstanceBuffer::append()
+{
+    instances.emplace_back();
+    return instances.back();
+}
+
+InstanceData InstanceBuffer::translationScale(float x, float y, float z, float scale, const float colour[4])
+{
+    InstanceData instance = {
+        {
+            scale, 0.0f, 0.0f, 0.0f,
+            0.0f, scale, 0.0f, 0.0f,
+            0.0f, 0.0f, scale, 0.0f,
+            x, y, z, 1.0f
+        },
+        { colour[0], colour[1], colour[2], colour[3] }
+    };
+    return instance;
+}
+
+void InstanceBuffer::upload()
+{
+    unsigned int count = getCount();
+    uploadedCount = count;
+    if (stream) {
+        firstInstance = 0;
+        if (count) {
+            unsigned int offset = stream->write(instances.data(), count * sizeof(InstanceData), sizeof(InstanceData));
+            // A full section drops the instances rather than overwrite ones in flight.
+            if (offset == StreamingVertexBuffer::WriteFailed)
+                uploadedCount = 0;
+            else
+                firstInstance = offset / sizeof(InstanceData);
+        }
+        return;
+    }
+
+    GLState::bindBuffer(GL_ARRAY_BUFFER, bufferID);
+    while (gpuCapacity < count)
+        gpuCapacity *= 2;
+    GLCall(glBufferData(GL_ARRAY_BUFFER, gpuCapacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW));
+    if (count) {
+        GLCall(glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData), instances.data()));
+    }
+}
+
+void InstanceBuffer::bind()
+{
+    GLState::bindBuffer(GL_ARRAY_BUFFER, bufferID);
+}
+
+void InstanceBuffer::setAttributes(unsigned int vertexArray)
+{
+    GLState::bindVertexArray(vertexArray);
+    bind();
+    const GLsizei stride = sizeof(InstanceData);
+    for (unsigned int column = 0; column < 4; column++) {
+        unsigned int location = FirstAttribute + column;
+        GLCall(glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, (const void*)(column * 4 * sizeof(float))));
+        GLCall(glVertexAttribDivisor(location, 1));
+        GLCall(glEnableVertexAttribArray(location));
+    }
+    unsigned int colourLocation = FirstAttribute + 4;
+    GLCall(glVertexAttribPointer(colourLocation, 4, GL_FLOAT, GL_FALSE, stride, (const void*)(16 * sizeof(float))));
+    GLCall(glVertexAttribDivisor(colourLocation, 1));
+    GLCall(glEnableVertexAttribArray(colourLocation));
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+
+#include "Application.h"
+#include "StreamingVertexBuffer.h"
+
+// Per-instance attributes, read at locations 2-5 (column-major mat4 transform)
+// and 6 (colour multiplier) with an attribute divisor of 1.
+struct InstanceData
+{
+	float transform[16];
+	float colour[4];
+};
+
+// CPU-side instance list plus the GL buffer it is uploaded to. The list keeps
+// its capacity across clear(), so refilling it every frame does not allocate.
+//
+// Instances rewritten every frame go through a StreamingVertexBuffer shared by
+// all instance buffers (GL 4.2): each upload lands in the stream's current
+// section and draws select it with baseInstance. The stream's owner calls
+// beginFrame() before the frame's uploads and endFrame() after its draws, so a
+// frame costs one fence however many buffers it fills. Without a stream the
+// instances get a buffer of their own, orphaned on every upload, which suits
+// instances uploaded once.
+class InstanceBuffer
+{
+private:
+	std::vector<InstanceData> instances;
+	StreamingVertexBuffer* stream;
+	unsigned int bufferID;
+	unsigned int gpuCapacity;
+	unsigned int uploadedCount;
+	unsigned int firstInstance;
+public:
+	static const unsigned int FirstAttribute = 2;
+	static const unsigned int AttributeCount = 5;
+
+	InstanceBuffer(unsigned int initialCapacity = 1024);
+	// Sections of the stream should hold a whole number of instances and be
+	// large enough for every instance uploaded in a frame.
+	InstanceBuffer(StreamingVertexBuffer* stream, unsigned int initialCapacity = 1024);
+	~InstanceBuffer();
+
+	InstanceBuffer(const InstanceBuffer&) = delete;
+	InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+	inline void clear() { instances.clear(); };
+	inline void reserve(unsigned int count) { instances.reserve(count); };
+	inline void append(const InstanceData& instance) { instances.push_back(instance); };
+	// Appends a default-initialised instance and returns it for filling in place.
+	InstanceData& append();
+	static InstanceData translationScale(float x, float y, float z, float scale, const float colour[4]);
+
+	// Copies the CPU list to the GPU without waiting on draws still reading
+	// earlier frames' instances. With a stream, call once per frame between
+	// its beginFrame() and endFrame().
+	void upload();
+	void bind();
+	// Sets up the instanced attributes on a vertex array, leaving it bound.
+	void setAttributes(unsigned int vertexArray);
+
+	inline unsigned int getId() { return bufferID; };
+	inline unsigned int getCount() const { return (unsigned int)instances.size(); };
+	// Instances in the GL buffer as of the last upload(); draws may not read past them.
+	inline unsigned int getUploadedCount() const { return uploadedCount; };
+	// baseInstance for draws reading the last upload.
+	inline unsigned int getFirstInstance() const { return firstInstance; };
+	inline InstanceData& operator[](unsigned int index) { return instances[index]; };
+};
@@ -0,0 +1,51 @@
+#include "LinearAllocator.h"
+
+LinearAllocator::LinearAllocator(size_t chunkSize)
+    : chunkSize(chunkSize > 0 ? chunkSize : 1), current(0)
+{
+}
+
+void* LinearAllocator::allocate(size_t size, size_t alignment)
+{
+    while (current < chunks.size()) {
+        Chunk& chunk = chunks[current];
+        size_t offset = (chunk.used + alignment - 1) & ~(alignment - 1);
+        if (offset + size <= chunk.capacity) {
+            chunk.used = offset + size;
+            return chunk.data.get() + offset;
+        }
+        // Chunks past the current one are left over from before the last
+        // reset() and empty.
+        if (current + 1 == chunks.size())
+            break;
+        chunks[++current].used = 0;
+    }
+
+    Chunk chunk;
+    chunk.capacity = size > chunkSize ? size : chunkSize;
+    chunk.data.reset(new unsigned char[chunk.capacity]);
+    chunk.used = size;
+    if (!chunks.empty() && chunks[current].used > 0)
+        current++;
+    // An empty current chunk that was too small is replaced in place.
+    if (current < chunks.size())
+        chunks[current] = std::move(chunk);
+    else
+        chunks.push_back(std::move(chunk));
+    return chunks[current].data.get();
+}
+
+void LinearAllocator::reset()
+{
+    current = 0;
+    if (!chunks.empty())
+        chunks[0].used = 0;
+}
+
+size_t LinearAllocator::getCapacity() const
+{
+    size_t capacity = 0;
+    for (const Chunk& chunk : chunks)
+        capacity += chunk.capacity;
+    return capacity;
+}
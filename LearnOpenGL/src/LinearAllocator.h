@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Bump allocator over a list of chunks. Allocation advances a pointer and
+// never moves earlier allocations; reset() rewinds to the first chunk and
+// keeps the memory, so a frame that fits in the previous one's chunks does
+// not allocate. Nothing is freed individually and no destructors run.
+//
+// Not thread safe: each recording thread owns its allocator.
+class LinearAllocator
+{
+private:
+	struct Chunk
+	{
+		std::unique_ptr<unsigned char[]> data;
+		size_t capacity;
+		size_t used;
+	};
+
+	std::vector<Chunk> chunks;
+	size_t chunkSize;
+	size_t current;
+public:
+	LinearAllocator(size_t chunkSize = 64 * 1024);
+	~LinearAllocator() = default;
+
+	LinearAllocator(LinearAllocator&&) = default;
+	LinearAllocator& operator=(LinearAllocator&&) = default;
+
+	// alignment must be a power of two no larger than alignof(std::max_align_t).
+	// Requests bigger than the chunk size get a chunk of their own.
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+	template<typename T>
+	inline T* allocate() { return static_cast<T*>(allocate(sizeof(T), alignof(T))); };
+	void reset();
+
+	// Chunks in allocation order, for walking what was allocated. Chunks
+	// past the current one are empty after a reset().
+	inline size_t getChunkCount() const { return current < chunks.size() ? current + 1 : 0; };
+	inline const unsigned char* getChunkData(size_t chunk) const { return chunks[chunk].data.get(); };
+	inline size_t getChunkUsed(size_t chunk) const { return chunks[chunk].used; };
+	size_t getCapacity() const;
+};
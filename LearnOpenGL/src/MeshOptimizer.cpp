@@ -0,0 +1,341 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const uint32_t Empty = 0xFFFFFFFFu;
+
+uint32_t hashBytes(const unsigned char* data, unsigned int size)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (unsigned int i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+//
+// Forsyth vertex cache optimization scoring.
+//
+
+const unsigned int ForsythCacheSize = 32;
+const float CacheDecayPower = 1.5f;
+const float LastTriangleScore = 0.75f;
+const float ValenceBoostScale = 2.0f;
+const float ValenceBoostPower = 0.5f;
+
+float vertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+    if (remainingTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            score = LastTriangleScore;
+        }
+        else {
+            float scaler = 1.0f / (ForsythCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, CacheDecayPower);
+        }
+    }
+    score += ValenceBoostScale * std::pow((float)remainingTriangles, -ValenceBoostPower);
+    return score;
+}
+
+void readPosition(const OptimizerMesh& mesh, uint32_t vertex, unsigned int positionOffset, float* position)
+{
+    std::memcpy(position, mesh.vertices.data() + (size_t)vertex * mesh.stride + positionOffset, 3 * sizeof(float));
+}
+
+}
+
+unsigned int MeshOptimizer::weldVertices(OptimizerMesh& mesh)
+{
+    const unsigned int vertexCount = mesh.getVertexCount();
+    const unsigned int stride = mesh.stride;
+    if (vertexCount == 0)
+        return 0;
+
+    unsigned int tableSize = 1;
+    while (tableSize < vertexCount * 2)
+        tableSize <<= 1;
+    std::vector<uint32_t> table(tableSize, Empty);
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<unsigned char> welded;
+    welded.reserve(mesh.vertices.size());
+
+    unsigned int unique = 0;
+    for (unsigned int v = 0; v < vertexCount; v++) {
+        const unsigned char* vertex = mesh.vertices.data() + (size_t)v * stride;
+        uint32_t slot = hashBytes(vertex, stride) & (tableSize - 1);
+        // Linear probing over indices into the welded array.
+        while (table[slot] != Empty && std::memcmp(welded.data() + (size_t)table[slot] * stride, vertex, stride) != 0)
+            slot = (slot + 1) & (tableSize - 1);
+
+        if (table[slot] == Empty) {
+            table[slot] = unique++;
+            welded.insert(welded.end(), vertex, vertex + stride);
+        }
+        remap[v] = table[slot];
+    }
+
+    for (uint32_t& index : mesh.indices)
+        index = remap[index];
+    mesh.vertices.swap(welded);
+    return unique;
+}
+
+void MeshOptimizer::optimizeVertexCache(OptimizerMesh& mesh)
+{
+    const unsigned int vertexCount = mesh.getVertexCount();
+    const unsigned int triangleCount = (unsigned int)(mesh.indices.size() / 3);
+    if (triangleCount == 0)
+        return;
+
+    // Vertex -> triangle adjacency in CSR form.
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (uint32_t index : mesh.indices)
+        remaining[index]++;
+    std::vector<unsigned int> adjacencyStart(vertexCount + 1, 0);
+    for (unsigned int v = 0; v < vertexCount; v++)
+        adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+    std::vector<unsigned int> adjacency(mesh.indices.size());
+    std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (unsigned int t = 0; t < triangleCount; t++)
+        for (unsigned int k = 0; k < 3; k++)
+            adjacency[fill[mesh.indices[t * 3 + k]]++] = t;
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> score(vertexCount);
+    for (unsigned int v = 0; v < vertexCount; v++)
+        score[v] = vertexScore(-1, remaining[v]);
+    std::vector<float> triangleScore(triangleCount);
+    for (unsigned int t = 0; t < triangleCount; t++)
+        triangleScore[t] = score[mesh.indices[t * 3]] + score[mesh.indices[t * 3 + 1]] + score[mesh.indices[t * 3 + 2]];
+    std::vector<bool> emitted(triangleCount, false);
+
+    std::vector<uint32_t> cache;
+    cache.reserve(ForsythCacheSize + 3);
+    std::vector<uint32_t> newCache;
+    newCache.reserve(ForsythCacheSize + 3);
+    std::vector<uint32_t> output;
+    output.reserve(mesh.indices.size());
+
+    unsigned int scanCursor = 0;
+    unsigned int best = 0;
+    float bestScore = -1.0f;
+    for (unsigned int t = 0; t < triangleCount; t++) {
+        if (triangleScore[t] > bestScore) {
+            bestScore = triangleScore[t];
+            best = t;
+        }
+    }
+
+    for (unsigned int emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        if (bestScore < 0.0f) {
+            // Nothing adjacent to the cache: take the next unemitted triangle.
+            while (emitted[scanCursor])
+                scanCursor++;
+            best = scanCursor;
+        }
+
+        const uint32_t* triangle = &mesh.indices[best * 3];
+        output.insert(output.end(), triangle, triangle + 3);
+        emitted[best] = true;
+
+        // Remove the triangle from its vertices' adjacency lists.
+        for (unsigned int k = 0; k < 3; k++) {
+            uint32_t v = triangle[k];
+            unsigned int* begin = &adjacency[adjacencyStart[v]];
+            unsigned int* end = begin + remaining[v];
+            unsigned int* found = std::find(begin, end, best);
+            if (found != end) {
+                std::swap(*found, *(end - 1));
+                remaining[v]--;
+            }
+        }
+
+        // New LRU order: this triangle's vertices first, then the old cache.
+        newCache.assign(triangle, triangle + 3);
+        for (uint32_t v : cache)
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                newCache.push_back(v);
+        for (size_t i = ForsythCacheSize; i < newCache.size(); i++)
+            cachePosition[newCache[i]] = -1;
+        if (newCache.size() > ForsythCacheSize)
+            newCache.resize(ForsythCacheSize);
+        cache.swap(newCache);
+
+        // Rescore vertices in the cache (and the ones that just left it),
+        // then the triangles around them, tracking the best candidate.
+        for (unsigned int i = 0; i < cache.size(); i++)
+            cachePosition[cache[i]] = (int)i;
+        bestScore = -1.0f;
+        for (size_t i = 0; i < newCache.size(); i++) {
+            uint32_t v = newCache[i];
+            if (cachePosition[v] < 0)
+                score[v] = vertexScore(-1, remaining[v]);
+        }
+        for (uint32_t v : cache)
+            score[v] = vertexScore(cachePosition[v], remaining[v]);
+        for (uint32_t v : cache) {
+            for (unsigned int a = 0; a < remaining[v]; a++) {
+                unsigned int t = adjacency[adjacencyStart[v] + a];
+                const uint32_t* tri = &mesh.indices[t * 3];
+                float s = score[tri[0]] + score[tri[1]] + score[tri[2]];
+                triangleScore[t] = s;
+                if (s > bestScore) {
+                    bestScore = s;
+                    best = t;
+                }
+            }
+        }
+    }
+
+    mesh.indices.swap(output);
+}
+
+void MeshOptimizer::optimizeOverdraw(OptimizerMesh& mesh, unsigned int positionOffset)
+{
+    const unsigned int vertexCount = mesh.getVertexCount();
+    const unsigned int triangleCount = (unsigned int)(mesh.indices.size() / 3);
+    if (triangleCount < 2)
+        return;
+
+    // Cluster boundaries: triangles where all three vertices miss the cache.
+    std::vector<unsigned int> clusterStart;
+    std::vector<unsigned int> timestamp(vertexCount, 0);
+    unsigned int time = DefaultCacheSize + 1;
+    for (unsigned int t = 0; t < triangleCount; t++) {
+        unsigned int misses = 0;
+        for (unsigned int k = 0; k < 3; k++) {
+            uint32_t v = mesh.indices[t * 3 + k];
+            if (time - timestamp[v] > DefaultCacheSize) {
+                timestamp[v] = time++;
+                misses++;
+            }
+        }
+        if (t == 0 || misses == 3)
+            clusterStart.push_back(t);
+    }
+    const unsigned int clusterCount = (unsigned int)clusterStart.size();
+    clusterStart.push_back(triangleCount);
+    if (clusterCount < 2)
+        return;
+
+    float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+    for (unsigned int v = 0; v < vertexCount; v++) {
+        float p[3];
+        readPosition(mesh, v, positionOffset, p);
+        for (int c = 0; c < 3; c++)
+            meshCentroid[c] += p[c] / vertexCount;
+    }
+
+    // Sort key: how far the cluster faces away from the mesh centre.
+    std::vector<float> key(clusterCount);
+    for (unsigned int cluster = 0; cluster < clusterCount; cluster++) {
+        float centroid[3] = { 0.0f, 0.0f, 0.0f };
+        float normal[3] = { 0.0f, 0.0f, 0.0f };
+        float totalArea = 0.0f;
+        for (unsigned int t = clusterStart[cluster]; t < clusterStart[cluster + 1]; t++) {
+            float a[3], b[3], c[3];
+            readPosition(mesh, mesh.indices[t * 3], positionOffset, a);
+            readPosition(mesh, mesh.indices[t * 3 + 1], positionOffset, b);
+            readPosition(mesh, mesh.indices[t * 3 + 2], positionOffset, c);
+            float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+            float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int i = 0; i < 3; i++) {
+                centroid[i] += (a[i] + b[i] + c[i]) / 3.0f * area;
+                normal[i] += n[i];
+            }
+            totalArea += area;
+        }
+        float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (totalArea > 0.0f && normalLength > 0.0f) {
+            float dot = 0.0f;
+            for (int i = 0; i < 3; i++)
+                dot += (centroid[i] / totalArea - meshCentroid[i]) * normal[i] / normalLength;
+            key[cluster] = dot;
+        }
+        else {
+            key[cluster] = 0.0f;
+        }
+    }
+
+    std::vector<unsigned int> order(clusterCount);
+    for (unsigned int i = 0; i < clusterCount; i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return key[a] > key[b]; });
+
+    std::vector<uint32_t> output;
+    output.reserve(mesh.indices.size());
+    for (unsigned int cluster : order)
+        output.insert(output.end(), mesh.indices.begin() + clusterStart[cluster] * 3,
+            mesh.indices.begin() + clusterStart[cluster + 1] * 3);
+    mesh.indices.swap(output);
+}
+
+void MeshOptimizer::optimizeVertexFetch(OptimizerMesh& mesh)
+{
+    const unsigned int vertexCount = mesh.getVertexCount();
+    const unsigned int stride = mesh.stride;
+    std::vector<uint32_t> remap(vertexCount, Empty);
+    std::vector<unsigned char> reordered;
+    reordered.reserve(mesh.vertices.size());
+
+    uint32_t next = 0;
+    for (uint32_t& index : mesh.indices) {
+        if (remap[index] == Empty) {
+            remap[index] = next++;
+            const unsigned char* vertex = mesh.vertices.data() + (size_t)index * stride;
+            reordered.insert(reordered.end(), vertex, vertex + stride);
+        }
+        index = remap[index];
+    }
+    mesh.vertices.swap(reordered);
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, unsigned int vertexCount,
+    unsigned int cacheSize)
+{
+    VertexCacheStats stats;
+    if (indices.size() < 3 || vertexCount == 0)
+        return stats;
+
+    std::vector<unsigned int> timestamp(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    unsigned int misses = 0;
+    for (uint32_t index : indices) {
+        if (time - timestamp[index] > cacheSize) {
+            timestamp[index] = time++;
+            misses++;
+        }
+    }
+    stats.acmr = (float)misses / (indices.size() / 3);
+    stats.atvr = (float)misses / vertexCount;
+    return stats;
+}
+
+MeshOptimizerReport MeshOptimizer::optimize(OptimizerMesh& mesh, unsigned int positionOffset)
+{
+    MeshOptimizerReport report;
+    report.verticesBefore = mesh.getVertexCount();
+    report.before = analyzeVertexCache(mesh.indices, mesh.getVertexCount());
+
+    weldVertices(mesh);
+    optimizeVertexCache(mesh);
+    optimizeOverdraw(mesh, positionOffset);
+    optimizeVertexFetch(mesh);
+
+    report.verticesAfter = mesh.getVertexCount();
+    report.after = analyzeVertexCache(mesh.indices, mesh.getVertexCount());
+    return report;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Indexed triangle mesh with interleaved vertices of any layout.
+struct OptimizerMesh
+{
+	std::vector<unsigned char> vertices;
+	unsigned int stride;
+	std::vector<uint32_t> indices;
+
+	inline unsigned int getVertexCount() const { return stride ? (unsigned int)(vertices.size() / stride) : 0; };
+};
+
+struct VertexCacheStats
+{
+	// Average cache miss ratio: vertex shader runs per triangle (0.5 - 3).
+	float acmr = 0.0f;
+	// Average transformed vertex ratio: vertex shader runs per vertex (1 is optimal).
+	float atvr = 0.0f;
+};
+
+struct MeshOptimizerReport
+{
+	unsigned int verticesBefore = 0;
+	unsigned int verticesAfter = 0;
+	VertexCacheStats before;
+	VertexCacheStats after;
+};
+
+// CPU-only mesh preprocessing, run before the data is uploaded to a
+// VertexBuffer/ElementBuffer. Nothing here touches GL.
+//
+// Triangles are reordered but each triangle keeps its own vertex order, so
+// winding and the provoking vertex of flat-shaded attributes are preserved.
+class MeshOptimizer
+{
+public:
+	static const unsigned int DefaultCacheSize = 16;
+
+	// Merges vertices that are bitwise identical and rewrites the indices.
+	// Returns the number of unique vertices.
+	static unsigned int weldVertices(OptimizerMesh& mesh);
+
+	// Reorders triangles for the post-transform vertex cache (Forsyth's
+	// linear-speed algorithm).
+	static void optimizeVertexCache(OptimizerMesh& mesh);
+
+	// Splits the cache-optimized triangle order into clusters at points where
+	// the cache would be cold anyway and sorts the clusters outside-in, so
+	// front-most surfaces tend to be drawn first. positionOffset locates a
+	// float3 position in each vertex.
+	static void optimizeOverdraw(OptimizerMesh& mesh, unsigned int positionOffset = 0);
+
+	// Renumbers vertices in order of first use so vertex fetch walks memory
+	// linearly, dropping unreferenced vertices.
+	static void optimizeVertexFetch(OptimizerMesh& mesh);
+
+	// FIFO cache simulation of the given size.
+	static VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, unsigned int vertexCount,
+		unsigned int cacheSize = DefaultCacheSize);
+
+	// All of the above in order.
+	static MeshOptimizerReport optimize(OptimizerMesh& mesh, unsigned int positionOffset = 0);
+};
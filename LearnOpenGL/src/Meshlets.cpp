@@ -0,0 +1,280 @@
+#include "Meshlets.h"
+#include "GLState.h"
+#include "GpuProfiler.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESHLET_CULL_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const float* positionAt(const float* positions, unsigned int positionStride, uint32_t vertex)
+{
+    return (const float*)((const unsigned char*)positions + (size_t)vertex * positionStride);
+}
+
+}
+
+MeshletSet::MeshletSet(const float* positions, unsigned int positionStride, unsigned int vertexCount,
+    const uint32_t* indices, unsigned int indexCount, unsigned int maxVertices, unsigned int maxTriangles)
+{
+    ASSERT(maxVertices >= 3 && maxTriangles >= 1);
+
+    // Which meshlet last referenced each vertex, to count unique vertices.
+    std::vector<unsigned int> stamp(vertexCount, 0xFFFFFFFFu);
+    unsigned int current = 0;
+    unsigned int firstIndex = 0;
+    unsigned int meshletVertices = 0;
+
+    for (unsigned int i = 0; i + 2 < indexCount; i += 3) {
+        unsigned int added = 0;
+        for (unsigned int k = 0; k < 3; k++)
+            if (stamp[indices[i + k]] != current)
+                added++;
+        // Also catches a vertex repeated within the triangle, which only
+        // overestimates the count.
+        if (meshletVertices + added > maxVertices || (i - firstIndex) / 3 + 1 > maxTriangles) {
+            addMeshlet(positions, positionStride, indices, firstIndex, i - firstIndex, meshletVertices);
+            current++;
+            firstIndex = i;
+            meshletVertices = 0;
+        }
+        for (unsigned int k = 0; k < 3; k++) {
+            if (stamp[indices[i + k]] != current) {
+                stamp[indices[i + k]] = current;
+                meshletVertices++;
+            }
+        }
+    }
+    if (indexCount - firstIndex >= 3)
+        addMeshlet(positions, positionStride, indices, firstIndex, (indexCount - firstIndex) / 3 * 3, meshletVertices);
+
+    // Pad to a whole number of SIMD lanes; cull() masks the tail off.
+    size_t padded = (bounds.size() + 3) & ~(size_t)3;
+    centerX.resize(padded, 0.0f);
+    centerY.resize(padded, 0.0f);
+    centerZ.resize(padded, 0.0f);
+    radius.resize(padded, 0.0f);
+    axisX.resize(padded, 0.0f);
+    axisY.resize(padded, 0.0f);
+    axisZ.resize(padded, 0.0f);
+    cutoff.resize(padded, 1.0f);
+    for (size_t m = 0; m < bounds.size(); m++) {
+        centerX[m] = bounds[m].center[0];
+        centerY[m] = bounds[m].center[1];
+        centerZ[m] = bounds[m].center[2];
+        radius[m] = bounds[m].radius;
+        axisX[m] = bounds[m].coneAxis[0];
+        axisY[m] = bounds[m].coneAxis[1];
+        axisZ[m] = bounds[m].coneAxis[2];
+        cutoff[m] = bounds[m].coneCutoff;
+    }
+    commands.reserve(meshlets.size());
+}
+
+void MeshletSet::addMeshlet(const float* positions, unsigned int positionStride, const uint32_t* indices,
+    unsigned int firstIndex, unsigned int indexCount, unsigned int vertexCount)
+{
+    Meshlet meshlet = { firstIndex, indexCount, vertexCount };
+    meshlets.push_back(meshlet);
+
+    // Sphere around the bounding box centre.
+    float minimum[3] = { INFINITY, INFINITY, INFINITY };
+    float maximum[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (unsigned int i = firstIndex; i < firstIndex + indexCount; i++) {
+        const float* p = positionAt(positions, positionStride, indices[i]);
+        for (int c = 0; c < 3; c++) {
+            minimum[c] = std::fmin(minimum[c], p[c]);
+            maximum[c] = std::fmax(maximum[c], p[c]);
+        }
+    }
+    MeshletBounds b;
+    for (int c = 0; c < 3; c++)
+        b.center[c] = (minimum[c] + maximum[c]) * 0.5f;
+    float radiusSquared = 0.0f;
+    for (unsigned int i = firstIndex; i < firstIndex + indexCount; i++) {
+        const float* p = positionAt(positions, positionStride, indices[i]);
+        float dx = p[0] - b.center[0], dy = p[1] - b.center[1], dz = p[2] - b.center[2];
+        radiusSquared = std::fmax(radiusSquared, dx * dx + dy * dy + dz * dz);
+    }
+    b.radius = std::sqrt(radiusSquared);
+
+    // Normal cone: the axis is the mean unit normal, the spread is the widest
+    // angle between it and any triangle normal.
+    std::vector<float> normals;
+    normals.reserve(indexCount);
+    float axis[3] = { 0.0f, 0.0f, 0.0f };
+    for (unsigned int i = firstIndex; i < firstIndex + indexCount; i += 3) {
+        const float* p0 = positionAt(positions, positionStride, indices[i]);
+        const float* p1 = positionAt(positions, positionStride, indices[i + 1]);
+        const float* p2 = positionAt(positions, positionStride, indices[i + 2]);
+        float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+        float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0.0f)
+            continue;
+        for (int c = 0; c < 3; c++) {
+            normals.push_back(n[c] / length);
+            axis[c] += n[c] / length;
+        }
+    }
+    float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    float minimumDot = 1.0f;
+    if (axisLength > 0.0f) {
+        for (int c = 0; c < 3; c++)
+            axis[c] /= axisLength;
+        for (size_t n = 0; n < normals.size(); n += 3)
+            minimumDot = std::fmin(minimumDot, normals[n] * axis[0] + normals[n + 1] * axis[1] + normals[n + 2] * axis[2]);
+    }
+    else {
+        minimumDot = -1.0f;
+    }
+    for (int c = 0; c < 3; c++)
+        b.coneAxis[c] = axis[c];
+    // Cones wider than ~84 degrees reject almost nothing; never cull them.
+    b.coneCutoff = minimumDot <= 0.1f ? 1.0f : std::sqrt(1.0f - minimumDot * minimumDot);
+    bounds.push_back(b);
+}
+
+void MeshletSet::extractFrustumPlanes(const float* m, float planes[6][4])
+{
+    // Rows of the column-major matrix.
+    for (int c = 0; c < 4; c++) {
+        float row3 = m[c * 4 + 3];
+        planes[0][c] = row3 + m[c * 4 + 0]; // left
+        planes[1][c] = row3 - m[c * 4 + 0]; // right
+        planes[2][c] = row3 + m[c * 4 + 1]; // bottom
+        planes[3][c] = row3 - m[c * 4 + 1]; // top
+        planes[4][c] = row3 + m[c * 4 + 2]; // near
+        planes[5][c] = row3 - m[c * 4 + 2]; // far
+    }
+    // Normalise so plane distances compare against sphere radii.
+    for (int p = 0; p < 6; p++) {
+        float length = std::sqrt(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+        if (length > 0.0f)
+            for (int c = 0; c < 4; c++)
+                planes[p][c] /= length;
+    }
+}
+
+void MeshletSet::appendVisible(unsigned int m)
+{
+    DrawBatch::DrawElementsIndirectCommand command;
+    command.count = meshlets[m].indexCount;
+    command.instanceCount = 1;
+    command.firstIndex = meshlets[m].firstIndex;
+    command.baseVertex = 0;
+    command.baseInstance = 0;
+    commands.push_back(command);
+}
+
+unsigned int MeshletSet::cull(const float planes[6][4], const float cameraPosition[3])
+{
+    commands.clear();
+    const unsigned int count = (unsigned int)meshlets.size();
+    unsigned int m = 0;
+
+#ifdef MESHLET_CULL_SSE2
+    const __m128 camX = _mm_set1_ps(cameraPosition[0]);
+    const __m128 camY = _mm_set1_ps(cameraPosition[1]);
+    const __m128 camZ = _mm_set1_ps(cameraPosition[2]);
+    for (; m < count; m += 4) {
+        __m128 cx = _mm_loadu_ps(&centerX[m]);
+        __m128 cy = _mm_loadu_ps(&centerY[m]);
+        __m128 cz = _mm_loadu_ps(&centerZ[m]);
+        __m128 r = _mm_loadu_ps(&radius[m]);
+        __m128 negR = _mm_sub_ps(_mm_setzero_ps(), r);
+
+        // Inside or touching every plane.
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            __m128 d = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p][0]), cx), _mm_mul_ps(_mm_set1_ps(planes[p][1]), cy)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p][2]), cz), _mm_set1_ps(planes[p][3])));
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(d, negR));
+        }
+
+        // Not entirely back-facing.
+        __m128 vx = _mm_sub_ps(cx, camX);
+        __m128 vy = _mm_sub_ps(cy, camY);
+        __m128 vz = _mm_sub_ps(cz, camZ);
+        __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_loadu_ps(&axisX[m])), _mm_mul_ps(vy, _mm_loadu_ps(&axisY[m]))),
+            _mm_mul_ps(vz, _mm_loadu_ps(&axisZ[m])));
+        __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+        __m128 backfacing = _mm_cmpge_ps(dot, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&cutoff[m]), length), r));
+        visible = _mm_andnot_ps(backfacing, visible);
+
+        int mask = _mm_movemask_ps(visible);
+        if (count - m < 4)
+            mask &= (1 << (count - m)) - 1;
+        while (mask) {
+            int lane = 0;
+            while (!(mask & (1 << lane)))
+                lane++;
+            mask &= mask - 1;
+            appendVisible(m + lane);
+        }
+    }
+#else
+    for (; m < count; m++) {
+        bool visible = true;
+        for (int p = 0; p < 6 && visible; p++)
+            visible = planes[p][0] * centerX[m] + planes[p][1] * centerY[m] + planes[p][2] * centerZ[m] + planes[p][3] >= -radius[m];
+        float vx = centerX[m] - cameraPosition[0];
+        float vy = centerY[m] - cameraPosition[1];
+        float vz = centerZ[m] - cameraPosition[2];
+        float length = std::sqrt(vx * vx + vy * vy + vz * vz);
+        if (visible && vx * axisX[m] + vy * axisY[m] + vz * axisZ[m] >= cutoff[m] * length + radius[m])
+            visible = false;
+        if (visible)
+            appendVisible(m);
+    }
+#endif
+    return (unsigned int)commands.size();
+}
+
+void MeshletSet::draw(DrawObject& object, StreamingVertexBuffer* stream)
+{
+    if (commands.empty())
+        return;
+    GPU_SCOPE("MeshletSet::draw");
+    ElementBuffer* ebo = object.getElementBuffer();
+    const unsigned int indexSize = ebo->getIndexSize();
+    const GLuint firstIndex = ebo->getOffset() / indexSize;
+    const GLint baseVertex = object.getBaseVertex();
+    object.bind();
+
+    if (GLAD_GL_VERSION_4_3 && stream) {
+        // Rebased into scratch so drawing twice after one cull() stays correct.
+        indirect.assign(commands.begin(), commands.end());
+        for (DrawBatch::DrawElementsIndirectCommand& command : indirect) {
+            command.firstIndex += firstIndex;
+            command.baseVertex = baseVertex;
+        }
+        // A fresh range of the stream each draw, so no write waits on earlier draws.
+        unsigned int size = (unsigned int)(indirect.size() * sizeof(DrawBatch::DrawElementsIndirectCommand));
+        unsigned int offset = stream->write(indirect.data(), size);
+        if (offset != StreamingVertexBuffer::WriteFailed) {
+            GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, stream->getId());
+            GLCall(glMultiDrawElementsIndirect(GL_TRIANGLES, ebo->getType(), (const void*)(uintptr_t)offset,
+                (GLsizei)indirect.size(), 0));
+            return;
+        }
+    }
+
+    counts.clear();
+    indexOffsets.clear();
+    baseVertices.clear();
+    for (const DrawBatch::DrawElementsIndirectCommand& command : commands) {
+        counts.push_back((GLsizei)command.count);
+        indexOffsets.push_back((const void*)(uintptr_t)((firstIndex + command.firstIndex) * indexSize));
+        baseVertices.push_back(baseVertex);
+    }
+    GLCall(glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), ebo->getType(),
+        indexOffsets.data(), (GLsizei)counts.size(), baseVertices.data()));
+}
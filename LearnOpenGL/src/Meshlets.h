@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Application.h"
+#include "DrawBatch.h"
+#include "DrawObject.h"
+#include "StreamingVertexBuffer.h"
+
+// A contiguous range of an index buffer, small enough to cull on its own.
+struct Meshlet
+{
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	unsigned int vertexCount;
+};
+
+// Bounding sphere and normal cone. The cluster faces away from a camera at c
+// when dot(center - c, coneAxis) >= coneCutoff * |center - c| + radius.
+// A cone cutoff of 1 means the cluster can never be backface culled.
+struct MeshletBounds
+{
+	float center[3];
+	float radius;
+	float coneAxis[3];
+	float coneCutoff;
+};
+
+// Splits an indexed mesh into meshlets of at most maxVertices unique vertices
+// and maxTriangles triangles, culls them against a frustum and their normal
+// cones, and draws the survivors with one indirect multi-draw.
+//
+// Meshlets are cut from the index buffer in order without moving triangles,
+// so the buffer uploaded to the ElementBuffer is the same one passed in. Run
+// MeshOptimizer first: a cache-friendly order also gives compact clusters.
+class MeshletSet
+{
+private:
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshletBounds> bounds;
+	// Structure-of-arrays copy of the bounds for the culler, padded to 4.
+	std::vector<float> centerX, centerY, centerZ, radius;
+	std::vector<float> axisX, axisY, axisZ, cutoff;
+
+	// Survivors of the last cull(), relative to the set's own index range.
+	std::vector<DrawBatch::DrawElementsIndirectCommand> commands;
+	// commands rebased onto the object's index and vertex offsets for upload.
+	std::vector<DrawBatch::DrawElementsIndirectCommand> indirect;
+	// glMultiDrawElementsBaseVertex arguments for the GL 3.3 path.
+	std::vector<GLsizei> counts;
+	std::vector<const void*> indexOffsets;
+	std::vector<GLint> baseVertices;
+
+	void addMeshlet(const float* positions, unsigned int positionStride, const uint32_t* indices,
+		unsigned int firstIndex, unsigned int indexCount, unsigned int vertexCount);
+	void appendVisible(unsigned int meshlet);
+public:
+	static const unsigned int DefaultMaxVertices = 64;
+	static const unsigned int DefaultMaxTriangles = 124;
+
+	// positions point at the first vertex's float3 position, positionStride
+	// bytes apart.
+	MeshletSet(const float* positions, unsigned int positionStride, unsigned int vertexCount,
+		const uint32_t* indices, unsigned int indexCount,
+		unsigned int maxVertices = DefaultMaxVertices, unsigned int maxTriangles = DefaultMaxTriangles);
+
+	// Gribb/Hartmann planes (a, b, c, d with the normal pointing inwards) from
+	// a column-major view-projection matrix.
+	static void extractFrustumPlanes(const float* viewProjection, float planes[6][4]);
+
+	// Keeps meshlets that intersect the frustum and face cameraPosition.
+	// Returns the number of survivors. Uses SSE2 when the target has it; the
+	// bounds are padded to 4 so the last group is masked rather than looped.
+	unsigned int cull(const float planes[6][4], const float cameraPosition[3]);
+	// Draws the meshlets that survived the last cull(). object must have been
+	// created over the index buffer this set was built from.
+	//
+	// On GL 4.3 the commands are written to the current section of stream and
+	// drawn indirectly from there; the caller begins and ends the stream's
+	// frames. Without a stream, or once its section is full, the survivors are
+	// drawn with glMultiDrawElementsBaseVertex instead.
+	void draw(DrawObject& object, StreamingVertexBuffer* stream = nullptr);
+
+	inline unsigned int getMeshletCount() const { return (unsigned int)meshlets.size(); };
+	inline unsigned int getVisibleCount() const { return (unsigned int)commands.size(); };
+	inline const Meshlet& getMeshlet(unsigned int i) const { return meshlets[i]; };
+	inline const MeshletBounds& getBounds(unsigned int i) const { return bounds[i]; };
+};
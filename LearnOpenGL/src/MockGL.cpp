@@ -0,0 +1,1209 @@
+#include "MockGL.h"
+#include "ShaderBuildScheduler.h"
+
+#include <cstring>
+#include <iomanip>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+struct Buffer
+{
+    std::vector<unsigned char> data;
+    bool immutable = false;
+    bool mapped = false;
+};
+
+struct State
+{
+    int major = 4;
+    int minor = 5;
+    std::string version;
+
+    // Names are handed out per object kind; shaders and programs share one
+    // namespace, as in GL.
+    GLuint nextBuffer = 1;
+    GLuint nextVertexArray = 1;
+    GLuint nextTexture = 1;
+    GLuint nextQuery = 1;
+    GLuint nextRenderbuffer = 1;
+    GLuint nextFramebuffer = 1;
+    GLuint nextShaderOrProgram = 1;
+    uintptr_t nextSync = 1;
+
+    std::unordered_map<GLuint, Buffer> buffers;
+    // Element array bindings per vertex array; 0 is the default.
+    std::unordered_map<GLuint, GLuint> vertexArrays;
+    std::unordered_set<GLuint> textures;
+    std::unordered_map<GLuint, uint64_t> queries;
+    std::unordered_set<GLuint> renderbuffers;
+    std::unordered_set<GLuint> framebuffers;
+    std::unordered_map<GLuint, GLenum> shaders;
+    // Link status per program.
+    std::unordered_map<GLuint, bool> programs;
+    unsigned int syncs = 0;
+
+    std::unordered_map<GLenum, GLuint> bufferBindings;
+    // Keyed by unit << 32 | target.
+    std::unordered_map<uint64_t, GLuint> textureBindings;
+    GLuint vertexArray = 0;
+    GLuint program = 0;
+    GLuint activeTexture = 0;
+    GLuint framebuffer = 0;
+    GLuint renderbuffer = 0;
+    std::unordered_set<GLenum> enabled;
+    GLenum depthFunc = GL_LESS;
+    GLboolean depthMask = GL_TRUE;
+    GLenum blendSource = GL_ONE;
+    GLenum blendDestination = GL_ZERO;
+    GLint viewport[4] = { 0, 0, 0, 0 };
+    GLenum error = GL_NO_ERROR;
+    // Every error raised, including ones hidden behind an unread first error.
+    uint64_t errors = 0;
+
+    bool recording = true;
+    std::vector<uint64_t> stream;
+    uint64_t counts[(size_t)MockCall::Count] = {};
+    uint64_t totalCalls = 0;
+
+    State() { vertexArrays[0] = 0; }
+};
+
+State state;
+
+const char* const callNames[] = {
+#define MOCK_GL_NAME(name) "gl" #name,
+    MOCK_GL_CALLS(MOCK_GL_NAME)
+#undef MOCK_GL_NAME
+};
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value, uint64_t>::type toWord(T value)
+{
+    return (uint64_t)(int64_t)value;
+}
+
+inline uint64_t toWord(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+template<typename T>
+uint64_t toWord(T* pointer)
+{
+    return (uint64_t)(uintptr_t)pointer;
+}
+
+template<typename... Args>
+void record(MockCall call, Args... args)
+{
+    state.counts[(size_t)call]++;
+    state.totalCalls++;
+    if (!state.recording)
+        return;
+    const uint64_t words[] = { ((uint64_t)call << 32) | sizeof...(Args), toWord(args)... };
+    state.stream.insert(state.stream.end(), words, words + 1 + sizeof...(Args));
+}
+
+// GL keeps the first error until it is read.
+void setError(GLenum error)
+{
+    state.errors++;
+    if (state.error == GL_NO_ERROR)
+        state.error = error;
+}
+
+uint64_t getTimestamp()
+{
+    return state.totalCalls * 100;
+}
+
+GLuint& elementArrayBinding()
+{
+    return state.vertexArrays[state.vertexArray];
+}
+
+GLuint getBufferBinding(GLenum target)
+{
+    if (target == GL_ELEMENT_ARRAY_BUFFER)
+        return elementArrayBinding();
+    auto found = state.bufferBindings.find(target);
+    return found != state.bufferBindings.end() ? found->second : 0;
+}
+
+// The buffer bound to target, or null with GL_INVALID_OPERATION raised.
+Buffer* getBoundBuffer(GLenum target)
+{
+    auto found = state.buffers.find(getBufferBinding(target));
+    if (found == state.buffers.end()) {
+        setError(GL_INVALID_OPERATION);
+        return nullptr;
+    }
+    return &found->second;
+}
+
+GLuint getTextureBinding(GLuint unit, GLenum target)
+{
+    auto found = state.textureBindings.find(((uint64_t)unit << 32) | target);
+    return found != state.textureBindings.end() ? found->second : 0;
+}
+
+void writeString(const char* value, GLsizei bufSize, GLsizei* length, GLchar* out)
+{
+    GLsizei written = 0;
+    if (out && bufSize > 0) {
+        written = std::min((GLsizei)std::strlen(value), bufSize - 1);
+        std::memcpy(out, value, written);
+        out[written] = '\0';
+    }
+    if (length)
+        *length = written;
+}
+
+template<typename Names, typename Next>
+void generate(GLsizei n, GLuint* names, Next& next, Names& live)
+{
+    for (GLsizei i = 0; i < n; i++) {
+        names[i] = next++;
+        live.insert({ names[i] });
+    }
+}
+
+template<typename Names>
+bool isName(const Names& live, GLuint name)
+{
+    return name == 0 || live.find(name) != live.end();
+}
+
+// Binding query to the target it reports.
+struct BindingQuery
+{
+    GLenum query;
+    GLenum target;
+};
+
+const BindingQuery bufferBindingQueries[] = {
+    { GL_ARRAY_BUFFER_BINDING, GL_ARRAY_BUFFER },
+    { GL_ELEMENT_ARRAY_BUFFER_BINDING, GL_ELEMENT_ARRAY_BUFFER },
+    { GL_UNIFORM_BUFFER_BINDING, GL_UNIFORM_BUFFER },
+    { GL_DRAW_INDIRECT_BUFFER_BINDING, GL_DRAW_INDIRECT_BUFFER },
+    { GL_COPY_READ_BUFFER_BINDING, GL_COPY_READ_BUFFER },
+    { GL_COPY_WRITE_BUFFER_BINDING, GL_COPY_WRITE_BUFFER },
+    { GL_PIXEL_PACK_BUFFER_BINDING, GL_PIXEL_PACK_BUFFER },
+    { GL_PIXEL_UNPACK_BUFFER_BINDING, GL_PIXEL_UNPACK_BUFFER },
+    { GL_TEXTURE_BUFFER_BINDING, GL_TEXTURE_BUFFER },
+    { GL_SHADER_STORAGE_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER },
+};
+
+const BindingQuery textureBindingQueries[] = {
+    { GL_TEXTURE_BINDING_2D, GL_TEXTURE_2D },
+    { GL_TEXTURE_BINDING_3D, GL_TEXTURE_3D },
+    { GL_TEXTURE_BINDING_2D_ARRAY, GL_TEXTURE_2D_ARRAY },
+    { GL_TEXTURE_BINDING_CUBE_MAP, GL_TEXTURE_CUBE_MAP },
+    { GL_TEXTURE_BINDING_BUFFER, GL_TEXTURE_BUFFER },
+};
+
+// Buffers
+
+void APIENTRY mockGenBuffers(GLsizei n, GLuint* buffers)
+{
+    record(MockCall::GenBuffers, n, buffers);
+    for (GLsizei i = 0; i < n; i++)
+        state.buffers[buffers[i] = state.nextBuffer++];
+}
+
+void APIENTRY mockDeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+    record(MockCall::DeleteBuffers, n, buffers);
+    for (GLsizei i = 0; i < n; i++) {
+        if (!buffers[i] || !state.buffers.erase(buffers[i]))
+            continue;
+        // Deleting a bound buffer unbinds it.
+        for (auto& binding : state.bufferBindings) {
+            if (binding.second == buffers[i])
+                binding.second = 0;
+        }
+        if (elementArrayBinding() == buffers[i])
+            elementArrayBinding() = 0;
+    }
+}
+
+void APIENTRY mockBindBuffer(GLenum target, GLuint buffer)
+{
+    record(MockCall::BindBuffer, target, buffer);
+    if (!isName(state.buffers, buffer)) {
+        setError(GL_INVALID_OPERATION);
+        return;
+    }
+    if (target == GL_ELEMENT_ARRAY_BUFFER)
+        elementArrayBinding() = buffer;
+    else
+        state.bufferBindings[target] = buffer;
+}
+
+void APIENTRY mockBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    record(MockCall::BindBufferRange, target, index, buffer, offset, size);
+    auto found = state.buffers.find(buffer);
+    if (buffer && (found == state.buffers.end() || offset < 0 || size <= 0
+        || (size_t)(offset + size) > found->second.data.size())) {
+        setError(found == state.buffers.end() ? GL_INVALID_OPERATION : GL_INVALID_VALUE);
+        return;
+    }
+    // Indexed binds also set the generic binding.
+    state.bufferBindings[target] = buffer;
+}
+
+void APIENTRY mockBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    record(MockCall::BufferData, target, size, data, usage);
+    Buffer* bound = getBoundBuffer(target);
+    if (!bound)
+        return;
+    if (bound->immutable) {
+        setError(GL_INVALID_OPERATION);
+        return;
+    }
+    bound->data.assign((size_t)size, 0);
+    if (data)
+        std::memcpy(bound->data.data(), data, (size_t)size);
+}
+
+void APIENTRY mockBufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)
+{
+    record(MockCall::BufferStorage, target, size, data, flags);
+    Buffer* bound = getBoundBuffer(target);
+    if (!bound)
+        return;
+    if (bound->immutable) {
+        setError(GL_INVALID_OPERATION);
+        return;
+    }
+    bound->data.assign((size_t)size, 0);
+    if (data)
+        std::memcpy(bound->data.data(), data, (size_t)size);
+    bound->immutable = true;
+}
+
+void APIENTRY mockBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    record(MockCall::BufferSubData, target, offset, size, data);
+    Buffer* bound = getBoundBuffer(target);
+    if (!bound)
+        return;
+    if (offset < 0 || size < 0 || (size_t)(offset + size) > bound->data.size()) {
+        setError(GL_INVALID_VALUE);
+        return;
+    }
+    if (data)
+        std::memcpy(bound->data.data() + offset, data, (size_t)size);
+}
+
+void APIENTRY mockCopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
+{
+    record(MockCall::CopyBufferSubData, readTarget, writeTarget, readOffset, writeOffset, size);
+    Buffer* source = getBoundBuffer(readTarget);
+    Buffer* destination = getBoundBuffer(writeTarget);
+    if (!source || !destination)
+        return;
+    if (readOffset < 0 || writeOffset < 0 || size < 0 || (size_t)(readOffset + size) > source->data.size()
+        || (size_t)(writeOffset + size) > destination->data.size()) {
+        setError(GL_INVALID_VALUE);
+        return;
+    }
+    std::memmove(destination->data.data() + writeOffset, source->data.data() + readOffset, (size_t)size);
+}
+
+void* APIENTRY mockMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    record(MockCall::MapBufferRange, target, offset, length, access);
+    Buffer* bound = getBoundBuffer(target);
+    if (!bound)
+        return nullptr;
+    if (bound->mapped || offset < 0 || length <= 0 || (size_t)(offset + length) > bound->data.size()) {
+        setError(bound->mapped ? GL_INVALID_OPERATION : GL_INVALID_VALUE);
+        return nullptr;
+    }
+    bound->mapped = true;
+    return bound->data.data() + offset;
+}
+
+GLboolean APIENTRY mockUnmapBuffer(GLenum target)
+{
+    record(MockCall::UnmapBuffer, target);
+    Buffer* bound = getBoundBuffer(target);
+    if (!bound)
+        return GL_FALSE;
+    if (!bound->mapped) {
+        setError(GL_INVALID_OPERATION);
+        return GL_FALSE;
+    }
+    bound->mapped = false;
+    return GL_TRUE;
+}
+
+void APIENTRY mockTexBuffer(GLenum target, GLenum internalformat, GLuint buffer)
+{
+    record(MockCall::TexBuffer, target, internalformat, buffer);
+    if (!isName(state.buffers, buffer) || !getTextureBinding(state.activeTexture, target))
+        setError(GL_INVALID_OPERATION);
+}
+
+// Vertex arrays
+
+void APIENTRY mockGenVertexArrays(GLsizei n, GLuint* arrays)
+{
+    record(MockCall::GenVertexArrays, n, arrays);
+    for (GLsizei i = 0; i < n; i++)
+        state.vertexArrays[arrays[i] = state.nextVertexArray++] = 0;
+}
+
+void APIENTRY mockDeleteVertexArrays(GLsizei n, const GLuint* arrays)
+{
+    record(MockCall::DeleteVertexArrays, n, arrays);
+    for (GLsizei i = 0; i < n; i++) {
+        if (!arrays[i])
+            continue;
+        if (state.vertexArray == arrays[i])
+            state.vertexArray = 0;
+        state.vertexArrays.erase(arrays[i]);
+    }
+}
+
+void APIENTRY mockBindVertexArray(GLuint array)
+{
+    record(MockCall::BindVertexArray, array);
+    if (!isName(state.vertexArrays, array)) {
+        setError(GL_INVALID_OPERATION);
+        return;
+    }
+    state.vertexArray = array;
+}
+
+// The core profile has no default vertex array.
+void requireVertexArray()
+{
+    if (!state.vertexArray)
+        setError(GL_INVALID_OPERATION);
+}
+
+void APIENTRY mockEnableVertexAttribArray(GLuint index)
+{
+    record(MockCall::EnableVertexAttribArray, index);
+    requireVertexArray();
+}
+
+void APIENTRY mockVertexAttribDivisor(GLuint index, GLuint divisor)
+{
+    record(MockCall::VertexAttribDivisor, index, divisor);
+    requireVertexArray();
+}
+
+void APIENTRY mockVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+{
+    record(MockCall::VertexAttribPointer, index, size, type, normalized, stride, pointer);
+    requireVertexArray();
+    if (!getBufferBinding(GL_ARRAY_BUFFER))
+        setError(GL_INVALID_OPERATION);
+}
+
+void APIENTRY mockVertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void* pointer)
+{
+    record(MockCall::VertexAttribIPointer, index, size, type, stride, pointer);
+    requireVertexArray();
+    if (!getBufferBinding(GL_ARRAY_BUFFER))
+        setError(GL_INVALID_OPERATION);
+}
+
+// Textures
+
+void APIENTRY mockGenTextures(GLsizei n, GLuint* textures)
+{
+    record(MockCall::GenTextures, n, textures);
+    generate(n, textures, state.nextTexture, state.textures);
+}
+
+void APIENTRY mockDeleteTextures(GLsizei n, const GLuint* textures)
+{
+    record(MockCall::DeleteTextures, n, textures);
+    for (GLsizei i = 0; i < n; i++) {
+        if (!textures[i] || !state.textures.erase(textures[i]))
+            continue;
+        for (auto& binding : state.textureBindings) {
+            if (binding.second == textures[i])
+                binding.second = 0;
+        }
+    }
+}
+
+void APIENTRY mockActiveTexture(GLenum texture)
+{
+    record(MockCall::ActiveTexture, texture);
+    state.activeTexture = texture - GL_TEXTURE0;
+}
+
+void APIENTRY mockBindTexture(GLenum target, GLuint texture)
+{
+    record(MockCall::BindTexture, target, texture);
+    if (!isName(state.textures, texture)) {
+        setError(GL_INVALID_OPERATION);
+        return;
+    }
+    state.textureBindings[((uint64_t)state.activeTexture << 32) | target] = texture;
+}
+
+// Framebuffers
+
+void APIENTRY mockGenFramebuffers(GLsizei n, GLuint* framebuffers)
+{
+    record(MockCall::GenFramebuffers, n, framebuffers);
+    generate(n, framebuffers, state.nextFramebuffer, state.framebuffers);
+}
+
+void APIENTRY mockDeleteFramebuffers(GLsizei n, const GLuint* framebuffers)
+{
+    record(MockCall::DeleteFramebuffers, n, framebuffers);
+    for (GLsizei i = 0; i < n; i++) {
+        if (state.framebuffer == framebuffers[i])
+            state.framebuffer = 0;
+        state.framebuffers.erase(framebuffers[i]);
+    }
+}
+
+void APIENTRY mockBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    record(MockCall::BindFramebuffer, target, framebuffer);
+    if (!isName(state.framebuffers, framebuffer)) {
+        setError(GL_INVALID_OPERATION);
+        return;
+    }
+    state.framebuffer = framebuffer;
+}
+
+GLenum APIENTRY mockCheckFramebufferStatus(GLenum target)
+{
+    record(MockCall::CheckFramebufferStatus, target);
+    return GL_FRAMEBUFFER_COMPLETE;
+}
+
+void APIENTRY mockGenRenderbuffers(GLsizei n, GLuint* renderbuffers)
+{
+    record(MockCall::GenRenderbuffers, n, renderbuffers);
+    generate(n, renderbuffers, state.nextRenderbuffer, state.renderbuffers);
+}
+
+void APIENTRY mockDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers)
+{
+    record(MockCall::DeleteRenderbuffers, n, renderbuffers);
+    for (GLsizei i = 0; i < n; i++) {
+        if (state.renderbuffer == renderbuffers[i])
+            state.renderbuffer = 0;
+        state.renderbuffers.erase(renderbuffers[i]);
+    }
+}
+
+void APIENTRY mockBindRenderbuffer(GLenum target, GLuint renderbuffer)
+{
+    record(MockCall::BindRenderbuffer, target, renderbuffer);
+    if (!isName(state.renderbuffers, renderbuffer)) {
+        setError(GL_INVALID_OPERATION);
+        return;
+    }
+    state.renderbuffer = renderbuffer;
+}
+
+void APIENTRY mockRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height)
+{
+    record(MockCall::RenderbufferStorage, target, internalformat, width, height);
+    if (!state.renderbuffer)
+        setError(GL_INVALID_OPERATION);
+}
+
+void APIENTRY mockFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer)
+{
+    record(MockCall::FramebufferRenderbuffer, target, attachment, renderbuffertarget, renderbuffer);
+    if (!state.framebuffer || !isName(state.renderbuffers, renderbuffer))
+        setError(GL_INVALID_OPERATION);
+}
+
+void APIENTRY mockReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels)
+{
+    record(MockCall::ReadPixels, x, y, width, height, format, type, pixels);
+    // Nothing is rasterised, so every pixel reads back as zero.
+    size_t components = format == GL_RGBA ? 4 : format == GL_RGB ? 3 : format == GL_RED ? 1 : 0;
+    if (pixels && type == GL_UNSIGNED_BYTE && components && width > 0 && height > 0)
+        std::memset(pixels, 0, (size_t)width * height * components);
+}
+
+// Shaders and programs
+
+GLuint APIENTRY mockCreateShader(GLenum type)
+{
+    record(MockCall::CreateShader, type);
+    GLuint shader = state.nextShaderOrProgram++;
+    state.shaders[shader] = type;
+    return shader;
+}
+
+void APIENTRY mockDeleteShader(GLuint shader)
+{
+    record(MockCall::DeleteShader, shader);
+    state.shaders.erase(shader);
+}
+
+void APIENTRY mockShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)
+{
+    record(MockCall::ShaderSource, shader, count, string, length);
+    if (!state.shaders.count(shader))
+        setError(GL_INVALID_VALUE);
+}
+
+void APIENTRY mockCompileShader(GLuint shader)
+{
+    record(MockCall::CompileShader, shader);
+    if (!state.shaders.count(shader))
+        setError(GL_INVALID_VALUE);
+}
+
+void APIENTRY mockGetShaderiv(GLuint shader, GLenum pname, GLint* params)
+{
+    record(MockCall::GetShaderiv, shader, pname, params);
+    auto found = state.shaders.find(shader);
+    if (found == state.shaders.end()) {
+        setError(GL_INVALID_VALUE);
+        return;
+    }
+    *params = pname == GL_COMPILE_STATUS ? GL_TRUE : pname == GL_SHADER_TYPE ? (GLint)found->second : 0;
+}
+
+void APIENTRY mockGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+{
+    record(MockCall::GetShaderInfoLog, shader, bufSize, length, infoLog);
+    writeString("", bufSize, length, infoLog);
+}
+
+GLuint APIENTRY mockCreateProgram()
+{
+    record(MockCall::CreateProgram);
+    GLuint program = state.nextShaderOrProgram++;
+    state.programs[program] = false;
+    return program;
+}
+
+void APIENTRY mockDeleteProgram(GLuint program)
+{
+    record(MockCall::DeleteProgram, program);
+    state.programs.erase(program);
+}
+
+void APIENTRY mockAttachShader(GLuint program, GLuint shader)
+{
+    record(MockCall::AttachShader, program, shader);
+    if (!state.programs.count(program) || !state.shaders.count(shader))
+        setError(GL_INVALID_VALUE);
+}
+
+void APIENTRY mockDetachShader(GLuint program, GLuint shader)
+{
+    record(MockCall::DetachShader, program, shader);
+    if (!state.programs.count(program) || !state.shaders.count(shader))
+        setError(GL_INVALID_VALUE);
+}
+
+void APIENTRY mockLinkProgram(GLuint program)
+{
+    record(MockCall::LinkProgram, program);
+    auto found = state.programs.find(program);
+    if (found == state.programs.end()) {
+        setError(GL_INVALID_VALUE);
+        return;
+    }
+    found->second = true;
+}
+
+void APIENTRY mockProgramParameteri(GLuint program, GLenum pname, GLint value)
+{
+    record(MockCall::ProgramParameteri, program, pname, value);
+}
+
+void APIENTRY mockGetProgramiv(GLuint program, GLenum pname, GLint* params)
+{
+    record(MockCall::GetProgramiv, program, pname, params);
+    auto found = state.programs.find(program);
+    if (found == state.programs.end()) {
+        setError(GL_INVALID_VALUE);
+        return;
+    }
+    // Nothing is ever active, so every count and length is zero.
+    if (pname == GL_LINK_STATUS)
+        *params = found->second ? GL_TRUE : GL_FALSE;
+    else if (pname == GL_COMPLETION_STATUS_KHR)
+        *params = GL_TRUE;
+    else
+        *params = 0;
+}
+
+void APIENTRY mockGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+{
+    record(MockCall::GetProgramInfoLog, program, bufSize, length, infoLog);
+    writeString("", bufSize, length, infoLog);
+}
+
+void APIENTRY mockGetProgramBinary(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary)
+{
+    record(MockCall::GetProgramBinary, program, bufSize, length, binaryFormat, binary);
+    if (length)
+        *length = 0;
+}
+
+void APIENTRY mockProgramBinary(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length)
+{
+    record(MockCall::ProgramBinary, program, binaryFormat, binary, length);
+    // No binary formats are advertised, so none is accepted.
+    auto found = state.programs.find(program);
+    if (found != state.programs.end())
+        found->second = false;
+    setError(GL_INVALID_ENUM);
+}
+
+void APIENTRY mockUseProgram(GLuint program)
+{
+    record(MockCall::UseProgram, program);
+    auto found = state.programs.find(program);
+    if (program && (found == state.programs.end() || !found->second)) {
+        setError(GL_INVALID_OPERATION);
+        return;
+    }
+    state.program = program;
+}
+
+void APIENTRY mockGetProgramInterfaceiv(GLuint program, GLenum programInterface, GLenum pname, GLint* params)
+{
+    record(MockCall::GetProgramInterfaceiv, program, programInterface, pname, params);
+    *params = 0;
+}
+
+void APIENTRY mockGetProgramResourceiv(GLuint program, GLenum programInterface, GLuint index, GLsizei propCount,
+    const GLenum* props, GLsizei count, GLsizei* length, GLint* params)
+{
+    record(MockCall::GetProgramResourceiv, program, programInterface, index, propCount, props, count, length, params);
+    setError(GL_INVALID_VALUE);
+}
+
+void APIENTRY mockGetProgramResourceName(GLuint program, GLenum programInterface, GLuint index, GLsizei bufSize,
+    GLsizei* length, GLchar* name)
+{
+    record(MockCall::GetProgramResourceName, program, programInterface, index, bufSize, length, name);
+    setError(GL_INVALID_VALUE);
+}
+
+void APIENTRY mockGetActiveAttrib(GLuint program, GLuint index, GLsizei bufSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name)
+{
+    record(MockCall::GetActiveAttrib, program, index, bufSize, length, size, type, name);
+    setError(GL_INVALID_VALUE);
+}
+
+void APIENTRY mockGetActiveUniform(GLuint program, GLuint index, GLsizei bufSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name)
+{
+    record(MockCall::GetActiveUniform, program, index, bufSize, length, size, type, name);
+    setError(GL_INVALID_VALUE);
+}
+
+void APIENTRY mockGetActiveUniformsiv(GLuint program, GLsizei uniformCount, const GLuint* uniformIndices, GLenum pname, GLint* params)
+{
+    record(MockCall::GetActiveUniformsiv, program, uniformCount, uniformIndices, pname, params);
+    if (uniformCount > 0)
+        setError(GL_INVALID_VALUE);
+}
+
+void APIENTRY mockGetActiveUniformBlockiv(GLuint program, GLuint uniformBlockIndex, GLenum pname, GLint* params)
+{
+    record(MockCall::GetActiveUniformBlockiv, program, uniformBlockIndex, pname, params);
+    setError(GL_INVALID_VALUE);
+}
+
+void APIENTRY mockGetActiveUniformBlockName(GLuint program, GLuint uniformBlockIndex, GLsizei bufSize, GLsizei* length, GLchar* uniformBlockName)
+{
+    record(MockCall::GetActiveUniformBlockName, program, uniformBlockIndex, bufSize, length, uniformBlockName);
+    setError(GL_INVALID_VALUE);
+}
+
+GLint APIENTRY mockGetAttribLocation(GLuint program, const GLchar* name)
+{
+    record(MockCall::GetAttribLocation, program, name);
+    return -1;
+}
+
+GLint APIENTRY mockGetUniformLocation(GLuint program, const GLchar* name)
+{
+    record(MockCall::GetUniformLocation, program, name);
+    return -1;
+}
+
+void APIENTRY mockUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding)
+{
+    record(MockCall::UniformBlockBinding, program, uniformBlockIndex, uniformBlockBinding);
+    setError(GL_INVALID_VALUE);
+}
+
+void APIENTRY mockProgramUniform1iv(GLuint program, GLint location, GLsizei count, const GLint* value)
+{
+    record(MockCall::ProgramUniform1iv, program, location, count, value);
+}
+
+// Uniforms set on the current program; location -1 is silently ignored.
+void requireProgram(GLint location)
+{
+    if (location != -1 && !state.program)
+        setError(GL_INVALID_OPERATION);
+}
+
+void APIENTRY mockUniform1f(GLint location, GLfloat v0)
+{
+    record(MockCall::Uniform1f, location, v0);
+    requireProgram(location);
+}
+
+void APIENTRY mockUniform1i(GLint location, GLint v0)
+{
+    record(MockCall::Uniform1i, location, v0);
+    requireProgram(location);
+}
+
+void APIENTRY mockUniform1iv(GLint location, GLsizei count, const GLint* value)
+{
+    record(MockCall::Uniform1iv, location, count, value);
+    requireProgram(location);
+}
+
+void APIENTRY mockUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+{
+    record(MockCall::Uniform4f, location, v0, v1, v2, v3);
+    requireProgram(location);
+}
+
+void APIENTRY mockUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+    record(MockCall::UniformMatrix4fv, location, count, transpose, value);
+    requireProgram(location);
+}
+
+// Fixed function state
+
+void APIENTRY mockEnable(GLenum cap)
+{
+    record(MockCall::Enable, cap);
+    state.enabled.insert(cap);
+}
+
+void APIENTRY mockDisable(GLenum cap)
+{
+    record(MockCall::Disable, cap);
+    state.enabled.erase(cap);
+}
+
+GLboolean APIENTRY mockIsEnabled(GLenum cap)
+{
+    record(MockCall::IsEnabled, cap);
+    return state.enabled.count(cap) ? GL_TRUE : GL_FALSE;
+}
+
+void APIENTRY mockBlendFunc(GLenum sfactor, GLenum dfactor)
+{
+    record(MockCall::BlendFunc, sfactor, dfactor);
+    state.blendSource = sfactor;
+    state.blendDestination = dfactor;
+}
+
+void APIENTRY mockDepthFunc(GLenum func)
+{
+    record(MockCall::DepthFunc, func);
+    state.depthFunc = func;
+}
+
+void APIENTRY mockDepthMask(GLboolean flag)
+{
+    record(MockCall::DepthMask, flag);
+    state.depthMask = flag;
+}
+
+void APIENTRY mockClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+    record(MockCall::ClearColor, red, green, blue, alpha);
+}
+
+void APIENTRY mockClear(GLbitfield mask)
+{
+    record(MockCall::Clear, mask);
+}
+
+void APIENTRY mockViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    record(MockCall::Viewport, x, y, width, height);
+    state.viewport[0] = x;
+    state.viewport[1] = y;
+    state.viewport[2] = width;
+    state.viewport[3] = height;
+}
+
+// Draws
+
+// A draw needs a linked program and a vertex array; indexed draws read the
+// vertex array's element buffer.
+void validateDraw(bool indirect)
+{
+    if (!state.program || !state.vertexArray || !elementArrayBinding()
+        || (indirect && !getBufferBinding(GL_DRAW_INDIRECT_BUFFER)))
+        setError(GL_INVALID_OPERATION);
+}
+
+void APIENTRY mockDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+    record(MockCall::DrawElements, mode, count, type, indices);
+    validateDraw(false);
+}
+
+void APIENTRY mockDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLint basevertex)
+{
+    record(MockCall::DrawElementsBaseVertex, mode, count, type, indices, basevertex);
+    validateDraw(false);
+}
+
+void APIENTRY mockDrawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices,
+    GLsizei instancecount, GLint basevertex)
+{
+    record(MockCall::DrawElementsInstancedBaseVertex, mode, count, type, indices, instancecount, basevertex);
+    validateDraw(false);
+}
+
+void APIENTRY mockDrawElementsInstancedBaseVertexBaseInstance(GLenum mode, GLsizei count, GLenum type,
+    const void* indices, GLsizei instancecount, GLint basevertex, GLuint baseinstance)
+{
+    record(MockCall::DrawElementsInstancedBaseVertexBaseInstance, mode, count, type, indices, instancecount, basevertex,
+        baseinstance);
+    validateDraw(false);
+}
+
+void APIENTRY mockMultiDrawElementsBaseVertex(GLenum mode, const GLsizei* count, GLenum type, const void* const* indices,
+    GLsizei drawcount, const GLint* basevertex)
+{
+    record(MockCall::MultiDrawElementsBaseVertex, mode, count, type, indices, drawcount, basevertex);
+    validateDraw(false);
+}
+
+void APIENTRY mockMultiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride)
+{
+    record(MockCall::MultiDrawElementsIndirect, mode, type, indirect, drawcount, stride);
+    validateDraw(true);
+}
+
+// Synchronisation and queries
+
+GLsync APIENTRY mockFenceSync(GLenum condition, GLbitfield flags)
+{
+    record(MockCall::FenceSync, condition, flags);
+    state.syncs++;
+    return (GLsync)state.nextSync++;
+}
+
+GLenum APIENTRY mockClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    record(MockCall::ClientWaitSync, sync, flags, timeout);
+    return GL_ALREADY_SIGNALED;
+}
+
+void APIENTRY mockDeleteSync(GLsync sync)
+{
+    record(MockCall::DeleteSync, sync);
+    if (sync && state.syncs)
+        state.syncs--;
+}
+
+void APIENTRY mockFinish()
+{
+    record(MockCall::Finish);
+}
+
+void APIENTRY mockGenQueries(GLsizei n, GLuint* ids)
+{
+    record(MockCall::GenQueries, n, ids);
+    for (GLsizei i = 0; i < n; i++)
+        state.queries[ids[i] = state.nextQuery++] = 0;
+}
+
+void APIENTRY mockDeleteQueries(GLsizei n, const GLuint* ids)
+{
+    record(MockCall::DeleteQueries, n, ids);
+    for (GLsizei i = 0; i < n; i++)
+        state.queries.erase(ids[i]);
+}
+
+void APIENTRY mockQueryCounter(GLuint id, GLenum target)
+{
+    record(MockCall::QueryCounter, id, target);
+    auto found = state.queries.find(id);
+    if (found == state.queries.end()) {
+        setError(GL_INVALID_OPERATION);
+        return;
+    }
+    found->second = getTimestamp();
+}
+
+void APIENTRY mockGetQueryObjectuiv(GLuint id, GLenum pname, GLuint* params)
+{
+    record(MockCall::GetQueryObjectuiv, id, pname, params);
+    auto found = state.queries.find(id);
+    if (found == state.queries.end()) {
+        setError(GL_INVALID_OPERATION);
+        return;
+    }
+    *params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : (GLuint)found->second;
+}
+
+void APIENTRY mockGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params)
+{
+    record(MockCall::GetQueryObjectui64v, id, pname, params);
+    auto found = state.queries.find(id);
+    if (found == state.queries.end()) {
+        setError(GL_INVALID_OPERATION);
+        return;
+    }
+    *params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : found->second;
+}
+
+// Queries
+
+GLenum APIENTRY mockGetError()
+{
+    record(MockCall::GetError);
+    GLenum error = state.error;
+    state.error = GL_NO_ERROR;
+    return error;
+}
+
+void APIENTRY mockGetIntegerv(GLenum pname, GLint* data)
+{
+    record(MockCall::GetIntegerv, pname, data);
+    for (const BindingQuery& query : bufferBindingQueries) {
+        if (query.query == pname) {
+            *data = (GLint)getBufferBinding(query.target);
+            return;
+        }
+    }
+    for (const BindingQuery& query : textureBindingQueries) {
+        if (query.query == pname) {
+            *data = (GLint)getTextureBinding(state.activeTexture, query.target);
+            return;
+        }
+    }
+    switch (pname) {
+    case GL_MAJOR_VERSION: *data = state.major; break;
+    case GL_MINOR_VERSION: *data = state.minor; break;
+    case GL_NUM_EXTENSIONS: *data = 1; break;
+    case GL_NUM_PROGRAM_BINARY_FORMATS: *data = 0; break;
+    case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT: *data = 256; break;
+    case GL_MAX_UNIFORM_BUFFER_BINDINGS: *data = 84; break;
+    case GL_MAX_UNIFORM_BLOCK_SIZE: *data = 65536; break;
+    case GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS: *data = 192; break;
+    case GL_MAX_TEXTURE_IMAGE_UNITS: *data = 32; break;
+    case GL_MAX_VERTEX_ATTRIBS: *data = 16; break;
+    case GL_MAX_TEXTURE_BUFFER_SIZE: *data = 1 << 27; break;
+    case GL_VERTEX_ARRAY_BINDING: *data = (GLint)state.vertexArray; break;
+    case GL_CURRENT_PROGRAM: *data = (GLint)state.program; break;
+    case GL_ACTIVE_TEXTURE: *data = (GLint)(GL_TEXTURE0 + state.activeTexture); break;
+    case GL_FRAMEBUFFER_BINDING: *data = (GLint)state.framebuffer; break;
+    case GL_RENDERBUFFER_BINDING: *data = (GLint)state.renderbuffer; break;
+    case GL_DEPTH_FUNC: *data = (GLint)state.depthFunc; break;
+    case GL_DEPTH_WRITEMASK: *data = state.depthMask; break;
+    case GL_BLEND_SRC_RGB: *data = (GLint)state.blendSource; break;
+    case GL_BLEND_DST_RGB: *data = (GLint)state.blendDestination; break;
+    case GL_VIEWPORT: std::memcpy(data, state.viewport, sizeof(state.viewport)); break;
+    default:
+        setError(GL_INVALID_ENUM);
+        break;
+    }
+}
+
+void APIENTRY mockGetInteger64v(GLenum pname, GLint64* data)
+{
+    record(MockCall::GetInteger64v, pname, data);
+    if (pname == GL_TIMESTAMP) {
+        *data = (GLint64)getTimestamp();
+        return;
+    }
+    GLint value = 0;
+    bool recording = state.recording;
+    state.recording = false;
+    mockGetIntegerv(pname, &value);
+    state.recording = recording;
+    *data = value;
+}
+
+const GLubyte* APIENTRY mockGetString(GLenum name)
+{
+    record(MockCall::GetString, name);
+    switch (name) {
+    case GL_VERSION: return (const GLubyte*)state.version.c_str();
+    case GL_VENDOR: return (const GLubyte*)"LearnOpenGL";
+    case GL_RENDERER: return (const GLubyte*)"MockGL";
+    case GL_SHADING_LANGUAGE_VERSION: return (const GLubyte*)"4.50";
+    default:
+        setError(GL_INVALID_ENUM);
+        return nullptr;
+    }
+}
+
+// glad refuses a context without extensions, so there is one that nothing checks for.
+const GLubyte* APIENTRY mockGetStringi(GLenum name, GLuint index)
+{
+    record(MockCall::GetStringi, name, index);
+    if (name != GL_EXTENSIONS || index != 0) {
+        setError(GL_INVALID_VALUE);
+        return nullptr;
+    }
+    return (const GLubyte*)"GL_LEARNOPENGL_mock";
+}
+
+struct EntryPoint
+{
+    const char* name;
+    void* function;
+};
+
+#define MOCK_GL_CHECK(name) \
+    static_assert(std::is_same<decltype(&mock##name), decltype(glad_gl##name)>::value, "mock" #name " does not match glad");
+MOCK_GL_CALLS(MOCK_GL_CHECK)
+#undef MOCK_GL_CHECK
+
+const EntryPoint entryPoints[] = {
+#define MOCK_GL_ENTRY(name) { "gl" #name, (void*)&mock##name },
+    MOCK_GL_CALLS(MOCK_GL_ENTRY)
+#undef MOCK_GL_ENTRY
+};
+
+}
+
+bool MockGL::install(int major, int minor)
+{
+    reset();
+    state.major = major;
+    state.minor = minor;
+    state.version = std::to_string(major) + "." + std::to_string(minor) + " MockGL";
+    if (!gladLoadGLLoader((GLADloadproc)getProcAddress))
+        return false;
+    // Loading queried the version and extensions; start from a clean slate.
+    resetCounts();
+    clearStream();
+    return true;
+}
+
+void* MockGL::getProcAddress(const char* name)
+{
+    for (const EntryPoint& entry : entryPoints) {
+        if (std::strcmp(entry.name, name) == 0)
+            return entry.function;
+    }
+    return nullptr;
+}
+
+void MockGL::reset()
+{
+    int major = state.major;
+    int minor = state.minor;
+    std::string version = state.version;
+    bool recording = state.recording;
+    state = State();
+    state.major = major;
+    state.minor = minor;
+    state.version = version;
+    state.recording = recording;
+}
+
+void MockGL::setRecording(bool enabled)
+{
+    state.recording = enabled;
+}
+
+bool MockGL::isRecording()
+{
+    return state.recording;
+}
+
+const std::vector<uint64_t>& MockGL::getStream()
+{
+    return state.stream;
+}
+
+std::vector<MockCommand> MockGL::decode()
+{
+    std::vector<MockCommand> commands;
+    for (size_t i = 0; i < state.stream.size();) {
+        uint64_t header = state.stream[i];
+        MockCommand command = { (MockCall)(header >> 32), (unsigned int)(header & 0xFFFFFFFFu), &state.stream[i] + 1 };
+        commands.push_back(command);
+        i += 1 + command.argumentCount;
+    }
+    return commands;
+}
+
+void MockGL::clearStream()
+{
+    state.stream.clear();
+}
+
+void MockGL::dump(std::ostream& out)
+{
+    for (const MockCommand& command : decode()) {
+        out << getName(command.call) << "(";
+        for (unsigned int i = 0; i < command.argumentCount; i++) {
+            // Small values are names and counts, larger ones enums and pointers.
+            int64_t value = (int64_t)command.arguments[i];
+            if (i)
+                out << ", ";
+            if (value > -4096 && value < 4096)
+                out << value;
+            else
+                out << "0x" << std::hex << command.arguments[i] << std::dec;
+        }
+        out << ")\n";
+    }
+}
+
+uint64_t MockGL::getCallCount(MockCall call)
+{
+    return state.counts[(size_t)call];
+}
+
+uint64_t MockGL::getTotalCalls()
+{
+    return state.totalCalls;
+}
+
+uint64_t MockGL::getErrorCount()
+{
+    return state.errors;
+}
+
+void MockGL::resetCounts()
+{
+    std::memset(state.counts, 0, sizeof(state.counts));
+    state.totalCalls = 0;
+}
+
+const char* MockGL::getName(MockCall call)
+{
+    return (size_t)call < (size_t)MockCall::Count ? callNames[(size_t)call] : "gl?";
+}
+
+unsigned int MockGL::getLiveObjects()
+{
+    // The default vertex array is not an object.
+    return (unsigned int)(state.buffers.size() + state.vertexArrays.size() - 1 + state.textures.size()
+        + state.queries.size() + state.renderbuffers.size() + state.framebuffers.size() + state.shaders.size()
+        + state.programs.size()) + state.syncs;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "Application.h"
+
+// Every entry point the mock implements. The order gives each its opcode in
+// the command stream.
+#define MOCK_GL_CALLS(X) \
+	X(ActiveTexture) X(AttachShader) X(BindBuffer) X(BindBufferRange) X(BindFramebuffer) \
+	X(BindRenderbuffer) X(BindTexture) X(BindVertexArray) X(BlendFunc) X(BufferData) \
+	X(BufferStorage) X(BufferSubData) X(CheckFramebufferStatus) X(Clear) X(ClearColor) \
+	X(ClientWaitSync) X(CompileShader) X(CopyBufferSubData) X(CreateProgram) X(CreateShader) \
+	X(DeleteBuffers) X(DeleteFramebuffers) X(DeleteProgram) X(DeleteQueries) X(DeleteRenderbuffers) \
+	X(DeleteShader) X(DeleteSync) X(DeleteTextures) X(DeleteVertexArrays) X(DepthFunc) \
+	X(DepthMask) X(DetachShader) X(Disable) X(DrawElements) X(DrawElementsBaseVertex) \
+	X(DrawElementsInstancedBaseVertex) X(DrawElementsInstancedBaseVertexBaseInstance) X(Enable) \
+	X(EnableVertexAttribArray) X(FenceSync) X(Finish) \
+	X(FramebufferRenderbuffer) X(GenBuffers) X(GenFramebuffers) X(GenQueries) X(GenRenderbuffers) \
+	X(GenTextures) X(GenVertexArrays) X(GetActiveAttrib) X(GetActiveUniform) X(GetActiveUniformBlockName) \
+	X(GetActiveUniformBlockiv) X(GetActiveUniformsiv) X(GetAttribLocation) X(GetError) X(GetInteger64v) \
+	X(GetIntegerv) X(GetProgramBinary) X(GetProgramInfoLog) X(GetProgramInterfaceiv) X(GetProgramResourceName) \
+	X(GetProgramResourceiv) X(GetProgramiv) X(GetQueryObjectui64v) X(GetQueryObjectuiv) X(GetShaderInfoLog) \
+	X(GetShaderiv) X(GetString) X(GetStringi) X(GetUniformLocation) X(IsEnabled) \
+	X(LinkProgram) X(MapBufferRange) X(MultiDrawElementsBaseVertex) X(MultiDrawElementsIndirect) X(ProgramBinary) \
+	X(ProgramParameteri) X(ProgramUniform1iv) X(QueryCounter) X(ReadPixels) X(RenderbufferStorage) \
+	X(ShaderSource) X(TexBuffer) X(Uniform1f) X(Uniform1i) X(Uniform1iv) \
+	X(Uniform4f) X(UniformBlockBinding) X(UniformMatrix4fv) X(UnmapBuffer) X(UseProgram) \
+	X(VertexAttribDivisor) X(VertexAttribIPointer) X(VertexAttribPointer) X(Viewport)
+
+enum class MockCall : uint16_t
+{
+#define MOCK_GL_ENUM(name) name,
+	MOCK_GL_CALLS(MOCK_GL_ENUM)
+#undef MOCK_GL_ENUM
+	Count
+};
+
+// One call from the stream. Arguments are widened to 64 bits: integers sign
+// extended, floats as their bit pattern, pointers as addresses (what they
+// point to is not copied).
+struct MockCommand
+{
+	MockCall call;
+	unsigned int argumentCount;
+	const uint64_t* arguments;
+};
+
+// A GL implementation without a GPU, so the CPU side of rendering can be
+// measured and checked deterministically on any machine. install() loads glad
+// with stub entry points that count every call, append it to a command stream
+// and keep enough state for the code base to run unchanged: object names,
+// bindings per target and texture unit, buffer storage (uploads and maps hit
+// real memory), capabilities and the fixed-function values GLState caches.
+// Shaders always compile and programs link with nothing active. Fences are
+// signalled at once; timestamps advance 100 ns per call.
+//
+// Because programs report no active uniforms, blocks or samplers, program
+// reflection finds nothing and ShaderReflection::assignBindings() issues no
+// calls. Block binding and sampler unit assignment are not exercised here;
+// they need a real context.
+//
+// Misuse the code base could commit, such as binding a name that was never
+// generated or drawing without a vertex array, raises the error glGetError
+// reports. Entry points outside MOCK_GL_CALLS stay null, like a missing
+// extension. The state is global: there is one context.
+class MockGL
+{
+public:
+	// GL_VERSION reports major.minor, which decides what glad loads and so
+	// which paths the code base takes.
+	static bool install(int major = 4, int minor = 5);
+	static void* getProcAddress(const char* name);
+	// Forgets every object and restores the default state, counts and stream.
+	static void reset();
+
+	// Recording is on after install(); counting always is.
+	static void setRecording(bool enabled);
+	static bool isRecording();
+	static const std::vector<uint64_t>& getStream();
+	static std::vector<MockCommand> decode();
+	static void clearStream();
+	// One call per line, e.g. "glBindBuffer(0x8892, 3)".
+	static void dump(std::ostream& out);
+
+	static uint64_t getCallCount(MockCall call);
+	static uint64_t getTotalCalls();
+	static void resetCounts();
+	// Errors raised since install() or reset(), whether glGetError read them
+	// or not. resetCounts() leaves it alone.
+	static uint64_t getErrorCount();
+	static const char* getName(MockCall call);
+	// Objects generated or created and not yet deleted, of every kind.
+	static unsigned int getLiveObjects();
+};
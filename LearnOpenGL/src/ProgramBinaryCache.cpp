@@ -0,0 +1,165 @@
+#include "ProgramBinaryCache.h"
+#include "Application.h"
+
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#define makeDirectory(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define makeDirectory(path) mkdir(path, 0755)
+#endif
+
+namespace {
+
+const uint32_t BinaryMagic = 0x42504F4C; // "LOPB"
+
+struct BinaryHeader
+{
+    uint32_t magic;
+    uint32_t format;
+    uint32_t length;
+    uint32_t reserved;
+    uint64_t key;
+};
+
+const char* glString(GLenum name)
+{
+    const GLubyte* value = glGetString(name);
+    return value ? (const char*)value : "";
+}
+
+}
+
+uint64_t hashBytes64(const void* data, size_t size, uint64_t seed)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+ProgramBinaryCache::ProgramBinaryCache(const std::string& directory)
+    : directory(directory), driverHash(0), supported(false)
+{
+    std::string driver = std::string(glString(GL_VENDOR)) + '\n' + glString(GL_RENDERER) + '\n' + glString(GL_VERSION);
+    driverHash = hashBytes64(driver.data(), driver.size());
+
+    if (GLAD_GL_VERSION_4_1) {
+        GLint formats = 0;
+        GLCall(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats));
+        supported = formats > 0;
+    }
+    if (supported)
+        makeDirectory(directory.c_str());
+}
+
+std::string ProgramBinaryCache::pathFor(uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return directory + "/" + name;
+}
+
+std::string ProgramBinaryCache::namePathFor(const std::string& name) const
+{
+    char file[32];
+    std::snprintf(file, sizeof(file), "%016llx.name", (unsigned long long)hashBytes64(name.data(), name.size()));
+    return directory + "/" + file;
+}
+
+uint64_t ProgramBinaryCache::makeKey(const std::string& vertexSource, const std::string& fragmentSource) const
+{
+    // The separator keeps "ab" + "c" and "a" + "bc" apart.
+    uint64_t key = hashBytes64(vertexSource.data(), vertexSource.size(), driverHash);
+    key = hashBytes64("\0", 1, key);
+    return hashBytes64(fragmentSource.data(), fragmentSource.size(), key);
+}
+
+bool ProgramBinaryCache::load(uint64_t key, unsigned int program)
+{
+    if (!supported)
+        return false;
+
+    FILE* file = std::fopen(pathFor(key).c_str(), "rb");
+    if (!file) {
+        stats.misses++;
+        return false;
+    }
+    BinaryHeader header;
+    std::vector<unsigned char> binary;
+    bool valid = std::fread(&header, sizeof(header), 1, file) == 1 && header.magic == BinaryMagic && header.key == key;
+    if (valid) {
+        binary.resize(header.length);
+        valid = std::fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    std::fclose(file);
+    if (!valid) {
+        stats.misses++;
+        return false;
+    }
+
+    GLCall(glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size()));
+    GLint linked = GL_FALSE;
+    GLCall(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+    if (linked != GL_TRUE) {
+        stats.rejected++;
+        return false;
+    }
+    stats.hits++;
+    return true;
+}
+
+void ProgramBinaryCache::store(uint64_t key, unsigned int program, const std::string& name)
+{
+    if (!supported)
+        return;
+
+    GLint length = 0;
+    GLCall(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (length <= 0)
+        return;
+    std::vector<unsigned char> binary(length);
+    GLenum format = 0;
+    GLCall(glGetProgramBinary(program, length, &length, &format, binary.data()));
+
+    FILE* file = std::fopen(pathFor(key).c_str(), "wb");
+    if (!file) {
+        std::cerr << "Failed to write program binary to " << directory << std::endl;
+        return;
+    }
+    BinaryHeader header = { BinaryMagic, format, (uint32_t)length, 0, key };
+    std::fwrite(&header, sizeof(header), 1, file);
+    std::fwrite(binary.data(), 1, length, file);
+    std::fclose(file);
+    stats.stores++;
+    if (!name.empty())
+        evict(name, key);
+}
+
+void ProgramBinaryCache::evict(const std::string& name, uint64_t key)
+{
+    const std::string path = namePathFor(name);
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (file) {
+        uint64_t previous = 0;
+        bool read = std::fread(&previous, sizeof(previous), 1, file) == 1;
+        std::fclose(file);
+        if (read && previous == key)
+            return;
+        if (read && std::remove(pathFor(previous).c_str()) == 0)
+            stats.evicted++;
+    }
+
+    file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        return;
+    std::fwrite(&key, sizeof(key), 1, file);
+    std::fclose(file);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+struct ProgramBinaryCacheStats
+{
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+	unsigned int stores = 0;
+	// Binaries the driver refused, e.g. after a driver update.
+	unsigned int rejected = 0;
+	// Binaries deleted because their program name stored a newer one.
+	unsigned int evicted = 0;
+};
+
+// FNV-1a over size bytes, continuing from seed.
+uint64_t hashBytes64(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+// Linked programs persisted with glGetProgramBinary, one file per program in
+// directory. Keys combine the shader sources with the GL vendor, renderer and
+// version strings, so a driver change never loads a stale binary.
+// Needs GL 4.1 and at least one binary format;
+// otherwise every lookup misses and nothing is written.
+//
+// Every source edit produces a new key, so binaries stored under a program
+// name replace the one that name stored last; a small file per name records
+// its current key. Unnamed binaries are never evicted.
+class ProgramBinaryCache
+{
+private:
+	std::string directory;
+	uint64_t driverHash;
+	bool supported;
+	ProgramBinaryCacheStats stats;
+
+	std::string pathFor(uint64_t key) const;
+	std::string namePathFor(const std::string& name) const;
+	// Points name at key and deletes the binary it pointed at before.
+	void evict(const std::string& name, uint64_t key);
+public:
+	// Needs a current GL context. Creates directory if it is missing.
+	ProgramBinaryCache(const std::string& directory);
+
+	uint64_t makeKey(const std::string& vertexSource, const std::string& fragmentSource) const;
+	// Loads the binary stored under key into program. Returns false if there
+	// is none or the driver rejects it; the program then has to be compiled.
+	bool load(uint64_t key, unsigned int program);
+	// Stores the binary of a successfully linked program. With a name, the
+	// binary stored earlier under that name is deleted.
+	void store(uint64_t key, unsigned int program, const std::string& name = std::string());
+
+	inline bool isSupported() const { return supported; };
+	inline const ProgramBinaryCacheStats& getStats() const { return stats; };
+};
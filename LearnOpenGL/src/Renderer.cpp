@@ -1 +1,209 @@
 #include "Renderer.h"
+#include "Application.h"
+#include "GLState.h"
+#include "GpuProfiler.h"
+#include "UniformBlocks.h"
+#include "CpuProfiler.h"
+
+#include <chrono>
+#include <utility>
+
+Renderer::Renderer(UniformRing* uniforms)
+    : uniforms(uniforms)
+{
+}
+
+uint64_t Renderer::makeSortKey(unsigned int program, unsigned int vao, unsigned int material, float depth)
+{
+    if (!(depth > 0.0f))
+        depth = 0.0f;
+    else if (depth > 1.0f)
+        depth = 1.0f;
+    uint64_t depthBucket = (uint64_t)(depth * 65535.0f);
+
+    return ((uint64_t)(program & 0xFFFF) << 48)
+        | ((uint64_t)(vao & 0xFFFF) << 32)
+        | ((uint64_t)(material & 0xFFFF) << 16)
+        | depthBucket;
+}
+
+void Renderer::submit(DrawObject* object, unsigned int program, unsigned int objectConstants,
+    unsigned int material, float depth)
+{
+    SortEntry entry;
+    entry.key = makeSortKey(program, object->getVaoId(), material, depth);
+    entry.index = (uint32_t)commands.size();
+    entries.push_back(entry);
+    commands.push_back({ object, program, objectConstants });
+}
+
+// LSD radix sort over the 8 key bytes. All histograms are built in a single
+// pass and bytes that are identical for every entry are skipped, so a frame
+// with one program and a handful of VAOs only pays for two or three passes.
+void Renderer::sortEntries()
+{
+    const size_t count = entries.size();
+    stats.sortPasses = 0;
+    if (count < 2)
+        return;
+
+    uint32_t histograms[8][256] = {};
+    for (const SortEntry& entry : entries) {
+        uint64_t key = entry.key;
+        for (int byte = 0; byte < 8; byte++)
+            histograms[byte][(key >> (byte * 8)) & 0xFF]++;
+    }
+
+    scratch.resize(count);
+    SortEntry* src = entries.data();
+    SortEntry* dst = scratch.data();
+    for (int byte = 0; byte < 8; byte++) {
+        uint32_t* histogram = histograms[byte];
+        if (histogram[(src[0].key >> (byte * 8)) & 0xFF] == count)
+            continue;
+
+        uint32_t offset = 0;
+        for (int bucket = 0; bucket < 256; bucket++) {
+            uint32_t n = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += n;
+        }
+        for (size_t i = 0; i < count; i++)
+            dst[histogram[(src[i].key >> (byte * 8)) & 0xFF]++] = src[i];
+
+        std::swap(src, dst);
+        stats.sortPasses++;
+    }
+
+    if (src != entries.data())
+        entries.swap(scratch);
+}
+
+void Renderer::flush()
+{
+    PROFILE_ZONE("Renderer::flush");
+    stats = RendererStats();
+    stats.commands = (unsigned int)commands.size();
+
+    auto sortStart = std::chrono::steady_clock::now();
+    sortEntries();
+    auto sortEnd = std::chrono::steady_clock::now();
+    stats.sortMicroseconds = std::chrono::duration<double, std::micro>(sortEnd - sortStart).count();
+
+    // Each run of draws sharing a program is one GPU scope.
+    GPU_SCOPE("Renderer::flush");
+    bool first = true;
+    unsigned int currentProgram = 0;
+    unsigned int currentVao = 0;
+    for (const SortEntry& entry : entries) {
+        const RenderCommand& command = commands[entry.index];
+        unsigned int vao = command.object->getVaoId();
+
+        if (first || command.program != currentProgram) {
+            if (!first)
+                GpuProfiler::pop();
+            GpuProfiler::push("Program group");
+            GLState::useProgram(command.program);
+            currentProgram = command.program;
+            stats.programBinds++;
+        }
+        else {
+            stats.programBindsAvoided++;
+        }
+
+        if (first || vao != currentVao) {
+            command.object->bind();
+            currentVao = vao;
+            stats.vaoBinds++;
+        }
+        else {
+            stats.vaoBindsAvoided++;
+        }
+
+        if (uniforms && command.objectConstants != NoConstants) {
+            uniforms->bind<ObjectConstants>(ObjectBlockBinding, command.objectConstants);
+            stats.constantBinds++;
+        }
+
+        command.object->drawElements();
+        first = false;
+    }
+    if (!first)
+        GpuProfiler::pop();
+
+    commands.clear();
+    entries.clear();
+}
+
+void Renderer::execute(const std::vector<CommandList>& lists)
+{
+    PROFILE_ZONE("Renderer::execute");
+    stats = RendererStats();
+
+    // Lists recorded into a ring reservation are already in place; the rest
+    // are copied now.
+    listBases.resize(lists.size());
+    for (size_t i = 0; i < lists.size(); i++) {
+        listBases[i] = 0;
+        if (lists[i].hasRingConstants()) {
+            listBases[i] = lists[i].getRingOffset();
+        }
+        else if (lists[i].getConstantBytes()) {
+            ASSERT(uniforms);
+            listBases[i] = uniforms->push(lists[i].getConstantData(), lists[i].getConstantBytes());
+        }
+    }
+    if (uniforms)
+        uniforms->upload();
+
+    GPU_SCOPE("Renderer::execute");
+    bool programBound = false;
+    bool vaoBound = false;
+    unsigned int currentProgram = 0;
+    unsigned int currentVao = 0;
+    for (size_t i = 0; i < lists.size(); i++) {
+        unsigned int base = listBases[i];
+        lists[i].forEach([&](const CommandHeader& header) {
+            switch (header.type) {
+            case CommandType::BindProgram: {
+                unsigned int program = reinterpret_cast<const BindProgramCommand&>(header).program;
+                if (programBound && program == currentProgram) {
+                    stats.programBindsAvoided++;
+                    break;
+                }
+                GLState::useProgram(program);
+                currentProgram = program;
+                programBound = true;
+                stats.programBinds++;
+                break;
+            }
+            case CommandType::BindConstants: {
+                const BindConstantsCommand& command = reinterpret_cast<const BindConstantsCommand&>(header);
+                uniforms->bind(command.binding, base + command.offset, command.size);
+                stats.constantBinds++;
+                break;
+            }
+            case CommandType::Draw:
+            case CommandType::DrawInstanced: {
+                const DrawCommand& command = reinterpret_cast<const DrawCommand&>(header);
+                unsigned int vao = command.object->getVaoId();
+                if (!vaoBound || vao != currentVao) {
+                    command.object->bind();
+                    currentVao = vao;
+                    vaoBound = true;
+                    stats.vaoBinds++;
+                }
+                else {
+                    stats.vaoBindsAvoided++;
+                }
+                if (header.type == CommandType::Draw)
+                    command.object->drawElements();
+                else
+                    command.object->drawInstanced(command.instances);
+                stats.commands++;
+                break;
+            }
+            }
+        });
+    }
+}
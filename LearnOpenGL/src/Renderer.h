@@ -1,4 +1,75 @@
 #pragma once
+#include <cstdint>
+#include <vector>
+
+#include "DrawObject.h"
+#include "CommandList.h"
+#include "UniformRing.h"
+
+// Counters for the most recent Renderer::flush().
+struct RendererStats
+{
+	unsigned int commands = 0;
+	unsigned int programBinds = 0;
+	unsigned int vaoBinds = 0;
+	unsigned int programBindsAvoided = 0;
+	unsigned int vaoBindsAvoided = 0;
+	unsigned int constantBinds = 0;
+	unsigned int sortPasses = 0;
+	double sortMicroseconds = 0.0;
+};
+
+// Collects draw submissions for a frame and replays them ordered by a 64-bit
+// sort key so that objects sharing a program or vertex array are drawn together.
+// Per-object constants are ObjectConstants blocks already pushed to a
+// UniformRing; each draw binds its block's range rather than setting uniforms.
+//
+// Key layout (most significant first):
+//   [63:48] program   [47:32] vertex array   [31:16] material   [15:0] depth bucket
 class Renderer
-{};
+{
+private:
+	struct RenderCommand
+	{
+		DrawObject* object;
+		unsigned int program;
+		unsigned int objectConstants;
+	};
+	struct SortEntry
+	{
+		uint64_t key;
+		uint32_t index;
+	};
+
+	UniformRing* uniforms;
+	std::vector<RenderCommand> commands;
+	std::vector<SortEntry> entries;
+	std::vector<SortEntry> scratch;
+	std::vector<unsigned int> listBases;
+	RendererStats stats;
+
+	void sortEntries();
+public:
+	static const unsigned int NoConstants = 0xFFFFFFFFu;
+
+	Renderer(UniformRing* uniforms = nullptr);
+	~Renderer() = default;
+
+	static uint64_t makeSortKey(unsigned int program, unsigned int vao, unsigned int material, float depth);
+
+	// objectConstants is an offset returned by the UniformRing's push().
+	// depth is expected in [0, 1]; smaller values are drawn first within a state group.
+	void submit(DrawObject* object, unsigned int program, unsigned int objectConstants = NoConstants,
+		unsigned int material = 0, float depth = 0.0f);
+	// Sorts the queued commands, draws them and clears the queue.
+	void flush();
+	// Replays command lists in the order given, as one stream: binds that
+	// repeat the current program or vertex array are skipped, also across list
+	// boundaries. Each list's constant blocks are pushed to the UniformRing,
+	// unless the list was recorded into a range reserved there, and the ring
+	// is uploaded first, so push any other blocks of the frame before calling
+	// this and bind them through a list. Nothing is sorted.
+	void execute(const std::vector<CommandList>& lists);
 
+	inline const RendererStats& getStats() const { return stats; };
+};
@@ -0,0 +1,80 @@
+#include "ShaderBuildScheduler.h"
+
+#include <algorithm>
+
+namespace {
+
+typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+
+bool parallel = false;
+
+}
+
+bool ShaderBuildScheduler::install(GLADloadproc loader, unsigned int threads)
+{
+    parallel = false;
+    if (!hasGLExtension("GL_KHR_parallel_shader_compile"))
+        return false;
+
+    MaxShaderCompilerThreadsProc maxShaderCompilerThreads =
+        (MaxShaderCompilerThreadsProc)loader("glMaxShaderCompilerThreadsKHR");
+    if (maxShaderCompilerThreads) {
+        GLCall(maxShaderCompilerThreads(threads));
+    }
+    parallel = true;
+    return true;
+}
+
+bool ShaderBuildScheduler::isParallel()
+{
+    return parallel;
+}
+
+ShaderBuildScheduler::ShaderBuildScheduler(ProgramBinaryCache* cache)
+    : cache(cache)
+{
+}
+
+ShaderProgram& ShaderBuildScheduler::submit(const std::string& vertexSource, const std::string& fragmentSource,
+    const std::string& cacheName)
+{
+    programs.emplace_back(new ShaderProgram(vertexSource, fragmentSource, cache, ShaderProgram::Deferred()));
+    ShaderProgram* program = programs.back().get();
+    program->cacheName = cacheName;
+    pending.push_back(program);
+    return *program;
+}
+
+unsigned int ShaderBuildScheduler::poll()
+{
+    for (size_t i = 0; i < pending.size();) {
+        if (pending[i]->isCompletionReady()) {
+            pending[i]->finish();
+            pending[i] = pending.back();
+            pending.pop_back();
+        }
+        else {
+            i++;
+        }
+    }
+    return (unsigned int)pending.size();
+}
+
+void ShaderBuildScheduler::finish()
+{
+    for (ShaderProgram* program : pending)
+        program->finish();
+    pending.clear();
+}
+
+void ShaderBuildScheduler::release(ShaderProgram& program)
+{
+    pending.erase(std::remove(pending.begin(), pending.end(), &program), pending.end());
+    for (size_t i = 0; i < programs.size(); i++) {
+        if (programs[i].get() == &program) {
+            programs[i] = std::move(programs.back());
+            programs.pop_back();
+            return;
+        }
+    }
+}
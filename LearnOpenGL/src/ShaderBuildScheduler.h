@@ -0,0 +1,52 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Application.h"
+#include "ShaderProgram.h"
+
+// From GL_KHR_parallel_shader_compile; glad is generated without extensions.
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Starts every program build at once and finishes them as the driver reports
+// completion. With KHR_parallel_shader_compile the compiles run on driver
+// threads while startup continues; poll() never blocks, and callers draw with a
+// fallback program (see ShaderProgram::readyOr) until the real one has linked.
+// Without the extension the driver compiles inline and poll() finishes
+// everything that was submitted.
+//
+// The scheduler owns its programs; references stay valid for its lifetime.
+class ShaderBuildScheduler
+{
+private:
+	ProgramBinaryCache* cache;
+	std::vector<std::unique_ptr<ShaderProgram>> programs;
+	std::vector<ShaderProgram*> pending;
+public:
+	// Looks up KHR_parallel_shader_compile and asks for threads compiler
+	// threads; 0xFFFFFFFF lets the driver choose. Returns false if the
+	// extension is missing. Needs a current context.
+	static bool install(GLADloadproc loader, unsigned int threads = 0xFFFFFFFFu);
+	static bool isParallel();
+
+	ShaderBuildScheduler(ProgramBinaryCache* cache = nullptr);
+
+	// Issues the compile and link and returns the still pending program.
+	// cacheName, if set, names the program's binary in the cache so a rebuild
+	// replaces it.
+	ShaderProgram& submit(const std::string& vertexSource, const std::string& fragmentSource,
+		const std::string& cacheName = std::string());
+	// Finishes every program whose build has completed. Returns how many are
+	// still pending.
+	unsigned int poll();
+	// Blocks until every program is finished.
+	void finish();
+	// Destroys a program created by submit(), pending or not.
+	void release(ShaderProgram& program);
+
+	inline unsigned int getPendingCount() const { return (unsigned int)pending.size(); };
+	inline unsigned int getProgramCount() const { return (unsigned int)programs.size(); };
+};
@@ -0,0 +1,96 @@
+#include "ShaderLibrary.h"
+#include "ShaderSource.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <iostream>
+
+ShaderLibrary::ShaderLibrary(ShaderBuildScheduler& scheduler)
+    : scheduler(scheduler)
+{
+}
+
+ShaderLibrary::Handle ShaderLibrary::load(const std::string& vertexPath, const std::string& fragmentPath,
+    const VertexLayoutDesc& layout, uint32_t externalLocations)
+{
+    Entry entry;
+    entry.vertexPath = vertexPath;
+    entry.fragmentPath = fragmentPath;
+    entry.variants.reset(new ShaderVariants(scheduler, layout, externalLocations));
+    // reload() watches every file it tried, even if one fails to load, so
+    // fixing it triggers a build.
+    reload(entry);
+    // The default variant is nearly always drawn with, so it starts building now.
+    entry.variants->request(0);
+    entries.push_back(std::move(entry));
+    return (Handle)entries.size() - 1;
+}
+
+bool ShaderLibrary::reload(Entry& entry)
+{
+    ShaderSource vertex;
+    ShaderSource fragment;
+    bool loaded = loadShaderSource(entry.vertexPath, vertex);
+    loaded = loadShaderSource(entry.fragmentPath, fragment) && loaded;
+
+    // Includes may have changed too, so the dependency list is rebuilt. It is
+    // rebuilt on failure as well: a missing include is watched so creating it
+    // triggers the next build.
+    entry.dependencies.clear();
+    entry.dependencies.push_back(entry.vertexPath);
+    entry.dependencies.push_back(entry.fragmentPath);
+    for (const std::vector<std::string>* files : { &vertex.files, &fragment.files })
+        for (const std::string& file : *files)
+            if (std::find(entry.dependencies.begin(), entry.dependencies.end(), file) == entry.dependencies.end())
+                entry.dependencies.push_back(file);
+    for (const std::string& file : entry.dependencies)
+        watcher.watch(file);
+
+    if (!loaded)
+        return false;
+    entry.variants->setSources(vertex, fragment);
+    return true;
+}
+
+bool ShaderLibrary::dependsOnChanged(const Entry& entry) const
+{
+    for (const std::string& file : changed)
+        if (std::find(entry.dependencies.begin(), entry.dependencies.end(), file) != entry.dependencies.end())
+            return true;
+    return false;
+}
+
+void ShaderLibrary::update()
+{
+    PROFILE_ZONE("ShaderLibrary::update");
+    changed.clear();
+    watcher.poll(changed);
+    if (!changed.empty()) {
+        for (Entry& entry : entries) {
+            if (dependsOnChanged(entry)) {
+                std::cout << "Rebuilding " << entry.vertexPath << " + " << entry.fragmentPath << std::endl;
+                reload(entry);
+            }
+        }
+    }
+
+    scheduler.poll();
+    for (Entry& entry : entries)
+        entry.variants->update();
+}
+
+unsigned int ShaderLibrary::getVariantCount() const
+{
+    unsigned int count = 0;
+    for (const Entry& entry : entries)
+        count += entry.variants->getVariantCount();
+    return count;
+}
+
+unsigned int ShaderLibrary::getReloadCount() const
+{
+    unsigned int count = 0;
+    for (const Entry& entry : entries)
+        count += entry.variants->getReloadCount();
+    return count;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FileWatcher.h"
+#include "ShaderBuildScheduler.h"
+#include "ShaderProgram.h"
+#include "ShaderVariants.h"
+#include "VertexLayout.h"
+
+// Programs built from shader files and rebuilt when any file they were
+// assembled from changes, #includes included. Each entry is a set of
+// ShaderVariants. Rebuilds go through the ShaderBuildScheduler, so the frame
+// loop never waits on the compiler, and the previous program keeps drawing
+// until the new one links. A rebuild that fails to compile is dropped with its
+// error printed.
+class ShaderLibrary
+{
+public:
+	typedef unsigned int Handle;
+private:
+	struct Entry
+	{
+		std::string vertexPath;
+		std::string fragmentPath;
+		std::vector<std::string> dependencies;
+		std::unique_ptr<ShaderVariants> variants;
+	};
+	ShaderBuildScheduler& scheduler;
+	FileWatcher watcher;
+	std::vector<Entry> entries;
+	std::vector<std::string> changed;
+
+	// Reads the sources and hands them to the entry's variants.
+	bool reload(Entry& entry);
+	bool dependsOnChanged(const Entry& entry) const;
+public:
+	ShaderLibrary(ShaderBuildScheduler& scheduler);
+
+	// Loads a program and starts building its default variant. Every variant
+	// is checked against layout when it links.
+	Handle load(const std::string& vertexPath, const std::string& fragmentPath,
+		const VertexLayoutDesc& layout, uint32_t externalLocations = 0);
+	// Polls the scheduler and the file watcher, starts rebuilds for changed
+	// files and swaps in rebuilt programs that have linked. Call once a frame.
+	void update();
+
+	// Variant mask bit for a keyword declared by handle's sources.
+	inline uint64_t keyword(Handle handle, const char* name) const { return entries[handle].variants->keyword(name); };
+	// The program for handle and variant, or fallback while it has not linked
+	// yet. Unseen variants start building here.
+	inline ShaderProgram& getOr(Handle handle, ShaderProgram& fallback) { return entries[handle].variants->get(0, fallback); };
+	inline ShaderProgram& getOr(Handle handle, uint64_t variant, ShaderProgram& fallback) { return entries[handle].variants->get(variant, fallback); };
+
+	// Linked variants across every loaded pair.
+	unsigned int getVariantCount() const;
+	unsigned int getReloadCount() const;
+};
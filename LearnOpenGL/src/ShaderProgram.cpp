@@ -1 +1,301 @@
 #include "ShaderProgram.h"
+#include "GLState.h"
+#include "ShaderBuildScheduler.h"
+
+#include <chrono>
+#include <iostream>
+
+namespace {
+
+const char* shaderTypeName(unsigned int type)
+{
+    return type == GL_VERTEX_SHADER ? "vertex" : "fragment";
+}
+
+unsigned int submitShader(const std::string& source, unsigned int type)
+{
+    GLCall(unsigned int id = glCreateShader(type));
+    const char* src = source.c_str();
+    GLCall(glShaderSource(id, 1, &src, nullptr));
+    GLCall(glCompileShader(id));
+    return id;
+}
+
+bool checkShader(unsigned int id, unsigned int type)
+{
+    int result;
+    GLCall(glGetShaderiv(id, GL_COMPILE_STATUS, &result));
+    if (result == GL_FALSE) {
+        int length;
+        GLCall(glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length));
+        std::string message(length, '\0');
+        GLCall(glGetShaderInfoLog(id, length, &length, &message[0]));
+        message.resize(length);
+        std::cerr << "Failed to compile " << shaderTypeName(type) << " shader!" << std::endl;
+        std::cerr << message << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool checkProgram(unsigned int program)
+{
+    int result;
+    GLCall(glGetProgramiv(program, GL_LINK_STATUS, &result));
+    if (result == GL_FALSE) {
+        int length;
+        GLCall(glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length));
+        std::string message(length, '\0');
+        GLCall(glGetProgramInfoLog(program, length, &length, &message[0]));
+        message.resize(length);
+        std::cerr << "Failed to link program!" << std::endl;
+        std::cerr << message << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}
+
+LocationCache::LocationCache()
+    : entries(16), count(0)
+{
+}
+
+void LocationCache::grow()
+{
+    std::vector<Entry> old(entries.empty() ? 16 : entries.size() * 2);
+    old.swap(entries);
+    size_t mask = entries.size() - 1;
+    for (Entry& entry : old) {
+        if (!entry.used)
+            continue;
+        size_t slot = (size_t)entry.hash & mask;
+        while (entries[slot].used)
+            slot = (slot + 1) & mask;
+        entries[slot] = std::move(entry);
+    }
+}
+
+void LocationCache::clear()
+{
+    for (Entry& entry : entries)
+        entry = Entry();
+    count = 0;
+}
+
+ShaderProgram::ShaderProgram(const std::string& vertexSource, const std::string& fragmentSource, ProgramBinaryCache* cache)
+    : ShaderProgram(vertexSource, fragmentSource, cache, Deferred())
+{
+    finish();
+}
+
+ShaderProgram::ShaderProgram(const std::string& vertexSource, const std::string& fragmentSource, ProgramBinaryCache* cache, Deferred)
+    : programID(0), vertexShaderID(0), fragmentShaderID(0), status(Status::Pending), cache(cache), cacheKey(0),
+    expectedLayout(nullptr), externalLocations(0), fromCache(false), loadMicroseconds(0.0)
+{
+    submit(vertexSource, fragmentSource);
+}
+
+void ShaderProgram::submit(const std::string& vertexSource, const std::string& fragmentSource)
+{
+    submitTime = std::chrono::steady_clock::now();
+    GLCall(programID = glCreateProgram());
+
+    cacheKey = cache ? cache->makeKey(vertexSource, fragmentSource) : 0;
+    fromCache = cache && cache->load(cacheKey, programID);
+    if (fromCache)
+        return;
+
+    if (cache && cache->isSupported()) {
+        GLCall(glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    }
+    // Linking straight after compiling lets the driver chain both jobs; the
+    // statuses are only read in finish().
+    vertexShaderID = submitShader(vertexSource, GL_VERTEX_SHADER);
+    fragmentShaderID = submitShader(fragmentSource, GL_FRAGMENT_SHADER);
+    GLCall(glAttachShader(programID, vertexShaderID));
+    GLCall(glAttachShader(programID, fragmentShaderID));
+    GLCall(glLinkProgram(programID));
+}
+
+bool ShaderProgram::isCompletionReady()
+{
+    if (status != Status::Pending || fromCache || !ShaderBuildScheduler::isParallel())
+        return true;
+    GLint complete = GL_TRUE;
+    GLCall(glGetProgramiv(programID, GL_COMPLETION_STATUS_KHR, &complete));
+    return complete == GL_TRUE;
+}
+
+void ShaderProgram::finish()
+{
+    if (status != Status::Pending)
+        return;
+
+    bool linked = fromCache;
+    if (!fromCache) {
+        bool compiled = checkShader(vertexShaderID, GL_VERTEX_SHADER);
+        compiled = checkShader(fragmentShaderID, GL_FRAGMENT_SHADER) && compiled;
+        linked = compiled && checkProgram(programID);
+
+        GLCall(glDetachShader(programID, vertexShaderID));
+        GLCall(glDetachShader(programID, fragmentShaderID));
+        GLCall(glDeleteShader(vertexShaderID));
+        GLCall(glDeleteShader(fragmentShaderID));
+        vertexShaderID = 0;
+        fragmentShaderID = 0;
+        if (linked && cache)
+            cache->store(cacheKey, programID, cacheName);
+    }
+
+    if (linked) {
+        status = Status::Linked;
+        reflect();
+        if (expectedLayout && !matchesLayout(*expectedLayout, externalLocations))
+            std::cerr << "Shader inputs do not match the vertex layout!" << std::endl;
+    }
+    else {
+        status = Status::Failed;
+        GLCall(glDeleteProgram(programID));
+        programID = 0;
+    }
+    loadMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - submitTime).count();
+}
+
+void ShaderProgram::reflect()
+{
+    // Binding points are program state that neither GLSL 3.30 nor a restored
+    // program binary sets, so they are assigned after every link.
+    reflection.reflect(programID);
+    reflection.assignBindings(programID);
+
+    // Every active name is known now; later lookups never reach the driver.
+    uniforms.clear();
+    attributes.clear();
+    for (const ReflectedUniform& uniform : reflection.getUniforms())
+        uniforms.find(uniform.name.c_str(), [&uniform](const char*) { return uniform.location; });
+    for (const ReflectedSampler& sampler : reflection.getSamplers())
+        uniforms.find(sampler.name.c_str(), [&sampler](const char*) { return sampler.location; });
+    for (const ReflectedInput& input : reflection.getInputs())
+        attributes.find(input.name.c_str(), [&input](const char*) { return input.location; });
+}
+
+ShaderProgram::~ShaderProgram()
+{
+    release();
+}
+
+void ShaderProgram::release()
+{
+    if (vertexShaderID) {
+        GLCall(glDeleteShader(vertexShaderID));
+    }
+    if (fragmentShaderID) {
+        GLCall(glDeleteShader(fragmentShaderID));
+    }
+    // The GL defers the deletion itself while the program is in use.
+    if (programID) {
+        GLState::forgetProgram(programID);
+        GLCall(glDeleteProgram(programID));
+    }
+}
+
+ShaderProgram::ShaderProgram(ShaderProgram&& other)
+    : programID(other.programID), vertexShaderID(other.vertexShaderID), fragmentShaderID(other.fragmentShaderID),
+    status(other.status), cache(other.cache), cacheKey(other.cacheKey), cacheName(std::move(other.cacheName)), expectedLayout(other.expectedLayout),
+    externalLocations(other.externalLocations), uniforms(std::move(other.uniforms)), attributes(std::move(other.attributes)),
+    reflection(std::move(other.reflection)), fromCache(other.fromCache), submitTime(other.submitTime), loadMicroseconds(other.loadMicroseconds)
+{
+    other.programID = 0;
+    other.vertexShaderID = 0;
+    other.fragmentShaderID = 0;
+    other.status = Status::Failed;
+    other.uniforms.clear();
+    other.attributes.clear();
+    other.reflection.clear();
+}
+
+ShaderProgram& ShaderProgram::operator=(ShaderProgram&& other)
+{
+    if (this != &other) {
+        release();
+        programID = other.programID;
+        vertexShaderID = other.vertexShaderID;
+        fragmentShaderID = other.fragmentShaderID;
+        status = other.status;
+        cache = other.cache;
+        cacheKey = other.cacheKey;
+        cacheName = std::move(other.cacheName);
+        expectedLayout = other.expectedLayout;
+        externalLocations = other.externalLocations;
+        uniforms = std::move(other.uniforms);
+        attributes = std::move(other.attributes);
+        reflection = std::move(other.reflection);
+        fromCache = other.fromCache;
+        submitTime = other.submitTime;
+        loadMicroseconds = other.loadMicroseconds;
+        other.programID = 0;
+        other.vertexShaderID = 0;
+        other.fragmentShaderID = 0;
+        other.status = Status::Failed;
+        other.uniforms.clear();
+        other.attributes.clear();
+        other.reflection.clear();
+    }
+    return *this;
+}
+
+void ShaderProgram::bind()
+{
+    GLState::useProgram(programID);
+}
+
+int ShaderProgram::getUniformLocation(const char* name)
+{
+    unsigned int program = programID;
+    return uniforms.find(name, [program](const char* n) { return glGetUniformLocation(program, n); });
+}
+
+int ShaderProgram::getAttributeLocation(const char* name)
+{
+    unsigned int program = programID;
+    return attributes.find(name, [program](const char* n) { return glGetAttribLocation(program, n); });
+}
+
+void ShaderProgram::setUniform(const char* name, int value)
+{
+    bind();
+    GLCall(glUniform1i(getUniformLocation(name), value));
+}
+
+void ShaderProgram::setUniform(const char* name, float value)
+{
+    bind();
+    GLCall(glUniform1f(getUniformLocation(name), value));
+}
+
+void ShaderProgram::setUniform(const char* name, float x, float y, float z, float w)
+{
+    bind();
+    GLCall(glUniform4f(getUniformLocation(name), x, y, z, w));
+}
+
+void ShaderProgram::setUniformMatrix4(const char* name, const float* columnMajor)
+{
+    bind();
+    GLCall(glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, columnMajor));
+}
+
+bool ShaderProgram::matchesLayout(const VertexLayoutDesc& layout, uint32_t externalLocations)
+{
+    return reflection.validateLayout(layout, externalLocations);
+}
+
+void ShaderProgram::setExpectedLayout(const VertexLayoutDesc& layout, uint32_t externalLocations)
+{
+    expectedLayout = &layout;
+    this->externalLocations = externalLocations;
+    if (status == Status::Linked && !matchesLayout(layout, externalLocations))
+        std::cerr << "Shader inputs do not match the vertex layout!" << std::endl;
+}
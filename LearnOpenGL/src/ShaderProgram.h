@@ -1,4 +1,145 @@
 #pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Application.h"
+#include "ProgramBinaryCache.h"
+#include "ShaderReflection.h"
+#include "VertexLayout.h"
+
+// Open-addressing map from names to GL locations. A lookup hashes the name
+// and compares strings only on a hash match; nothing is allocated after the
+// first query for a name. Missing names are cached as -1 too.
+class LocationCache
+{
+private:
+	struct Entry
+	{
+		uint64_t hash = 0;
+		std::string name;
+		int location = -1;
+		bool used = false;
+	};
+	std::vector<Entry> entries;
+	unsigned int count;
+
+	void grow();
+public:
+	LocationCache();
+
+	// Returns the cached location of name, calling query(name) on a miss.
+	template<typename Query>
+	int find(const char* name, Query query);
+	void clear();
+	inline unsigned int getCount() const { return count; };
+};
+
+template<typename Query>
+int LocationCache::find(const char* name, Query query)
+{
+	size_t length = std::char_traits<char>::length(name);
+	uint64_t hash = hashBytes64(name, length);
+	if ((count + 1) * 4 > entries.size() * 3)
+		grow();
+
+	size_t mask = entries.size() - 1;
+	for (size_t slot = (size_t)hash & mask;; slot = (slot + 1) & mask) {
+		Entry& entry = entries[slot];
+		if (!entry.used) {
+			entry.hash = hash;
+			entry.name.assign(name, length);
+			entry.location = query(name);
+			entry.used = true;
+			count++;
+			return entry.location;
+		}
+		if (entry.hash == hash && entry.name.compare(0, std::string::npos, name, length) == 0)
+			return entry.location;
+	}
+}
+
+class ShaderBuildScheduler;
+
+// Owns a linked vertex + fragment program. On link the program is reflected,
+// its block bindings and sampler units are assigned, and every active
+// uniform and attribute location is put in a LocationCache. With a
+// ProgramBinaryCache, a program linked on an earlier run is restored from its
+// binary and no GLSL is compiled.
+//
+// The public constructor builds synchronously. Programs created through a
+// ShaderBuildScheduler start out pending and are finished once the driver
+// reports completion, so nothing here blocks on the compiler until then.
 class ShaderProgram
-{};
+{
+public:
+	enum class Status { Pending, Linked, Failed };
+private:
+	unsigned int programID;
+	unsigned int vertexShaderID;
+	unsigned int fragmentShaderID;
+	Status status;
+	ProgramBinaryCache* cache;
+	uint64_t cacheKey;
+	// Name the binary is stored under; see ProgramBinaryCache::store().
+	std::string cacheName;
+	const VertexLayoutDesc* expectedLayout;
+	uint32_t externalLocations;
+	LocationCache uniforms;
+	LocationCache attributes;
+	ShaderReflection reflection;
+	bool fromCache;
+	std::chrono::steady_clock::time_point submitTime;
+	double loadMicroseconds;
+
+	struct Deferred {};
+	ShaderProgram(const std::string& vertexSource, const std::string& fragmentSource, ProgramBinaryCache* cache, Deferred);
+	// Issues the compile and link (or binary load) without querying results.
+	void submit(const std::string& vertexSource, const std::string& fragmentSource);
+	// True once finish() would not block. Always true without
+	// KHR_parallel_shader_compile.
+	bool isCompletionReady();
+	// Collects compile and link results. Blocks if the driver is still busy.
+	void finish();
+	void release();
+	void reflect();
+
+	friend class ShaderBuildScheduler;
+public:
+	ShaderProgram(const std::string& vertexSource, const std::string& fragmentSource, ProgramBinaryCache* cache = nullptr);
+	~ShaderProgram();
+
+	ShaderProgram(const ShaderProgram&) = delete;
+	ShaderProgram& operator=(const ShaderProgram&) = delete;
+	ShaderProgram(ShaderProgram&& other);
+	ShaderProgram& operator=(ShaderProgram&& other);
+
+	void bind();
+
+	int getUniformLocation(const char* name);
+	int getAttributeLocation(const char* name);
+	// The setters bind the program first.
+	void setUniform(const char* name, int value);
+	void setUniform(const char* name, float value);
+	void setUniform(const char* name, float x, float y, float z, float w);
+	void setUniformMatrix4(const char* name, const float* columnMajor);
+
+	// See ShaderReflection::validateLayout().
+	bool matchesLayout(const VertexLayoutDesc& layout, uint32_t externalLocations = 0);
+	// Checks the program against layout as soon as it links, printing an
+	// error on a mismatch.
+	void setExpectedLayout(const VertexLayoutDesc& layout, uint32_t externalLocations = 0);
+
+	inline unsigned int getId() const { return programID; };
+	inline Status getStatus() const { return status; };
+	inline const ShaderReflection& getReflection() const { return reflection; };
+	inline bool isLinked() const { return status == Status::Linked; };
+	inline bool wasLoadedFromCache() const { return fromCache; };
+	// Wall time from submission until the program was finished, including
+	// compile or binary load.
+	inline double getLoadMicroseconds() const { return loadMicroseconds; };
 
+	// program if it has linked, otherwise fallback.
+	static inline ShaderProgram& readyOr(ShaderProgram& program, ShaderProgram& fallback) { return program.isLinked() ? program : fallback; };
+};
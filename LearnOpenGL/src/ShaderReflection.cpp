@@ -0,0 +1,305 @@
+#include "ShaderReflection.h"
+#include "GLState.h"
+#include "UniformBlocks.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// Blocks not in UniformBlocks.h, in the order they were first seen. Each
+// name keeps its binding for every program, so two programs' private blocks
+// never share a binding point.
+std::vector<std::string> privateBlocks;
+
+bool isBuiltIn(const char* name)
+{
+    return std::strncmp(name, "gl_", 3) == 0;
+}
+
+// GL reports arrays as "name[0]"; they are recorded without the suffix.
+std::string baseName(const char* name)
+{
+    size_t length = std::strlen(name);
+    if (length > 3 && std::strcmp(name + length - 3, "[0]") == 0)
+        length -= 3;
+    return std::string(name, length);
+}
+
+bool isSamplerType(GLenum type)
+{
+    switch (type) {
+    case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_CUBE_SHADOW:
+    case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_1D_ARRAY_SHADOW: case GL_SAMPLER_2D_ARRAY_SHADOW:
+    case GL_SAMPLER_2D_MULTISAMPLE: case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+    case GL_SAMPLER_BUFFER: case GL_SAMPLER_2D_RECT: case GL_SAMPLER_2D_RECT_SHADOW:
+    case GL_INT_SAMPLER_1D: case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_CUBE:
+    case GL_INT_SAMPLER_1D_ARRAY: case GL_INT_SAMPLER_2D_ARRAY:
+    case GL_INT_SAMPLER_2D_MULTISAMPLE: case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+    case GL_INT_SAMPLER_BUFFER: case GL_INT_SAMPLER_2D_RECT:
+    case GL_UNSIGNED_INT_SAMPLER_1D: case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D:
+    case GL_UNSIGNED_INT_SAMPLER_CUBE: case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE: case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_BUFFER: case GL_UNSIGNED_INT_SAMPLER_2D_RECT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Component count and whether the GLSL input type is integer.
+bool describeInputType(GLenum type, int& components, bool& integer)
+{
+    integer = false;
+    switch (type) {
+    case GL_FLOAT: components = 1; return true;
+    case GL_FLOAT_VEC2: components = 2; return true;
+    case GL_FLOAT_VEC3: components = 3; return true;
+    case GL_FLOAT_VEC4: components = 4; return true;
+    case GL_INT: case GL_UNSIGNED_INT: components = 1; integer = true; return true;
+    case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2: components = 2; integer = true; return true;
+    case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3: components = 3; integer = true; return true;
+    case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4: components = 4; integer = true; return true;
+    default: return false;
+    }
+}
+
+template<typename T>
+const T* findByName(const std::vector<T>& resources, const char* name)
+{
+    for (const T& resource : resources)
+        if (resource.name == name)
+            return &resource;
+    return nullptr;
+}
+
+}
+
+void ShaderReflection::clear()
+{
+    inputs.clear();
+    uniforms.clear();
+    blocks.clear();
+    samplers.clear();
+}
+
+void ShaderReflection::reflect(unsigned int program)
+{
+    clear();
+    if (GLAD_GL_VERSION_4_3)
+        reflectInterfaces(program);
+    else
+        reflectActive(program);
+}
+
+void ShaderReflection::addUniform(const char* name, int location, GLenum type, int arraySize, int blockIndex)
+{
+    if (isBuiltIn(name) || blockIndex >= 0)
+        return;
+    if (isSamplerType(type))
+        samplers.push_back({ baseName(name), location, type, arraySize, 0 });
+    else
+        uniforms.push_back({ baseName(name), location, type, arraySize });
+}
+
+void ShaderReflection::reflectInterfaces(unsigned int program)
+{
+    GLint count = 0;
+    GLint maxLength = 0;
+    std::vector<char> name;
+    auto readName = [&](GLenum interface, GLint index) {
+        GLCall(glGetProgramResourceName(program, interface, (GLuint)index, (GLsizei)name.size(), nullptr, name.data()));
+    };
+
+    GLCall(glGetProgramInterfaceiv(program, GL_PROGRAM_INPUT, GL_ACTIVE_RESOURCES, &count));
+    GLCall(glGetProgramInterfaceiv(program, GL_PROGRAM_INPUT, GL_MAX_NAME_LENGTH, &maxLength));
+    name.resize(maxLength > 0 ? maxLength : 1);
+    for (GLint i = 0; i < count; i++) {
+        const GLenum properties[] = { GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION };
+        GLint values[3] = {};
+        GLCall(glGetProgramResourceiv(program, GL_PROGRAM_INPUT, (GLuint)i, 3, properties, 3, nullptr, values));
+        readName(GL_PROGRAM_INPUT, i);
+        if (!isBuiltIn(name.data()))
+            inputs.push_back({ baseName(name.data()), values[2], (GLenum)values[0], values[1] });
+    }
+
+    GLCall(glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count));
+    GLCall(glGetProgramInterfaceiv(program, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxLength));
+    name.resize(maxLength > 0 ? maxLength : 1);
+    for (GLint i = 0; i < count; i++) {
+        const GLenum properties[] = { GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION, GL_BLOCK_INDEX };
+        GLint values[4] = {};
+        GLCall(glGetProgramResourceiv(program, GL_UNIFORM, (GLuint)i, 4, properties, 4, nullptr, values));
+        readName(GL_UNIFORM, i);
+        addUniform(name.data(), values[2], (GLenum)values[0], values[1], values[3]);
+    }
+
+    GLCall(glGetProgramInterfaceiv(program, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES, &count));
+    GLCall(glGetProgramInterfaceiv(program, GL_UNIFORM_BLOCK, GL_MAX_NAME_LENGTH, &maxLength));
+    name.resize(maxLength > 0 ? maxLength : 1);
+    for (GLint i = 0; i < count; i++) {
+        const GLenum properties[] = { GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+        GLint values[2] = {};
+        GLCall(glGetProgramResourceiv(program, GL_UNIFORM_BLOCK, (GLuint)i, 2, properties, 2, nullptr, values));
+        readName(GL_UNIFORM_BLOCK, i);
+        blocks.push_back({ name.data(), (unsigned int)i, (unsigned int)values[0], values[1] });
+    }
+}
+
+void ShaderReflection::reflectActive(unsigned int program)
+{
+    GLint count = 0;
+    GLint maxLength = 0;
+    std::vector<char> name;
+
+    GLCall(glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count));
+    GLCall(glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength));
+    name.resize(maxLength > 0 ? maxLength : 1);
+    for (GLint i = 0; i < count; i++) {
+        GLint arraySize = 0;
+        GLenum type = 0;
+        GLCall(glGetActiveAttrib(program, (GLuint)i, (GLsizei)name.size(), nullptr, &arraySize, &type, name.data()));
+        if (isBuiltIn(name.data()))
+            continue;
+        GLCall(GLint location = glGetAttribLocation(program, name.data()));
+        inputs.push_back({ baseName(name.data()), location, type, arraySize });
+    }
+
+    GLCall(glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count));
+    GLCall(glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength));
+    name.resize(maxLength > 0 ? maxLength : 1);
+    for (GLint i = 0; i < count; i++) {
+        GLint arraySize = 0;
+        GLenum type = 0;
+        GLuint index = (GLuint)i;
+        GLint blockIndex = -1;
+        GLCall(glGetActiveUniform(program, index, (GLsizei)name.size(), nullptr, &arraySize, &type, name.data()));
+        GLCall(glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &blockIndex));
+        GLint location = -1;
+        if (blockIndex < 0) {
+            GLCall(location = glGetUniformLocation(program, name.data()));
+        }
+        addUniform(name.data(), location, type, arraySize, blockIndex);
+    }
+
+    GLCall(glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count));
+    GLCall(glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength));
+    name.resize(maxLength > 0 ? maxLength : 1);
+    for (GLint i = 0; i < count; i++) {
+        GLint binding = 0;
+        GLint dataSize = 0;
+        GLCall(glGetActiveUniformBlockName(program, (GLuint)i, (GLsizei)name.size(), nullptr, name.data()));
+        GLCall(glGetActiveUniformBlockiv(program, (GLuint)i, GL_UNIFORM_BLOCK_BINDING, &binding));
+        GLCall(glGetActiveUniformBlockiv(program, (GLuint)i, GL_UNIFORM_BLOCK_DATA_SIZE, &dataSize));
+        blocks.push_back({ name.data(), (unsigned int)i, (unsigned int)binding, dataSize });
+    }
+}
+
+unsigned int ShaderReflection::getBlockBinding(const std::string& name)
+{
+    unsigned int firstPrivate = 0;
+    for (const UniformBlockInfo& block : uniformBlocks) {
+        if (name == block.name)
+            return block.binding;
+        if (block.binding >= firstPrivate)
+            firstPrivate = block.binding + 1;
+    }
+
+    size_t index = 0;
+    while (index < privateBlocks.size() && privateBlocks[index] != name)
+        index++;
+    if (index == privateBlocks.size()) {
+        privateBlocks.push_back(name);
+        GLint maxBindings = 0;
+        GLCall(glGetIntegerv(GL_MAX_UNIFORM_BUFFER_BINDINGS, &maxBindings));
+        if (firstPrivate + index >= (unsigned int)maxBindings)
+            std::cerr << "Out of uniform buffer bindings for block " << name << std::endl;
+    }
+    return firstPrivate + (unsigned int)index;
+}
+
+void ShaderReflection::assignBindings(unsigned int program)
+{
+    for (ReflectedBlock& block : blocks) {
+        block.binding = getBlockBinding(block.name);
+        GLCall(glUniformBlockBinding(program, block.index, block.binding));
+    }
+
+    unsigned int nextUnit = 0;
+    std::vector<GLint> units;
+    for (ReflectedSampler& sampler : samplers) {
+        sampler.unit = nextUnit;
+        units.resize(sampler.arraySize > 0 ? sampler.arraySize : 1);
+        for (GLint& unit : units)
+            unit = (GLint)nextUnit++;
+        if (GLAD_GL_VERSION_4_1) {
+            GLCall(glProgramUniform1iv(program, sampler.location, (GLsizei)units.size(), units.data()));
+        }
+        else {
+            GLState::useProgram(program);
+            GLCall(glUniform1iv(sampler.location, (GLsizei)units.size(), units.data()));
+        }
+    }
+}
+
+bool ShaderReflection::validateLayout(const VertexLayoutDesc& layout, uint32_t externalLocations) const
+{
+    bool valid = true;
+    for (const ReflectedInput& input : inputs) {
+        int location = input.location;
+        if (location < 0 || (location < 32 && (externalLocations & (1u << location))))
+            continue;
+
+        const VertexAttributeDesc* attribute = nullptr;
+        for (unsigned int a = 0; a < layout.count; a++)
+            if (layout.attributes[a].location == (GLuint)location)
+                attribute = &layout.attributes[a];
+
+        if (!attribute) {
+            std::cerr << "[VertexLayout] input '" << input.name << "' (location " << location
+                << ") is not provided by the vertex layout" << std::endl;
+            valid = false;
+            continue;
+        }
+
+        int components = 0;
+        bool integer = false;
+        if (!describeInputType(input.type, components, integer))
+            continue;
+        if (integer) {
+            std::cerr << "[VertexLayout] input '" << input.name << "' is an integer type but the layout "
+                "supplies a float format" << std::endl;
+            valid = false;
+        }
+        // Missing components default to 0 (and w to 1), which is only
+        // intended for w.
+        if (attribute->components < components && !(components == 4 && attribute->components == 3)) {
+            std::cerr << "[VertexLayout] input '" << input.name << "' reads " << components
+                << " components but the layout supplies " << attribute->components << std::endl;
+            valid = false;
+        }
+    }
+    return valid;
+}
+
+const ReflectedInput* ShaderReflection::findInput(const char* name) const
+{
+    return findByName(inputs, name);
+}
+
+const ReflectedUniform* ShaderReflection::findUniform(const char* name) const
+{
+    return findByName(uniforms, name);
+}
+
+const ReflectedBlock* ShaderReflection::findBlock(const char* name) const
+{
+    return findByName(blocks, name);
+}
+
+const ReflectedSampler* ShaderReflection::findSampler(const char* name) const
+{
+    return findByName(samplers, name);
+}
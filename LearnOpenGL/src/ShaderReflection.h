@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Application.h"
+#include "VertexLayout.h"
+
+struct ReflectedInput
+{
+	std::string name;
+	int location;
+	GLenum type;
+	int arraySize;
+};
+
+// A default-block uniform that is not a sampler.
+struct ReflectedUniform
+{
+	std::string name;
+	int location;
+	GLenum type;
+	int arraySize;
+};
+
+struct ReflectedBlock
+{
+	std::string name;
+	unsigned int index;
+	unsigned int binding;
+	int dataSize;
+};
+
+struct ReflectedSampler
+{
+	std::string name;
+	int location;
+	GLenum type;
+	int arraySize;
+	// First texture unit; arrays use arraySize consecutive units.
+	unsigned int unit;
+};
+
+// What a linked program reads: vertex inputs, default-block uniforms, uniform
+// blocks and samplers. Uses the GL 4.3 program interface queries when present
+// and glGetActiveAttrib / glGetActiveUniform otherwise. Built-ins (gl_*) are
+// left out.
+//
+// assignBindings() fixes every binding point once, right after the link:
+// blocks listed in UniformBlocks.h get their shared binding, samplers get
+// texture units in declaration order. Any other block gets a binding above the
+// shared ones that is unique to its name across all programs. Drawing then
+// needs no name lookups.
+class ShaderReflection
+{
+private:
+	std::vector<ReflectedInput> inputs;
+	std::vector<ReflectedUniform> uniforms;
+	std::vector<ReflectedBlock> blocks;
+	std::vector<ReflectedSampler> samplers;
+
+	void reflectInterfaces(unsigned int program);
+	void reflectActive(unsigned int program);
+	void addUniform(const char* name, int location, GLenum type, int arraySize, int blockIndex);
+public:
+	void reflect(unsigned int program);
+	void assignBindings(unsigned int program);
+	void clear();
+
+	// The binding assignBindings() gives a block named name, allocating one
+	// if no program has used that name yet. GL thread only.
+	static unsigned int getBlockBinding(const std::string& name);
+
+	// Reports inputs the layout does not provide (unless their location bit is
+	// set in externalLocations, e.g. instanced attributes from another
+	// buffer), integer inputs fed by float formats, and inputs reading more
+	// components than the layout supplies. Returns false on any mismatch.
+	bool validateLayout(const VertexLayoutDesc& layout, uint32_t externalLocations = 0) const;
+
+	// nullptr if the program has no such resource.
+	const ReflectedInput* findInput(const char* name) const;
+	const ReflectedUniform* findUniform(const char* name) const;
+	const ReflectedBlock* findBlock(const char* name) const;
+	const ReflectedSampler* findSampler(const char* name) const;
+
+	inline const std::vector<ReflectedInput>& getInputs() const { return inputs; };
+	inline const std::vector<ReflectedUniform>& getUniforms() const { return uniforms; };
+	inline const std::vector<ReflectedBlock>& getBlocks() const { return blocks; };
+	inline const std::vector<ReflectedSampler>& getSamplers() const { return samplers; };
+};
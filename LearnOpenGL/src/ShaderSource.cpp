@@ -0,0 +1,120 @@
+#include "ShaderSource.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+std::string directoryOf(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+// Returns the quoted file name if line is an #include directive.
+bool parseInclude(const std::string& line, std::string& name)
+{
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+        return false;
+    size_t open = line.find('"', start + 8);
+    size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+    if (close == std::string::npos)
+        return false;
+    name = line.substr(open + 1, close - open - 1);
+    return true;
+}
+
+// Adds the names of a "#pragma keywords" line to keywords.
+bool parseKeywords(const std::string& line, std::vector<std::string>& keywords)
+{
+    std::istringstream words(line);
+    std::string pragma, kind, name;
+    if (!(words >> pragma >> kind) || pragma != "#pragma" || kind != "keywords")
+        return false;
+    while (words >> name)
+        if (std::find(keywords.begin(), keywords.end(), name) == keywords.end())
+            keywords.push_back(name);
+    return true;
+}
+
+bool appendFile(const std::string& path, ShaderSource& source)
+{
+    if (std::find(source.files.begin(), source.files.end(), path) != source.files.end())
+        return true;
+
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Failed to open shader file " << path << std::endl;
+        // Listed anyway so the caller can watch for it to appear.
+        source.files.push_back(path);
+        return false;
+    }
+    const unsigned int index = (unsigned int)source.files.size();
+    source.files.push_back(path);
+    // The root file starts with #version, which has to stay first.
+    if (index > 0)
+        source.text += "#line 1 " + std::to_string(index) + "\n";
+
+    std::string line;
+    std::string name;
+    unsigned int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (parseKeywords(line, source.keywords)) {
+            // Keep the line count so #line stays right.
+            source.text += '\n';
+            continue;
+        }
+        if (!parseInclude(line, name)) {
+            source.text += line;
+            source.text += '\n';
+            continue;
+        }
+        if (!appendFile(directoryOf(path) + name, source)) {
+            std::cerr << "  included from " << path << ":" << lineNumber << std::endl;
+            return false;
+        }
+        source.text += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(index) + "\n";
+    }
+    return true;
+}
+
+}
+
+bool loadShaderSource(const std::string& path, ShaderSource& source)
+{
+    source.text.clear();
+    source.files.clear();
+    source.keywords.clear();
+    return appendFile(path, source);
+}
+
+std::string applyDefines(const ShaderSource& source, const std::vector<std::string>& defines)
+{
+    if (defines.empty())
+        return source.text;
+
+    // #version has to stay the first statement; anything before it on its
+    // own lines is comments or blank.
+    size_t version = source.text.find("#version");
+    size_t insert = version == std::string::npos ? 0 : source.text.find('\n', version);
+    insert = insert == std::string::npos ? source.text.size() : insert + 1;
+    unsigned int nextLine = 1;
+    for (size_t i = 0; i < insert; i++)
+        if (source.text[i] == '\n')
+            nextLine++;
+
+    std::string block;
+    for (const std::string& define : defines)
+        block += "#define " + define + " 1\n";
+    block += "#line " + std::to_string(nextLine) + " 0\n";
+
+    std::string text = source.text;
+    text.insert(insert, block);
+    return text;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// GLSL text with #include "file" resolved. Included paths are relative to the
+// including file, and each file is pasted at most once. #line directives map
+// compiler messages back: source string number i is files[i].
+//
+// "#pragma keywords A B ..." lines declare the switches a shader can be
+// compiled with; they are collected in order and blanked out of the text.
+struct ShaderSource
+{
+	std::string text;
+	// Every file the text was assembled from, the requested one first.
+	std::vector<std::string> files;
+	std::vector<std::string> keywords;
+};
+
+// Returns false and prints the reason if a file cannot be read. files then
+// lists every file tried, ending with the one that failed.
+bool loadShaderSource(const std::string& path, ShaderSource& source);
+
+// The text with "#define NAME 1" for each of defines inserted after #version.
+std::string applyDefines(const ShaderSource& source, const std::vector<std::string>& defines);
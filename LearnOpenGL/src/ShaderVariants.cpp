@@ -0,0 +1,160 @@
+#include "ShaderVariants.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+size_t slotOf(uint64_t mask, size_t tableSize)
+{
+    // Fibonacci hashing; masks are often small and dense.
+    return (size_t)((mask * 0x9E3779B97F4A7C15ull) >> 32) & (tableSize - 1);
+}
+
+}
+
+ShaderVariants::ShaderVariants(ShaderBuildScheduler& scheduler, const VertexLayoutDesc& layout, uint32_t externalLocations)
+    : scheduler(scheduler), layout(&layout), externalLocations(externalLocations), hasSources(false),
+    table(8), count(0), reloadCount(0)
+{
+}
+
+ShaderVariants::~ShaderVariants()
+{
+    for (Variant& variant : table) {
+        if (variant.current)
+            scheduler.release(*variant.current);
+        if (variant.next)
+            scheduler.release(*variant.next);
+    }
+}
+
+void ShaderVariants::setSources(const ShaderSource& vertex, const ShaderSource& fragment)
+{
+    this->vertex = vertex;
+    this->fragment = fragment;
+    hasSources = true;
+
+    for (const std::vector<std::string>* declared : { &vertex.keywords, &fragment.keywords }) {
+        for (const std::string& name : *declared) {
+            if (std::find(keywords.begin(), keywords.end(), name) != keywords.end())
+                continue;
+            if (keywords.size() == MaxKeywords) {
+                std::cerr << "Too many shader keywords, ignoring " << name << std::endl;
+                continue;
+            }
+            keywords.push_back(name);
+        }
+    }
+
+    for (Variant& variant : table)
+        if (variant.used)
+            submit(variant);
+}
+
+void ShaderVariants::submit(Variant& variant)
+{
+    if (variant.next)
+        scheduler.release(*variant.next);
+
+    std::vector<std::string> defines;
+    for (size_t bit = 0; bit < keywords.size(); bit++)
+        if (variant.mask & (1ull << bit))
+            defines.push_back(keywords[bit]);
+    // Keyword bits are stable across reloads, so the mask names the variant.
+    const std::string name = vertex.files[0] + '|' + fragment.files[0] + '|' + std::to_string(variant.mask);
+    variant.next = &scheduler.submit(applyDefines(vertex, defines), applyDefines(fragment, defines), name);
+    variant.next->setExpectedLayout(*layout, externalLocations);
+}
+
+void ShaderVariants::update()
+{
+    for (Variant& variant : table) {
+        if (!variant.next || variant.next->getStatus() == ShaderProgram::Status::Pending)
+            continue;
+        if (variant.next->isLinked()) {
+            if (variant.current) {
+                scheduler.release(*variant.current);
+                reloadCount++;
+            }
+            variant.current = variant.next;
+        }
+        else {
+            std::cerr << "Shader variant 0x" << std::hex << variant.mask << std::dec
+                << " failed to build, keeping the previous program" << std::endl;
+            scheduler.release(*variant.next);
+        }
+        variant.next = nullptr;
+    }
+}
+
+uint64_t ShaderVariants::keyword(const char* name) const
+{
+    for (size_t bit = 0; bit < keywords.size(); bit++)
+        if (keywords[bit] == name)
+            return 1ull << bit;
+    std::cerr << "Unknown shader keyword " << name << std::endl;
+    return 0;
+}
+
+void ShaderVariants::grow()
+{
+    std::vector<Variant> old(table.size() * 2);
+    old.swap(table);
+    for (Variant& variant : old) {
+        if (!variant.used)
+            continue;
+        size_t slot = slotOf(variant.mask, table.size());
+        while (table[slot].used)
+            slot = (slot + 1) & (table.size() - 1);
+        table[slot] = variant;
+    }
+}
+
+ShaderVariants::Variant& ShaderVariants::insert(uint64_t mask)
+{
+    if ((count + 1) * 4 > table.size() * 3)
+        grow();
+    size_t slot = slotOf(mask, table.size());
+    while (table[slot].used)
+        slot = (slot + 1) & (table.size() - 1);
+    Variant& variant = table[slot];
+    variant.mask = mask;
+    variant.used = true;
+    count++;
+    if (hasSources)
+        submit(variant);
+    return variant;
+}
+
+void ShaderVariants::request(uint64_t mask)
+{
+    size_t tableMask = table.size() - 1;
+    for (size_t slot = slotOf(mask, table.size()); table[slot].used; slot = (slot + 1) & tableMask)
+        if (table[slot].mask == mask)
+            return;
+    insert(mask);
+}
+
+ShaderProgram& ShaderVariants::get(uint64_t mask, ShaderProgram& fallback)
+{
+    size_t tableMask = table.size() - 1;
+    for (size_t slot = slotOf(mask, table.size());; slot = (slot + 1) & tableMask) {
+        Variant& variant = table[slot];
+        if (!variant.used)
+            break;
+        if (variant.mask == mask)
+            return variant.current ? *variant.current : fallback;
+    }
+    Variant& variant = insert(mask);
+    return variant.current ? *variant.current : fallback;
+}
+
+unsigned int ShaderVariants::getVariantCount() const
+{
+    unsigned int live = 0;
+    for (const Variant& variant : table)
+        if (variant.used && variant.current)
+            live++;
+    return live;
+}
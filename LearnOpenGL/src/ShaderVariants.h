@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ShaderBuildScheduler.h"
+#include "ShaderProgram.h"
+#include "ShaderSource.h"
+#include "VertexLayout.h"
+
+// Every program compiled from one vertex + fragment source pair, one per
+// combination of keywords in use. Bit i of a variant mask enables the i-th
+// declared keyword (see ShaderSource), so the mask is a 64-bit key of the
+// define set that needs no hashing beyond a multiply for the table. Variants
+// are built on first request through the ShaderBuildScheduler; until one has
+// linked, get() returns the fallback.
+class ShaderVariants
+{
+private:
+	struct Variant
+	{
+		uint64_t mask = 0;
+		// Always a linked program or null.
+		ShaderProgram* current = nullptr;
+		// Build in flight, replacing current once it links.
+		ShaderProgram* next = nullptr;
+		bool used = false;
+	};
+	ShaderBuildScheduler& scheduler;
+	const VertexLayoutDesc* layout;
+	uint32_t externalLocations;
+	ShaderSource vertex;
+	ShaderSource fragment;
+	bool hasSources;
+	std::vector<std::string> keywords;
+	// Open addressing on the mask.
+	std::vector<Variant> table;
+	unsigned int count;
+	unsigned int reloadCount;
+
+	Variant& insert(uint64_t mask);
+	void grow();
+	void submit(Variant& variant);
+public:
+	static const unsigned int MaxKeywords = 64;
+
+	// Every variant is checked against layout when it links.
+	ShaderVariants(ShaderBuildScheduler& scheduler, const VertexLayoutDesc& layout, uint32_t externalLocations = 0);
+	~ShaderVariants();
+
+	ShaderVariants(const ShaderVariants&) = delete;
+	ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+	// Sets new sources and rebuilds every live variant; each keeps drawing
+	// with its previous program until the rebuild links. Keywords keep their
+	// bits across reloads, new ones are appended.
+	void setSources(const ShaderSource& vertex, const ShaderSource& fragment);
+	// Swaps in rebuilds that have finished. Call after the scheduler's poll().
+	void update();
+
+	// The mask bit of a declared keyword, 0 (with a warning) if unknown.
+	uint64_t keyword(const char* name) const;
+	// Starts building the variant for mask if it has not been requested yet.
+	void request(uint64_t mask);
+	// The variant for mask, or fallback while it is building.
+	ShaderProgram& get(uint64_t mask, ShaderProgram& fallback);
+
+	// Variants with a linked program; requests still building are not counted.
+	unsigned int getVariantCount() const;
+	inline unsigned int getReloadCount() const { return reloadCount; };
+};
@@ -0,0 +1,121 @@
+#include "StreamingVertexBuffer.h"
+#include "GLState.h"
+#include "DeletionQueue.h"
+
+#include <cstring>
+
+StreamingVertexBuffer::StreamingVertexBuffer(unsigned int sectionSize, Mode preferred)
+    : sectionSize(sectionSize), section(SectionCount - 1), writeOffset(0), mapping(nullptr),
+    mode(preferred), stalls(0)
+{
+    for (GLsync& fence : fences)
+        fence = nullptr;
+
+    if (mode == Mode::Persistent && !GLAD_GL_VERSION_4_4)
+        mode = Mode::Unsynchronized;
+
+    const GLsizeiptr size = (GLsizeiptr)sectionSize * SectionCount;
+    GLCall(glGenBuffers(1, &bufferID));
+    GLState::bindBuffer(GL_ARRAY_BUFFER, bufferID);
+    if (mode == Mode::Persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GLCall(glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags));
+        GLCall(mapping = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+    }
+    else {
+        GLCall(glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW));
+    }
+}
+
+StreamingVertexBuffer::~StreamingVertexBuffer()
+{
+    for (GLsync& fence : fences) {
+        if (fence) {
+            GLCall(glDeleteSync(fence));
+        }
+    }
+    if (mapping) {
+        GLState::bindBuffer(GL_ARRAY_BUFFER, bufferID);
+        GLCall(glUnmapBuffer(GL_ARRAY_BUFFER));
+    }
+    // Draws submitted this frame may still read the buffer.
+    DeletionQueue::deleteBuffer(bufferID);
+}
+
+void StreamingVertexBuffer::waitForSection(unsigned int index)
+{
+    GLsync fence = fences[index];
+    if (!fence)
+        return;
+
+    GLCall(GLenum result = glClientWaitSync(fence, 0, 0));
+    if (result == GL_TIMEOUT_EXPIRED) {
+        stalls++;
+        do {
+            GLCall(result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000));
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    GLCall(glDeleteSync(fence));
+    fences[index] = nullptr;
+}
+
+void StreamingVertexBuffer::beginFrame()
+{
+    section = (section + 1) % SectionCount;
+    writeOffset = 0;
+
+    if (mode == Mode::Orphaning) {
+        // The driver hands back fresh storage, so there is nothing to wait for.
+        GLState::bindBuffer(GL_ARRAY_BUFFER, bufferID);
+        GLCall(glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)sectionSize * SectionCount, nullptr, GL_STREAM_DRAW));
+        return;
+    }
+    waitForSection(section);
+}
+
+unsigned int StreamingVertexBuffer::write(const void* data, unsigned int size, unsigned int alignment)
+{
+    // Align relative to the whole buffer so offset / stride is exact.
+    unsigned int start = section * sectionSize;
+    unsigned int offset = (start + writeOffset + alignment - 1) / alignment * alignment;
+    if (offset + size > start + sectionSize)
+        return WriteFailed;
+
+    switch (mode) {
+    case Mode::Persistent:
+        std::memcpy(mapping + offset, data, size);
+        break;
+    case Mode::Unsynchronized: {
+        GLState::bindBuffer(GL_ARRAY_BUFFER, bufferID);
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+        GLCall(void* destination = glMapBufferRange(GL_ARRAY_BUFFER, offset, size, flags));
+        if (!destination)
+            return WriteFailed;
+        std::memcpy(destination, data, size);
+        GLCall(glUnmapBuffer(GL_ARRAY_BUFFER));
+        break;
+    }
+    case Mode::Orphaning:
+        GLState::bindBuffer(GL_ARRAY_BUFFER, bufferID);
+        GLCall(glBufferSubData(GL_ARRAY_BUFFER, offset, size, data));
+        break;
+    }
+
+    writeOffset = offset + size - start;
+    return offset;
+}
+
+void StreamingVertexBuffer::endFrame()
+{
+    if (mode == Mode::Orphaning)
+        return;
+    if (fences[section]) {
+        GLCall(glDeleteSync(fences[section]));
+    }
+    GLCall(fences[section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+}
+
+void StreamingVertexBuffer::bind()
+{
+    GLState::bindBuffer(GL_ARRAY_BUFFER, bufferID);
+}
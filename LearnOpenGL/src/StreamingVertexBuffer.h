@@ -0,0 +1,54 @@
+#pragma once
+#include "Application.h"
+
+// Vertex buffer for data rewritten every frame (particles, UI, debug lines).
+// The buffer is split into SectionCount sections used round robin, one per
+// frame, and each section is guarded by a fence so the CPU only waits if it
+// gets more than SectionCount - 1 frames ahead of the GPU.
+//
+// Depending on what the context supports, sections are written through:
+//   Persistent      a glBufferStorage mapping that stays mapped (GL 4.4)
+//   Unsynchronized  glMapBufferRange with GL_MAP_UNSYNCHRONIZED_BIT per write
+//   Orphaning       glBufferData(nullptr) each frame and glBufferSubData writes
+class StreamingVertexBuffer
+{
+public:
+	enum class Mode { Persistent, Unsynchronized, Orphaning };
+	static const unsigned int SectionCount = 3;
+	static const unsigned int WriteFailed = 0xFFFFFFFFu;
+private:
+	unsigned int bufferID;
+	unsigned int sectionSize;
+	unsigned int section;
+	unsigned int writeOffset;
+	unsigned char* mapping;
+	GLsync fences[SectionCount];
+	Mode mode;
+	unsigned int stalls;
+
+	void waitForSection(unsigned int index);
+public:
+	// sectionSize is the most data that can be written in one frame.
+	StreamingVertexBuffer(unsigned int sectionSize, Mode preferred = Mode::Persistent);
+	~StreamingVertexBuffer();
+
+	StreamingVertexBuffer(const StreamingVertexBuffer&) = delete;
+	StreamingVertexBuffer& operator=(const StreamingVertexBuffer&) = delete;
+
+	// Moves to the next section, waiting for the GPU to release it if needed.
+	void beginFrame();
+	// Copies data into the current section and returns its byte offset in the
+	// buffer, or WriteFailed if the section is full. The offset is aligned to
+	// alignment, so passing the vertex stride gives offset / stride as the
+	// first vertex for glDrawArrays or the base vertex for glDrawElementsBaseVertex.
+	unsigned int write(const void* data, unsigned int size, unsigned int alignment = 4);
+	// Fences the section after the draws reading it have been submitted.
+	void endFrame();
+
+	void bind();
+	inline unsigned int getId() const { return bufferID; };
+	inline Mode getMode() const { return mode; };
+	inline unsigned int getSectionSize() const { return sectionSize; };
+	// Number of beginFrame() calls that had to wait on the GPU.
+	inline unsigned int getStallCount() const { return stalls; };
+};
@@ -0,0 +1,294 @@
+#include "TlsfAllocator.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+// Index of the lowest set bit. x must not be zero.
+uint32_t lowestBit(uint32_t x)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return index;
+#else
+    return (uint32_t)__builtin_ctz(x);
+#endif
+}
+
+// Index of the highest set bit. x must not be zero.
+uint32_t highestBit(uint32_t x)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse(&index, x);
+    return index;
+#else
+    return 31 - (uint32_t)__builtin_clz(x);
+#endif
+}
+
+}
+
+TlsfAllocator::TlsfAllocator(uint32_t capacity, uint32_t granularity)
+    : firstLevelBitmap(0), granularity(granularity), used(0), usedBlocks(0)
+{
+    this->capacity = capacity / granularity * granularity;
+    for (uint32_t fl = 0; fl < FirstLevelCount; fl++) {
+        secondLevelBitmaps[fl] = 0;
+        for (uint32_t sl = 0; sl < SecondLevelCount; sl++)
+            heads[fl][sl] = InvalidBlock;
+    }
+
+    uint32_t index = newRecord();
+    Block& block = blocks[index];
+    block.offset = 0;
+    block.size = this->capacity;
+    lastBlock = index;
+    if (block.size)
+        insertFree(index);
+}
+
+uint32_t TlsfAllocator::newRecord()
+{
+    uint32_t index;
+    if (!unusedRecords.empty()) {
+        index = unusedRecords.back();
+        unusedRecords.pop_back();
+    }
+    else {
+        index = (uint32_t)blocks.size();
+        blocks.emplace_back();
+    }
+    Block& block = blocks[index];
+    block.offset = 0;
+    block.size = 0;
+    block.prevPhysical = InvalidBlock;
+    block.nextPhysical = InvalidBlock;
+    block.prevFree = InvalidBlock;
+    block.nextFree = InvalidBlock;
+    block.userData = 0;
+    block.free = false;
+    return index;
+}
+
+void TlsfAllocator::releaseRecord(uint32_t index)
+{
+    unusedRecords.push_back(index);
+}
+
+void TlsfAllocator::mapping(uint32_t units, uint32_t& firstLevel, uint32_t& secondLevel) const
+{
+    if (units < SecondLevelCount) {
+        firstLevel = 0;
+        secondLevel = units;
+        return;
+    }
+    uint32_t top = highestBit(units);
+    firstLevel = top - SecondLevelLog2 + 1;
+    secondLevel = (units >> (top - SecondLevelLog2)) ^ SecondLevelCount;
+}
+
+void TlsfAllocator::insertFree(uint32_t index)
+{
+    Block& block = blocks[index];
+    uint32_t fl, sl;
+    mapping(block.size / granularity, fl, sl);
+
+    block.free = true;
+    block.prevFree = InvalidBlock;
+    block.nextFree = heads[fl][sl];
+    if (block.nextFree != InvalidBlock)
+        blocks[block.nextFree].prevFree = index;
+    heads[fl][sl] = index;
+    firstLevelBitmap |= 1u << fl;
+    secondLevelBitmaps[fl] |= 1u << sl;
+}
+
+void TlsfAllocator::removeFree(uint32_t index)
+{
+    Block& block = blocks[index];
+    uint32_t fl, sl;
+    mapping(block.size / granularity, fl, sl);
+
+    if (block.prevFree != InvalidBlock)
+        blocks[block.prevFree].nextFree = block.nextFree;
+    else
+        heads[fl][sl] = block.nextFree;
+    if (block.nextFree != InvalidBlock)
+        blocks[block.nextFree].prevFree = block.prevFree;
+
+    if (heads[fl][sl] == InvalidBlock) {
+        secondLevelBitmaps[fl] &= ~(1u << sl);
+        if (!secondLevelBitmaps[fl])
+            firstLevelBitmap &= ~(1u << fl);
+    }
+    block.free = false;
+    block.prevFree = InvalidBlock;
+    block.nextFree = InvalidBlock;
+}
+
+uint32_t TlsfAllocator::findFree(uint32_t units) const
+{
+    // Round up to the next list boundary so any block in the list found fits.
+    if (units >= SecondLevelCount) {
+        uint32_t round = (1u << (highestBit(units) - SecondLevelLog2)) - 1;
+        if (units > 0xFFFFFFFFu - round)
+            return InvalidBlock;
+        units += round;
+    }
+    uint32_t fl, sl;
+    mapping(units, fl, sl);
+    if (fl >= FirstLevelCount)
+        return InvalidBlock;
+
+    uint32_t secondMap = secondLevelBitmaps[fl] & (~0u << sl);
+    if (!secondMap) {
+        uint32_t firstMap = fl + 1 < FirstLevelCount ? firstLevelBitmap & (~0u << (fl + 1)) : 0;
+        if (!firstMap)
+            return InvalidBlock;
+        fl = lowestBit(firstMap);
+        secondMap = secondLevelBitmaps[fl];
+    }
+    sl = lowestBit(secondMap);
+    return heads[fl][sl];
+}
+
+void TlsfAllocator::takeBlock(uint32_t index, uint32_t units)
+{
+    removeFree(index);
+    uint32_t size = units * granularity;
+    if (blocks[index].size > size) {
+        uint32_t rest = newRecord();
+        Block& block = blocks[index];
+        Block& remainder = blocks[rest];
+        remainder.offset = block.offset + size;
+        remainder.size = block.size - size;
+        remainder.prevPhysical = index;
+        remainder.nextPhysical = block.nextPhysical;
+        if (remainder.nextPhysical != InvalidBlock)
+            blocks[remainder.nextPhysical].prevPhysical = rest;
+        else
+            lastBlock = rest;
+        block.nextPhysical = rest;
+        block.size = size;
+        insertFree(rest);
+    }
+    used += blocks[index].size;
+    usedBlocks++;
+}
+
+uint32_t TlsfAllocator::allocate(uint32_t size)
+{
+    if (size == 0 || size > capacity)
+        return InvalidBlock;
+    uint32_t units = (size + granularity - 1) / granularity;
+    uint32_t index = findFree(units);
+    if (index == InvalidBlock)
+        return InvalidBlock;
+    takeBlock(index, units);
+    return index;
+}
+
+void TlsfAllocator::free(uint32_t index)
+{
+    Block& block = blocks[index];
+    if (block.free)
+        return;
+    used -= block.size;
+    usedBlocks--;
+    block.userData = 0;
+
+    uint32_t next = block.nextPhysical;
+    if (next != InvalidBlock && blocks[next].free) {
+        removeFree(next);
+        Block& absorbed = blocks[next];
+        blocks[index].size += absorbed.size;
+        blocks[index].nextPhysical = absorbed.nextPhysical;
+        if (absorbed.nextPhysical != InvalidBlock)
+            blocks[absorbed.nextPhysical].prevPhysical = index;
+        else
+            lastBlock = index;
+        releaseRecord(next);
+    }
+
+    uint32_t prev = blocks[index].prevPhysical;
+    if (prev != InvalidBlock && blocks[prev].free) {
+        removeFree(prev);
+        Block& absorbed = blocks[index];
+        blocks[prev].size += absorbed.size;
+        blocks[prev].nextPhysical = absorbed.nextPhysical;
+        if (absorbed.nextPhysical != InvalidBlock)
+            blocks[absorbed.nextPhysical].prevPhysical = prev;
+        else
+            lastBlock = prev;
+        releaseRecord(index);
+        index = prev;
+    }
+
+    insertFree(index);
+}
+
+uint32_t TlsfAllocator::findLowestFree(uint32_t size, uint32_t limit) const
+{
+    uint32_t rounded = (size + granularity - 1) / granularity * granularity;
+    // Walk back from the end to the first block, then forward.
+    uint32_t index = lastBlock;
+    while (index != InvalidBlock && blocks[index].prevPhysical != InvalidBlock)
+        index = blocks[index].prevPhysical;
+
+    for (; index != InvalidBlock && blocks[index].offset < limit; index = blocks[index].nextPhysical) {
+        if (blocks[index].free && blocks[index].size >= rounded)
+            return index;
+    }
+    return InvalidBlock;
+}
+
+uint32_t TlsfAllocator::allocateFrom(uint32_t freeBlock, uint32_t size)
+{
+    uint32_t units = (size + granularity - 1) / granularity;
+    if (!blocks[freeBlock].free || blocks[freeBlock].size < units * granularity)
+        return InvalidBlock;
+    takeBlock(freeBlock, units);
+    return freeBlock;
+}
+
+uint32_t TlsfAllocator::getLastUsed() const
+{
+    uint32_t index = lastBlock;
+    while (index != InvalidBlock && blocks[index].free)
+        index = blocks[index].prevPhysical;
+    return index;
+}
+
+uint32_t TlsfAllocator::getPreviousUsed(uint32_t block) const
+{
+    uint32_t index = blocks[block].prevPhysical;
+    while (index != InvalidBlock && blocks[index].free)
+        index = blocks[index].prevPhysical;
+    return index;
+}
+
+TlsfStats TlsfAllocator::getStats() const
+{
+    TlsfStats stats;
+    stats.capacity = capacity;
+    stats.used = used;
+    stats.free = capacity - used;
+    stats.usedBlocks = usedBlocks;
+
+    for (uint32_t fl = 0; fl < FirstLevelCount; fl++) {
+        for (uint32_t sl = 0; sl < SecondLevelCount; sl++) {
+            for (uint32_t index = heads[fl][sl]; index != InvalidBlock; index = blocks[index].nextFree) {
+                stats.freeBlocks++;
+                if (blocks[index].size > stats.largestFree)
+                    stats.largestFree = blocks[index].size;
+            }
+        }
+    }
+    if (stats.free)
+        stats.fragmentation = 1.0f - (float)stats.largestFree / (float)stats.free;
+    return stats;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+struct TlsfStats
+{
+	uint32_t capacity = 0;
+	uint32_t used = 0;
+	uint32_t free = 0;
+	uint32_t largestFree = 0;
+	uint32_t usedBlocks = 0;
+	uint32_t freeBlocks = 0;
+	// 1 - largestFree / free: 0 when all free space is one block.
+	float fragmentation = 0.0f;
+};
+
+// Two-level segregated fit allocator over an abstract range [0, capacity).
+// It only hands out offsets; the memory itself lives elsewhere (a GL buffer).
+// Allocation and free are O(1), and freed blocks are merged with free
+// neighbours straight away.
+//
+// Sizes are rounded up to the granularity, which is also the alignment of
+// every returned offset.
+class TlsfAllocator
+{
+public:
+	static const uint32_t InvalidBlock = 0xFFFFFFFFu;
+private:
+	static const uint32_t SecondLevelLog2 = 4;
+	static const uint32_t SecondLevelCount = 1 << SecondLevelLog2;
+	static const uint32_t FirstLevelCount = 32;
+
+	struct Block
+	{
+		uint32_t offset;
+		uint32_t size;
+		uint32_t prevPhysical;
+		uint32_t nextPhysical;
+		uint32_t prevFree;
+		uint32_t nextFree;
+		uint32_t userData;
+		bool free;
+	};
+
+	std::vector<Block> blocks;
+	std::vector<uint32_t> unusedRecords;
+	uint32_t heads[FirstLevelCount][SecondLevelCount];
+	uint32_t firstLevelBitmap;
+	uint32_t secondLevelBitmaps[FirstLevelCount];
+	uint32_t capacity;
+	uint32_t granularity;
+	uint32_t used;
+	uint32_t usedBlocks;
+	uint32_t lastBlock;
+
+	uint32_t newRecord();
+	void releaseRecord(uint32_t index);
+	void mapping(uint32_t units, uint32_t& firstLevel, uint32_t& secondLevel) const;
+	void insertFree(uint32_t index);
+	void removeFree(uint32_t index);
+	uint32_t findFree(uint32_t units) const;
+	// Marks a free block used, splitting off any remainder past units.
+	void takeBlock(uint32_t index, uint32_t units);
+public:
+	TlsfAllocator(uint32_t capacity, uint32_t granularity = 16);
+
+	// Returns InvalidBlock if no free block is large enough.
+	uint32_t allocate(uint32_t size);
+	void free(uint32_t block);
+
+	// Lowest-addressed free block that can hold size bytes and starts before
+	// limit. Linear in the number of blocks; meant for compaction.
+	uint32_t findLowestFree(uint32_t size, uint32_t limit) const;
+	// Allocates from the front of a specific free block.
+	uint32_t allocateFrom(uint32_t freeBlock, uint32_t size);
+	// Used blocks in descending address order, for compaction.
+	uint32_t getLastUsed() const;
+	uint32_t getPreviousUsed(uint32_t block) const;
+
+	inline uint32_t getOffset(uint32_t block) const { return blocks[block].offset; };
+	inline uint32_t getSize(uint32_t block) const { return blocks[block].size; };
+	inline uint32_t getUserData(uint32_t block) const { return blocks[block].userData; };
+	inline void setUserData(uint32_t block, uint32_t value) { blocks[block].userData = value; };
+	inline uint32_t getCapacity() const { return capacity; };
+
+	TlsfStats getStats() const;
+};
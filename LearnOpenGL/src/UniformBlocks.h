@@ -0,0 +1,45 @@
+#pragma once
+#include "UniformLayout.h"
+
+// Uniform blocks shared by every program, declared in GLSL by
+// res/shaders/Constants.glsl. ShaderProgram assigns these binding points when
+// a program links.
+enum UniformBlockBinding : unsigned int
+{
+	FrameBlockBinding = 0,
+	ObjectBlockBinding = 1,
+};
+
+struct UniformBlockInfo
+{
+	const char* name;
+	unsigned int binding;
+};
+
+static const UniformBlockInfo uniformBlocks[] = {
+	{ "FrameConstants", FrameBlockBinding },
+	{ "ObjectConstants", ObjectBlockBinding },
+};
+
+// Written once per frame.
+struct FrameConstants
+{
+	UniformMat4 viewProjection;
+	UniformVec4 cameraPosition;
+	float time;
+	float padding[3];
+};
+UNIFORM_BLOCK(FrameConstants, 96);
+UNIFORM_OFFSET(FrameConstants, viewProjection, 0);
+UNIFORM_OFFSET(FrameConstants, cameraPosition, 64);
+UNIFORM_OFFSET(FrameConstants, time, 80);
+
+// Written once per object per frame.
+struct ObjectConstants
+{
+	UniformMat4 model;
+	UniformVec4 colour;
+};
+UNIFORM_BLOCK(ObjectConstants, 80);
+UNIFORM_OFFSET(ObjectConstants, model, 0);
+UNIFORM_OFFSET(ObjectConstants, colour, 64);
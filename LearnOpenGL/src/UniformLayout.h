@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+
+// C++ mirrors of GLSL block member types, aligned the way std140 and std430
+// lay them out: float 4, vec2 8, vec4 16, mat4 as four vec4 columns. The two
+// layouts differ only in array and struct strides, which std140 rounds up to
+// 16 bytes; wrap such elements in Std140Element.
+//
+// vec3 is left out on purpose. std140 packs a following scalar into its
+// fourth component, which an aligned C++ type cannot express; use a vec4.
+struct alignas(8) UniformVec2
+{
+	float x, y;
+};
+
+struct alignas(16) UniformVec4
+{
+	float x, y, z, w;
+};
+
+// Column-major, like GLSL.
+struct alignas(16) UniformMat4
+{
+	float m[16];
+};
+
+// One element of a std140 array of scalars or vec2s.
+template<typename T>
+struct alignas(16) Std140Element
+{
+	T value;
+};
+
+// Fail the build when a block struct and its GLSL declaration disagree.
+// Offsets are spelled out as the GLSL layout rules give them, so reordering
+// or retyping a member without updating the shader does not compile.
+#define UNIFORM_BLOCK(Block, size) \
+	static_assert(std::is_standard_layout<Block>::value, #Block " must be standard layout"); \
+	static_assert(sizeof(Block) == (size), #Block " is not " #size " bytes"); \
+	static_assert(sizeof(Block) % 16 == 0, #Block " must be padded to 16 bytes")
+#define UNIFORM_OFFSET(Block, member, offset) \
+	static_assert(offsetof(Block, member) == (offset), #Block "::" #member " is not at offset " #offset)
@@ -0,0 +1,119 @@
+#include "UniformRing.h"
+#include "GLState.h"
+#include "DeletionQueue.h"
+#include "CpuProfiler.h"
+
+#include <cstring>
+#include <utility>
+
+namespace {
+
+unsigned int alignUp(unsigned int value, unsigned int alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+UniformRing::UniformRing(unsigned int frameCapacity)
+    : bufferID(0), frameCapacity(0), alignment(256), frameIndex(0), started(false), stagingBytes(0),
+    stagingCapacity(0), stalls(0)
+{
+    GLint offsetAlignment = 0;
+    GLCall(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment));
+    if (offsetAlignment > 0)
+        alignment = (unsigned int)offsetAlignment;
+    for (GLsync& fence : fences)
+        fence = nullptr;
+
+    this->frameCapacity = alignUp(frameCapacity > 0 ? frameCapacity : 1, alignment);
+    stagingCapacity = this->frameCapacity;
+    staging.reset(new unsigned char[stagingCapacity]);
+    GLCall(glGenBuffers(1, &bufferID));
+    allocateStorage();
+}
+
+UniformRing::~UniformRing()
+{
+    for (GLsync fence : fences)
+        if (fence)
+            glDeleteSync(fence);
+    DeletionQueue::deleteBuffer(bufferID);
+}
+
+void UniformRing::allocateStorage()
+{
+    // New storage is not aliased by any draw in flight, so the old fences no
+    // longer matter.
+    for (GLsync& fence : fences) {
+        if (fence)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+    GLState::bindBuffer(GL_UNIFORM_BUFFER, bufferID);
+    GLCall(glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr)frameCapacity * FrameCount, nullptr, GL_STREAM_DRAW));
+}
+
+void UniformRing::beginFrame()
+{
+    if (started) {
+        fences[frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frameIndex = (frameIndex + 1) % FrameCount;
+    }
+    started = true;
+
+    GLsync& fence = fences[frameIndex];
+    if (fence) {
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED) {
+            stalls++;
+            GLCall(glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED));
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    stagingBytes = 0;
+}
+
+unsigned int UniformRing::push(const void* data, unsigned int size)
+{
+    unsigned int offset = alignUp(stagingBytes, alignment);
+    if (offset + size > stagingCapacity) {
+        while (stagingCapacity < offset + size)
+            stagingCapacity *= 2;
+        std::unique_ptr<unsigned char[]> grown(new unsigned char[stagingCapacity]);
+        if (stagingBytes)
+            std::memcpy(grown.get(), staging.get(), stagingBytes);
+        staging = std::move(grown);
+    }
+    stagingBytes = offset + size;
+    if (data)
+        std::memcpy(staging.get() + offset, data, size);
+    return offset;
+}
+
+void UniformRing::upload()
+{
+    PROFILE_ZONE("UniformRing::upload");
+    if (!stagingBytes)
+        return;
+    if (stagingBytes > frameCapacity) {
+        while (frameCapacity < stagingBytes)
+            frameCapacity *= 2;
+        allocateStorage();
+    }
+
+    GLState::bindBuffer(GL_UNIFORM_BUFFER, bufferID);
+    // The fence in beginFrame() already guarantees the region is idle.
+    GLCall(void* mapped = glMapBufferRange(GL_UNIFORM_BUFFER, getFrameBase(), (GLsizeiptr)stagingBytes,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+    if (!mapped)
+        return;
+    std::memcpy(mapped, staging.get(), stagingBytes);
+    GLCall(glUnmapBuffer(GL_UNIFORM_BUFFER));
+}
+
+void UniformRing::bind(unsigned int binding, unsigned int offset, unsigned int size)
+{
+    GLState::bindUniformBufferRange(binding, bufferID, getFrameBase() + offset, size);
+}
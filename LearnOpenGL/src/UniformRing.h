@@ -0,0 +1,76 @@
+#pragma once
+#include <memory>
+
+#include "Application.h"
+
+// Per-frame uniform data in one GL_UNIFORM_BUFFER split into FrameCount
+// regions. A frame's blocks are gathered in a CPU staging area, copied into
+// that frame's region with a single memcpy, and bound per draw with
+// glBindBufferRange instead of glUniform* calls. Each region is fenced when
+// the next frame begins, so it is only rewritten once the GPU is done with it.
+//
+// reserve() sets aside part of the staging area for other threads to fill, so
+// CommandLists recorded on workers write their blocks in place.
+class UniformRing
+{
+public:
+	static const unsigned int FrameCount = 3;
+private:
+	unsigned int bufferID;
+	unsigned int frameCapacity;
+	unsigned int alignment;
+	unsigned int frameIndex;
+	bool started;
+	// Grown by hand so reserved ranges are not zeroed before they are written.
+	std::unique_ptr<unsigned char[]> staging;
+	unsigned int stagingBytes;
+	unsigned int stagingCapacity;
+	GLsync fences[FrameCount];
+	unsigned int stalls;
+
+	void allocateStorage();
+	inline unsigned int getFrameBase() const { return frameIndex * frameCapacity; };
+public:
+	UniformRing(unsigned int frameCapacity = 64 * 1024);
+	~UniformRing();
+
+	UniformRing(const UniformRing&) = delete;
+	UniformRing& operator=(const UniformRing&) = delete;
+
+	// Fences the previous frame's region and moves to the next one, waiting
+	// if the GPU is still reading it. Call before the first push of a frame.
+	void beginFrame();
+	// Appends a block to this frame's staging area and returns its offset,
+	// aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+	unsigned int push(const void* data, unsigned int size);
+	template<typename T>
+	inline unsigned int push(const T& block) { return push(&block, sizeof(T)); };
+	// Reserves a block to fill in place. The pointer is valid until the next push.
+	template<typename T>
+	T* allocate(unsigned int& offset);
+	// Reserves size bytes, aligned like push(), and returns their offset. Any
+	// thread may fill them through getStagingData() before upload(), as long
+	// as no push or reserve moves the staging area meanwhile.
+	inline unsigned int reserve(unsigned int size) { return push(nullptr, size); };
+	inline unsigned char* getStagingData(unsigned int offset) { return staging.get() + offset; };
+	// Copies the staging area into this frame's region. Call after the last
+	// push and before drawing; the region grows if the frame outgrew it.
+	void upload();
+	// Binds size bytes at offset, as returned by push(), to a block binding.
+	void bind(unsigned int binding, unsigned int offset, unsigned int size);
+	template<typename T>
+	inline void bind(unsigned int binding, unsigned int offset) { bind(binding, offset, sizeof(T)); };
+
+	inline unsigned int getId() const { return bufferID; };
+	inline unsigned int getAlignment() const { return alignment; };
+	inline unsigned int getFrameBytes() const { return stagingBytes; };
+	// Frames that had to wait for the GPU in beginFrame().
+	inline unsigned int getStallCount() const { return stalls; };
+};
+
+template<typename T>
+T* UniformRing::allocate(unsigned int& offset)
+{
+	offset = push(nullptr, sizeof(T));
+	return reinterpret_cast<T*>(staging.get() + offset);
+}
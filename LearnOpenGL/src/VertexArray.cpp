@@ -1,18 +1,41 @@
 #include "VertexArray.h"
 #include "Application.h"
+#include "GLState.h"
+#include "DeletionQueue.h"
 
 VertexArray::VertexArray()
 {
 	GLCall(glGenVertexArrays(1, &arrayID));
-	GLCall(glBindVertexArray(arrayID));
+	GLState::bindVertexArray(arrayID);
+}
+
+VertexArray::~VertexArray()
+{
+	DeletionQueue::deleteVertexArray(arrayID);
+}
+
+VertexArray::VertexArray(VertexArray&& other)
+	: arrayID(other.arrayID)
+{
+	other.arrayID = 0;
+}
+
+VertexArray& VertexArray::operator=(VertexArray&& other)
+{
+	if (this != &other) {
+		DeletionQueue::deleteVertexArray(arrayID);
+		arrayID = other.arrayID;
+		other.arrayID = 0;
+	}
+	return *this;
 }
 
 void VertexArray::bind()
 {
-	GLCall(glBindVertexArray(arrayID));
+	GLState::bindVertexArray(arrayID);
 }
 
 void VertexArray::unbind()
 {
-	GLCall(glBindVertexArray(0));
+	GLState::bindVertexArray(0);
 }
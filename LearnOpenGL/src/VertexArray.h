@@ -5,10 +5,15 @@ private:
 	unsigned int arrayID;
 public:
 	VertexArray();
-	~VertexArray() = default;
+	// Hands the name to the DeletionQueue.
+	~VertexArray();
+
+	VertexArray(const VertexArray&) = delete;
+	VertexArray& operator=(const VertexArray&) = delete;
+	VertexArray(VertexArray&& other);
+	VertexArray& operator=(VertexArray&& other);
 
 	void bind();
 	void unbind();
 	inline unsigned int getId() { return arrayID; };
 };
-
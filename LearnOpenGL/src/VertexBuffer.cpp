@@ -1,19 +1,64 @@
 #include "VertexBuffer.h"
 #include "Application.h"
+#include "GLState.h"
+#include "DeletionQueue.h"
 
 VertexBuffer::VertexBuffer(const void* data, unsigned int size)
+    : arena(nullptr), allocation(BufferArena::InvalidHandle)
 {
     GLCall(glGenBuffers(1, &bufferID));
-    GLCall(glBindBuffer(GL_ARRAY_BUFFER, bufferID));
+    GLState::bindBuffer(GL_ARRAY_BUFFER, bufferID);
     GLCall(glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW));
 }
 
+VertexBuffer::VertexBuffer(BufferArena* arena, const void* data, unsigned int size, unsigned int alignment)
+    : bufferID(0), arena(arena)
+{
+    allocation = arena->allocate(size, alignment, data);
+    ASSERT(allocation != BufferArena::InvalidHandle);
+}
+
+VertexBuffer::~VertexBuffer()
+{
+    release();
+}
+
+void VertexBuffer::release()
+{
+    if (arena)
+        DeletionQueue::freeArenaSlice(arena, allocation);
+    else
+        DeletionQueue::deleteBuffer(bufferID);
+}
+
+VertexBuffer::VertexBuffer(VertexBuffer&& other)
+    : bufferID(other.bufferID), arena(other.arena), allocation(other.allocation)
+{
+    other.bufferID = 0;
+    other.arena = nullptr;
+    other.allocation = BufferArena::InvalidHandle;
+}
+
+VertexBuffer& VertexBuffer::operator=(VertexBuffer&& other)
+{
+    if (this != &other) {
+        release();
+        bufferID = other.bufferID;
+        arena = other.arena;
+        allocation = other.allocation;
+        other.bufferID = 0;
+        other.arena = nullptr;
+        other.allocation = BufferArena::InvalidHandle;
+    }
+    return *this;
+}
+
 void VertexBuffer::bind()
 {
-    GLCall(glBindBuffer(GL_ARRAY_BUFFER, bufferID));
+    GLState::bindBuffer(GL_ARRAY_BUFFER, getId());
 }
 
 void VertexBuffer::unbind()
 {
-    GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
 }
@@ -1,14 +1,31 @@
 #pragma once
+#include "BufferArena.h"
+
 class VertexBuffer
 {
 private:
 	unsigned int bufferID;
+	BufferArena* arena;
+	unsigned int allocation;
+
+	void release();
 public:
 	VertexBuffer(const void* data, unsigned int size);
-	~VertexBuffer() = default;
+	// Sub-allocates from a shared arena instead of creating a buffer object.
+	// Pass the vertex stride as alignment so getOffset() / stride is a whole
+	// base vertex.
+	VertexBuffer(BufferArena* arena, const void* data, unsigned int size, unsigned int alignment);
+	// Hands the buffer or arena slice to the DeletionQueue.
+	~VertexBuffer();
+
+	VertexBuffer(const VertexBuffer&) = delete;
+	VertexBuffer& operator=(const VertexBuffer&) = delete;
+	VertexBuffer(VertexBuffer&& other);
+	VertexBuffer& operator=(VertexBuffer&& other);
 
 	void bind();
 	void unbind();
-	inline unsigned int getId() { return bufferID; };
+	inline unsigned int getId() { return arena ? arena->getBufferId(allocation) : bufferID; };
+	// Byte offset of this buffer's data within getId(); 0 unless arena backed.
+	inline unsigned int getOffset() { return arena ? arena->getOffset(allocation) : 0; };
 };
-
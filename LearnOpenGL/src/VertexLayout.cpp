@@ -0,0 +1,129 @@
+#include "VertexLayout.h"
+
+#include <cmath>
+#include <cstring>
+
+uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (((bits >> 23) & 0xFF) == 0xFF)
+        return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    if (exponent >= 31)
+        return (uint16_t)(sign | 0x7C00);
+    if (exponent <= 0) {
+        if (exponent < -10)
+            return (uint16_t)sign;
+        // Denormal: shift in the implicit bit and round to nearest.
+        mantissa |= 0x800000;
+        uint32_t shift = (uint32_t)(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1)
+            half++;
+        return (uint16_t)(sign | half);
+    }
+
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    // Round to nearest; a carry into the exponent is still correct.
+    if (mantissa & 0x1000)
+        half++;
+    return (uint16_t)half;
+}
+
+namespace {
+
+float clamp(float value, float low, float high)
+{
+    return value < low ? low : (value > high ? high : value);
+}
+
+int16_t toSnorm16(float value)
+{
+    return (int16_t)std::lround(clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+uint8_t toUnorm8(float value)
+{
+    return (uint8_t)std::lround(clamp(value, 0.0f, 1.0f) * 255.0f);
+}
+
+template<typename T>
+void store(unsigned char* out, const T* values, unsigned int count)
+{
+    std::memcpy(out, values, count * sizeof(T));
+}
+
+}
+
+void VertexFormat::Float2::pack(const float* in, unsigned char* out)
+{
+    store(out, in, 2);
+}
+
+void VertexFormat::Float3::pack(const float* in, unsigned char* out)
+{
+    store(out, in, 3);
+}
+
+void VertexFormat::Float4::pack(const float* in, unsigned char* out)
+{
+    store(out, in, 4);
+}
+
+void VertexFormat::Half3::pack(const float* in, unsigned char* out)
+{
+    uint16_t values[3] = { floatToHalf(in[0]), floatToHalf(in[1]), floatToHalf(in[2]) };
+    store(out, values, 3);
+}
+
+void VertexFormat::Half4::pack(const float* in, unsigned char* out)
+{
+    uint16_t values[4] = { floatToHalf(in[0]), floatToHalf(in[1]), floatToHalf(in[2]), floatToHalf(in[3]) };
+    store(out, values, 4);
+}
+
+void VertexFormat::Snorm16x3::pack(const float* in, unsigned char* out)
+{
+    int16_t values[3] = { toSnorm16(in[0]), toSnorm16(in[1]), toSnorm16(in[2]) };
+    store(out, values, 3);
+}
+
+void VertexFormat::Unorm8x4::pack(const float* in, unsigned char* out)
+{
+    uint8_t values[4] = { toUnorm8(in[0]), toUnorm8(in[1]), toUnorm8(in[2]), toUnorm8(in[3]) };
+    store(out, values, 4);
+}
+
+void VertexFormat::Snorm1010102::pack(const float* in, unsigned char* out)
+{
+    uint32_t x = (uint32_t)std::lround(clamp(in[0], -1.0f, 1.0f) * 511.0f) & 0x3FF;
+    uint32_t y = (uint32_t)std::lround(clamp(in[1], -1.0f, 1.0f) * 511.0f) & 0x3FF;
+    uint32_t z = (uint32_t)std::lround(clamp(in[2], -1.0f, 1.0f) * 511.0f) & 0x3FF;
+    uint32_t w = (uint32_t)std::lround(clamp(in[3], -1.0f, 1.0f)) & 0x3;
+    uint32_t packed = x | (y << 10) | (z << 20) | (w << 30);
+    store(out, &packed, 1);
+}
+
+void VertexFormat::Unorm1010102::pack(const float* in, unsigned char* out)
+{
+    uint32_t x = (uint32_t)std::lround(clamp(in[0], 0.0f, 1.0f) * 1023.0f);
+    uint32_t y = (uint32_t)std::lround(clamp(in[1], 0.0f, 1.0f) * 1023.0f);
+    uint32_t z = (uint32_t)std::lround(clamp(in[2], 0.0f, 1.0f) * 1023.0f);
+    uint32_t w = (uint32_t)std::lround(clamp(in[3], 0.0f, 1.0f) * 3.0f);
+    uint32_t packed = x | (y << 10) | (z << 20) | (w << 30);
+    store(out, &packed, 1);
+}
+
+void VertexLayoutDesc::apply(unsigned int baseOffset) const
+{
+    for (unsigned int i = 0; i < count; i++) {
+        const VertexAttributeDesc& attribute = attributes[i];
+        GLCall(glVertexAttribPointer(attribute.location, attribute.components, attribute.type, attribute.normalized,
+            stride, (const void*)(uintptr_t)(baseOffset + attribute.offset)));
+        GLCall(glEnableVertexAttribArray(attribute.location));
+    }
+}
@@ -0,0 +1,244 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Application.h"
+
+uint16_t floatToHalf(float value);
+
+// Attribute formats for VertexLayout. Each describes how the attribute is
+// stored (size in bytes including padding, GL type, component count) and how
+// to pack it from floats. "inputs" is how many floats pack() consumes.
+namespace VertexFormat {
+
+struct Float2
+{
+	static const unsigned int size = 8, inputs = 2;
+	static const GLint components = 2;
+	static const GLenum type = GL_FLOAT;
+	static const GLboolean normalized = GL_FALSE;
+	static void pack(const float* in, unsigned char* out);
+};
+
+struct Float3
+{
+	static const unsigned int size = 12, inputs = 3;
+	static const GLint components = 3;
+	static const GLenum type = GL_FLOAT;
+	static const GLboolean normalized = GL_FALSE;
+	static void pack(const float* in, unsigned char* out);
+};
+
+struct Float4
+{
+	static const unsigned int size = 16, inputs = 4;
+	static const GLint components = 4;
+	static const GLenum type = GL_FLOAT;
+	static const GLboolean normalized = GL_FALSE;
+	static void pack(const float* in, unsigned char* out);
+};
+
+// Three half floats padded to 8 bytes to keep the next attribute aligned.
+struct Half3
+{
+	static const unsigned int size = 8, inputs = 3;
+	static const GLint components = 3;
+	static const GLenum type = GL_HALF_FLOAT;
+	static const GLboolean normalized = GL_FALSE;
+	static void pack(const float* in, unsigned char* out);
+};
+
+struct Half4
+{
+	static const unsigned int size = 8, inputs = 4;
+	static const GLint components = 4;
+	static const GLenum type = GL_HALF_FLOAT;
+	static const GLboolean normalized = GL_FALSE;
+	static void pack(const float* in, unsigned char* out);
+};
+
+// [-1, 1] in 16 bits per component, padded to 8 bytes.
+struct Snorm16x3
+{
+	static const unsigned int size = 8, inputs = 3;
+	static const GLint components = 3;
+	static const GLenum type = GL_SHORT;
+	static const GLboolean normalized = GL_TRUE;
+	static void pack(const float* in, unsigned char* out);
+};
+
+// [0, 1] in 8 bits per component, e.g. RGBA colour.
+struct Unorm8x4
+{
+	static const unsigned int size = 4, inputs = 4;
+	static const GLint components = 4;
+	static const GLenum type = GL_UNSIGNED_BYTE;
+	static const GLboolean normalized = GL_TRUE;
+	static void pack(const float* in, unsigned char* out);
+};
+
+// [-1, 1] in 10 bits for xyz and 2 bits for w, e.g. normals or tangents.
+struct Snorm1010102
+{
+	static const unsigned int size = 4, inputs = 4;
+	static const GLint components = 4;
+	static const GLenum type = GL_INT_2_10_10_10_REV;
+	static const GLboolean normalized = GL_TRUE;
+	static void pack(const float* in, unsigned char* out);
+};
+
+// [0, 1] in 10 bits for xyz and 2 bits for w.
+struct Unorm1010102
+{
+	static const unsigned int size = 4, inputs = 4;
+	static const GLint components = 4;
+	static const GLenum type = GL_UNSIGNED_INT_2_10_10_10_REV;
+	static const GLboolean normalized = GL_TRUE;
+	static void pack(const float* in, unsigned char* out);
+};
+
+}
+
+struct VertexAttributeDesc
+{
+	GLuint location;
+	GLint components;
+	GLenum type;
+	GLboolean normalized;
+	unsigned int offset;
+};
+
+// Runtime view of a VertexLayout, for code that cannot be templated on it.
+struct VertexLayoutDesc
+{
+	const VertexAttributeDesc* attributes;
+	unsigned int count;
+	unsigned int stride;
+
+	// Sets up the attributes on the bound VAO, reading from the bound
+	// GL_ARRAY_BUFFER starting at baseOffset.
+	void apply(unsigned int baseOffset = 0) const;
+	inline bool operator==(const VertexLayoutDesc& other) const { return attributes == other.attributes; };
+	inline bool operator!=(const VertexLayoutDesc& other) const { return attributes != other.attributes; };
+};
+
+namespace VertexLayoutDetail {
+
+template<typename... Formats>
+struct SizeSum;
+
+template<>
+struct SizeSum<>
+{
+	static const unsigned int value = 0;
+};
+
+template<typename Head, typename... Tail>
+struct SizeSum<Head, Tail...>
+{
+	static const unsigned int value = Head::size + SizeSum<Tail...>::value;
+};
+
+template<typename... Formats>
+constexpr unsigned int offsetOf(unsigned int index)
+{
+	const unsigned int sizes[] = { Formats::size..., 0 };
+	unsigned int offset = 0;
+	for (unsigned int i = 0; i < index; i++)
+		offset += sizes[i];
+	return offset;
+}
+
+template<typename... Formats>
+constexpr unsigned int inputsBefore(unsigned int index)
+{
+	const unsigned int inputs[] = { Formats::inputs..., 0 };
+	unsigned int total = 0;
+	for (unsigned int i = 0; i < index; i++)
+		total += inputs[i];
+	return total;
+}
+
+}
+
+// Vertex layout described by its attribute formats, in location order:
+//
+//   typedef VertexLayout<VertexFormat::Half3, VertexFormat::Unorm8x4> CompactLayout;
+//   static_assert(CompactLayout::stride == 12, "");
+//
+// Stride, offsets and the glVertexAttribPointer arguments are all compile-time
+// constants.
+template<typename... Formats>
+class VertexLayout
+{
+private:
+	template<std::size_t... I>
+	static void applyAll(unsigned int baseOffset, std::index_sequence<I...>)
+	{
+		int expand[] = { 0, (applyOne<Formats>(I, baseOffset), 0)... };
+		(void)expand;
+	}
+
+	template<typename Format>
+	static void applyOne(unsigned int location, unsigned int baseOffset)
+	{
+		GLCall(glVertexAttribPointer(location, Format::components, Format::type, Format::normalized, stride,
+			(const void*)(uintptr_t)(baseOffset + offsetOf(location))));
+		GLCall(glEnableVertexAttribArray(location));
+	}
+
+	template<std::size_t... I>
+	static const VertexLayoutDesc& describeAll(std::index_sequence<I...>)
+	{
+		static const VertexAttributeDesc attributes[] = {
+			{ (GLuint)I, Formats::components, Formats::type, Formats::normalized, offsetOf(I) }...
+		};
+		static const VertexLayoutDesc desc = { attributes, count, stride };
+		return desc;
+	}
+
+	template<std::size_t... I>
+	static void packAll(const float* in, unsigned char* out, std::index_sequence<I...>)
+	{
+		int expand[] = { 0, (Formats::pack(in + VertexLayoutDetail::inputsBefore<Formats...>(I), out + offsetOf(I)), 0)... };
+		(void)expand;
+	}
+public:
+	static const unsigned int count = sizeof...(Formats);
+	static const unsigned int stride = VertexLayoutDetail::SizeSum<Formats...>::value;
+	// Floats per vertex expected by pack().
+	static const unsigned int inputs = VertexLayoutDetail::inputsBefore<Formats...>(sizeof...(Formats));
+
+	static constexpr unsigned int offsetOf(unsigned int index) { return VertexLayoutDetail::offsetOf<Formats...>(index); }
+
+	static void apply(unsigned int baseOffset = 0)
+	{
+		applyAll(baseOffset, std::index_sequence_for<Formats...>());
+	}
+
+	static const VertexLayoutDesc& describe()
+	{
+		return describeAll(std::index_sequence_for<Formats...>());
+	}
+
+	// Converts vertexCount vertices of interleaved floats (inputs per vertex)
+	// into this layout.
+	static std::vector<unsigned char> pack(const float* vertices, unsigned int vertexCount)
+	{
+		std::vector<unsigned char> packed(vertexCount * stride, 0);
+		for (unsigned int i = 0; i < vertexCount; i++)
+			packAll(vertices + i * inputs, packed.data() + i * stride, std::index_sequence_for<Formats...>());
+		return packed;
+	}
+};
+
+// vec3 position and vec4 colour as floats, 28 bytes: the original DrawObject format.
+typedef VertexLayout<VertexFormat::Float3, VertexFormat::Float4> DefaultVertexLayout;
+// The same attributes in 12 bytes.
+typedef VertexLayout<VertexFormat::Half3, VertexFormat::Unorm8x4> CompactVertexLayout;
+
+static_assert(DefaultVertexLayout::stride == 28, "DefaultVertexLayout must match the float mesh data");
+static_assert(DefaultVertexLayout::offsetOf(1) == 12, "colour follows the float3 position");
+static_assert(CompactVertexLayout::stride == 12, "CompactVertexLayout must stay 12 bytes per vertex");
+static_assert(CompactVertexLayout::offsetOf(1) == 8, "colour follows the padded half3 position");
@@ -0,0 +1,85 @@
+#include "WorkerPool.h"
+#include "CpuProfiler.h"
+
+#include <string>
+
+WorkerPool::WorkerPool(unsigned int threadCount)
+    : task(nullptr), taskCount(0), nextTask(0), busy(0), generation(0), stopping(false)
+{
+    if (threadCount == 0)
+        threadCount = std::thread::hardware_concurrency();
+    for (unsigned int i = 1; i < threadCount; i++)
+        threads.emplace_back(&WorkerPool::workerMain, this, i);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+void WorkerPool::workerMain(unsigned int index)
+{
+#if CPU_PROFILER
+    std::string name = "Worker " + std::to_string(index);
+    PROFILE_THREAD(name.c_str());
+#else
+    (void)index;
+#endif
+    unsigned int seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+        runTasks();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy--;
+        }
+        done.notify_one();
+    }
+}
+
+void WorkerPool::runTasks()
+{
+    unsigned int i;
+    while ((i = nextTask.fetch_add(1, std::memory_order_relaxed)) < taskCount)
+        (*task)(i);
+}
+
+void WorkerPool::run(unsigned int count, const std::function<void(unsigned int)>& task)
+{
+    if (count == 0)
+        return;
+    // Not worth waking anyone for.
+    if (count == 1 || threads.empty()) {
+        for (unsigned int i = 0; i < count; i++)
+            task(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->task = &task;
+        taskCount = count;
+        nextTask.store(0, std::memory_order_relaxed);
+        busy = (unsigned int)threads.size();
+        generation++;
+    }
+    wake.notify_all();
+    runTasks();
+
+    // Every worker has to leave runTasks() before task goes out of scope.
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return busy == 0; });
+    this->task = nullptr;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent threads for data-parallel frame work. run() hands out task
+// indices to the workers and the calling thread, and returns once every task
+// has finished. Which thread runs a task is not fixed, so tasks should write
+// only to storage indexed by the task, which keeps the result deterministic.
+//
+// Tasks must not call GL: the context stays current on the calling thread.
+class WorkerPool
+{
+private:
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	const std::function<void(unsigned int)>* task;
+	unsigned int taskCount;
+	std::atomic<unsigned int> nextTask;
+	// Workers still inside the current run().
+	unsigned int busy;
+	unsigned int generation;
+	bool stopping;
+
+	void workerMain(unsigned int index);
+	void runTasks();
+public:
+	// threadCount includes the calling thread; 0 uses every hardware thread.
+	WorkerPool(unsigned int threadCount = 0);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// Calls task(i) for every i in [0, count). Not reentrant.
+	void run(unsigned int count, const std::function<void(unsigned int)>& task);
+
+	inline unsigned int getThreadCount() const { return (unsigned int)threads.size() + 1; };
+};